@@ -1,13 +1,22 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
 #include <thread>
+#include "models/chunk.h"
 
 namespace config {
 // Should be even...
 constexpr unsigned int BLOCK_SIZE = 80;
 
-constexpr std::chrono::duration<float> MGR_TICK_DURATION = std::chrono::milliseconds(1000 / 20);
+// The manager ticks when the player moves or chunks need meshing, at most this often, coalescing changes in between
+constexpr std::chrono::milliseconds MGR_MIN_TICK_INTERVAL{10};
+
+// The longest the manager waits for a change before ticking anyway
+constexpr std::chrono::milliseconds MGR_MAX_TICK_INTERVAL{1000};
+
+// The rate the server polls clients and moves bots at
+constexpr std::chrono::duration<float> SERVER_TICK_DURATION = std::chrono::milliseconds(1000 / 20);
 
 inline size_t mgr_thread_count() { return std::max(1u, std::thread::hardware_concurrency() - 1); }
 
@@ -19,15 +28,89 @@ constexpr int MAX_CHUNK_X = 8000000 - 1;
 constexpr int MIN_CHUNK_Z = -8000000;
 constexpr int MAX_CHUNK_Z = 8000000 - 1;
 
+// The heights in blocks the terrain lies between, and below which it is dirt rather than stone
+constexpr int MIN_TERRAIN_HEIGHT = -48;
+constexpr int MAX_TERRAIN_HEIGHT = 32;
+constexpr int DIRT_HEIGHT = -16;
+
+// The chunks which hold the terrain, rounded outwards, however tall chunks are
 // Must be between -2^15 and 2^15 - 1
-constexpr int MIN_CHUNK_Y = -3;
-constexpr int MAX_CHUNK_Y = 2;
+constexpr int MIN_CHUNK_Y = (MIN_TERRAIN_HEIGHT - models::RenderingChunk::Y_SIZE + 1) / models::RenderingChunk::Y_SIZE;
+constexpr int MAX_CHUNK_Y = MAX_TERRAIN_HEIGHT / models::RenderingChunk::Y_SIZE;
 
-// Render distance in chunks
+// Render distance in chunks, given in blocks so the world is drawn as far out whatever size chunks are
 // Should not be more than a few thousand ish...
-constexpr int RENDER_DISTANCE = 10;
+constexpr int RENDER_DISTANCE = 160 / models::RenderingChunk::X_SIZE;
+
+// Number of level of detail rings drawn around the full resolution chunks, each halving the resolution of the last
+constexpr unsigned int LOD_LEVELS = 3;
+
+// The radius of the hole in each level of detail ring, in nodes of that level. The hole is filled by the next finer
+// level, so the full resolution chunks are drawn up to 2 * LOD_HOLE_RADIUS + 1 chunks out, which must be within
+// RENDER_DISTANCE or the chunks beyond it are never drawn.
+constexpr int LOD_HOLE_RADIUS = (RENDER_DISTANCE - 1) / 2;
+
+// The distance in chunks that the level of detail rings are drawn to, beyond which the far terrain is drawn
+constexpr int LOD_RENDER_DISTANCE = 1024 / models::RenderingChunk::X_SIZE;
+
+// Number of heightmap terrain rings drawn beyond the level of detail rings, each doubling the tile size of the last
+constexpr unsigned int FAR_TERRAIN_LEVELS = 4;
+
+// The distance in chunks that the far terrain is drawn to
+constexpr int FAR_TERRAIN_DISTANCE = 16384 / models::RenderingChunk::X_SIZE;
+
+// Quads along each side of a far terrain tile
+constexpr unsigned int FAR_TERRAIN_TILE_RESOLUTION = 16;
+
+// Whether chunk meshes have per-vertex ambient occlusion
+constexpr bool AMBIENT_OCCLUSION = true;
+
+// Whether chunks which can't be seen from the camera chunk through the open voxels of the chunks between are culled
+constexpr bool VISIBILITY_CULLING = true;
+
+// Whether meshes hidden behind the solid parts of nearby chunks are culled each frame with a software depth buffer
+constexpr bool OCCLUSION_CULLING = true;
+
+// The resolution of the software depth buffer. The width must be a multiple of 8.
+constexpr unsigned int OCCLUSION_BUFFER_WIDTH = 256;
+constexpr unsigned int OCCLUSION_BUFFER_HEIGHT = 128;
+
+// How far from the camera chunk, along x or z, chunks are drawn into the software depth buffer
+constexpr int OCCLUDER_DISTANCE = 96 / models::RenderingChunk::X_SIZE;
+
+// How far ahead the player's position is predicted from their velocity, so chunks along their path are loaded before
+// they arrive
+constexpr float PREFETCH_SECONDS = 1.5f;
+
+// The furthest the predicted position can be from the player, in chunks
+constexpr int MAX_PREFETCH_DISTANCE = RENDER_DISTANCE;
+
+// The maximum memory used by loaded chunks, including their blocks and light. Meshes are only kept on the GPU.
+// Should be comfortably more than the chunks within RENDER_DISTANCE + 2 use, or chunks near the player will be evicted.
+constexpr size_t CHUNK_STORE_BYTE_BUDGET = size_t{512} << 20;
+
+// Whether the chunk store asks for its memory to be backed by transparent huge pages, where supported
+constexpr bool CHUNK_STORE_HUGE_PAGES = true;
+
+// The most voxels light spreads through from a newly loaded chunk each time the chunk store lock is taken. The lock is
+// released in between, so a large join doesn't stall the render thread.
+constexpr unsigned int LIGHT_JOIN_SLICE_VOXELS = 4096;
+
+// Size of the ring which finished meshes are copied into for upload. Must fit the largest possible chunk mesh.
+constexpr size_t MESH_STAGING_BYTES = size_t{64} << 20;
+
+// The most mesh data uploaded each frame, smoothing out spikes from many chunks finishing at once
+constexpr size_t MESH_UPLOAD_BYTES_PER_FRAME = size_t{8} << 20;
+
+// Number of the least recently used chunks considered for each eviction from the chunk store
+constexpr unsigned int CHUNK_EVICTION_CANDIDATES = 16;
+
+// Where the decoded block textures and their mip levels are cached, relative to the working directory
+constexpr const char *TEXTURE_CACHE_PATH = "block_textures.cache";
+
+// The loopback port the dedicated server accepts clients on
+constexpr uint16_t SERVER_PORT = 24680;
 
-// The maximum number of chunks that can be loaded at once
-constexpr size_t MAX_CHUNKS_LOADED =
-    2 * (2 * (RENDER_DISTANCE + 2) + 1) * (2 * (RENDER_DISTANCE + 2) + 1) * (2 * (RENDER_DISTANCE + 2) + 1);
+// How far around each player, in chunks, the dedicated server keeps chunks loaded. Matches what the client loads.
+constexpr int SERVER_LOAD_DISTANCE = RENDER_DISTANCE + 2;
 }  // namespace config
\ No newline at end of file
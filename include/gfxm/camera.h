@@ -30,6 +30,9 @@ public:
     // Generate the view matrix for the camera
     Matrix<4, 4> view() const;
 
+    // The direction the camera is looking in, as a unit vector
+    Vec<3> direction() const;
+
     float pitch() const { return _pitch; }
     float yaw() const { return _yaw; }
 
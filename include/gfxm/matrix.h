@@ -5,7 +5,9 @@
 #include <assert.h>
 #include <cstring>
 #include <array>
+#include <span>
 #include <string>
+#include <immintrin.h>
 
 // TODO use std valarray?
 
@@ -170,6 +172,28 @@ public:
     Matrix<ROWS, OTHER_COLS> operator*(const Matrix<COLS, OTHER_COLS>& rhs) const {
         Matrix<ROWS, OTHER_COLS> out;
 
+#ifdef __SSE__
+        if constexpr (ROWS == 4 && COLS == 4) {
+            // Each column of the result is the columns of this matrix weighted by a column of rhs, summed in the same
+            // order as below so the results match
+            const __m128 c0 = _mm_loadu_ps(&mat[0]);
+            const __m128 c1 = _mm_loadu_ps(&mat[4]);
+            const __m128 c2 = _mm_loadu_ps(&mat[8]);
+            const __m128 c3 = _mm_loadu_ps(&mat[12]);
+
+            for (int rcl = 0; rcl < OTHER_COLS; rcl++) {
+                __m128 sum = _mm_mul_ps(c0, _mm_set1_ps(rhs[0, rcl]));
+                sum = _mm_add_ps(sum, _mm_mul_ps(c1, _mm_set1_ps(rhs[1, rcl])));
+                sum = _mm_add_ps(sum, _mm_mul_ps(c2, _mm_set1_ps(rhs[2, rcl])));
+                sum = _mm_add_ps(sum, _mm_mul_ps(c3, _mm_set1_ps(rhs[3, rcl])));
+
+                _mm_storeu_ps(&out.array()[rcl * 4], sum);
+            }
+
+            return out;
+        }
+#endif
+
         for (int rcl = 0; rcl < OTHER_COLS; rcl++) {
             for (int lcl = 0; lcl < COLS; lcl++) {
                 for (int lrw = 0; lrw < ROWS; lrw++) {
@@ -181,13 +205,14 @@ public:
         return out;
     }
 
+    // Element-wise operations run over the flat array without bounds checks, so the compiler can vectorise them for any
+    // size, including the 3-vectors used when meshing
+
     Matrix<ROWS, COLS> operator*(float scalar) const {
         Matrix<ROWS, COLS> out;
 
-        for (int c = 0; c < COLS; c++) {
-            for (int r = 0; r < ROWS; r++) {
-                out[r, c] = (*this)[r, c] * scalar;
-            }
+        for (int i = 0; i < ROWS * COLS; i++) {
+            out.mat[i] = mat[i] * scalar;
         }
 
         return out;
@@ -196,10 +221,8 @@ public:
     Matrix<ROWS, COLS> operator+(const Matrix<ROWS, COLS>& rhs) const {
         Matrix<ROWS, COLS> out;
 
-        for (int c = 0; c < COLS; c++) {
-            for (int r = 0; r < ROWS; r++) {
-                out[r, c] = (*this)[r, c] + rhs[r, c];
-            }
+        for (int i = 0; i < ROWS * COLS; i++) {
+            out.mat[i] = mat[i] + rhs.mat[i];
         }
 
         return out;
@@ -208,10 +231,8 @@ public:
     Matrix<ROWS, COLS> operator-() const {
         Matrix<ROWS, COLS> out;
 
-        for (int c = 0; c < COLS; c++) {
-            for (int r = 0; r < ROWS; r++) {
-                out[r, c] = -(*this)[r, c];
-            }
+        for (int i = 0; i < ROWS * COLS; i++) {
+            out.mat[i] = -mat[i];
         }
 
         return out;
@@ -220,10 +241,8 @@ public:
     Matrix<ROWS, COLS> operator-(const Matrix<ROWS, COLS> rhs) const {
         Matrix<ROWS, COLS> out;
 
-        for (int c = 0; c < COLS; c++) {
-            for (int r = 0; r < ROWS; r++) {
-                out[r, c] = (*this)[r, c] - rhs[r, c];
-            }
+        for (int i = 0; i < ROWS * COLS; i++) {
+            out.mat[i] = mat[i] - rhs.mat[i];
         }
 
         return out;
@@ -247,4 +266,9 @@ public:
 template <unsigned char ROWS>
 using Vec = Matrix<ROWS, 1>;
 
+// Transforms points by a matrix as if their w were 1, giving the same results as multiplying each by the matrix.
+// Points are done 8 at a time with AVX, for culling many boxes at once. out must be as long as points.
+void transform_points(const Matrix<4, 4>& matrix, std::span<const std::array<float, 3>> points,
+                      std::span<std::array<float, 4>> out);
+
 }  // namespace gfxm
\ No newline at end of file
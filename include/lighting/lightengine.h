@@ -0,0 +1,134 @@
+#pragma once
+
+#include "../models/chunk.h"
+#include "../models/light.h"
+#include <array>
+#include <climits>
+#include <functional>
+#include <span>
+#include <vector>
+
+namespace lighting {
+
+enum class LightChannel { SKY, BLOCK };
+
+// Flood fill propagation of sky and block light between voxels, including across chunk borders.
+// Sky light travels straight down without attenuation, and otherwise both channels lose one level per voxel.
+// All coordinates are world voxel coordinates unless stated otherwise.
+template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
+class LightEngine {
+public:
+    using Chunk = models::Chunk<X_SIZE, Y_SIZE, Z_SIZE>;
+    using Light = models::ChunkLight<X_SIZE, Y_SIZE, Z_SIZE>;
+
+    // A loaded chunk which light can propagate through.
+    // If changed is not null, it is set to true whenever the light of the chunk is modified, and the chunk is noted in
+    // the changed chunks if it wasn't already set.
+    struct ChunkRef {
+        const Chunk* chunk = nullptr;
+        Light* light = nullptr;
+        bool* changed = nullptr;
+    };
+
+    // Returns the chunk at the given chunk coordinates, or a ChunkRef with a null chunk if it is not loaded.
+    using ChunkLookup = std::function<ChunkRef(int chunk_x, int chunk_y, int chunk_z)>;
+
+private:
+    struct AddNode {
+        int x, y, z;
+    };
+
+    struct RemoveNode {
+        int x, y, z;
+        models::LightLevel level;
+    };
+
+    // Caches recent chunk lookups, as nearly all neighbouring voxels are in one of a few chunks.
+    class VoxelFinder {
+        struct Cached {
+            int chunk_x, chunk_y, chunk_z;
+            ChunkRef ref;
+        };
+
+        const ChunkLookup& lookup;
+        std::array<Cached, 8> cache;
+        size_t cache_size = 0;
+        size_t cache_next = 0;
+
+    public:
+        VoxelFinder(const ChunkLookup& lookup) : lookup(lookup) {}
+
+        // Finds the chunk containing the voxel and the index of the voxel within it.
+        // Returns false if the chunk is not loaded.
+        bool find(int x, int y, int z, ChunkRef& ref, unsigned int& index);
+    };
+
+    std::vector<AddNode> sky_add;
+    std::vector<AddNode> block_add;
+    std::vector<RemoveNode> sky_remove;
+    std::vector<RemoveNode> block_remove;
+
+    // Where each queue is up to, so propagation can stop partway and carry on later
+    size_t sky_add_head = 0;
+    size_t block_add_head = 0;
+    size_t sky_remove_head = 0;
+    size_t block_remove_head = 0;
+
+    std::vector<std::array<int, 3>> changed_chunks;
+
+    // Sets the changed flag of the chunk holding the voxel, noting the chunk if the flag wasn't already set
+    void mark_changed(const ChunkRef& ref, int x, int y, int z);
+
+    // Each runs a queue from its head until it is empty or budget nodes have been taken from it, returning the voxels
+    // visited. The budget is reduced by the nodes taken.
+    template <LightChannel CHANNEL>
+    unsigned int run_add(VoxelFinder& finder, std::vector<AddNode>& queue, size_t& head, unsigned int& budget);
+
+    template <LightChannel CHANNEL>
+    unsigned int run_remove(VoxelFinder& finder, std::vector<RemoveNode>& queue, size_t& head,
+                            std::vector<AddNode>& add_queue, unsigned int& budget);
+
+    // Queues the voxels on both sides of the border between two adjacent chunks to be propagated.
+    // dx, dy and dz give the direction from the first chunk to the second, one of which is non-zero.
+    void queue_border(int chunk_x, int chunk_y, int chunk_z, int dx, int dy, int dz, const ChunkRef& a,
+                      const ChunkRef& b);
+
+public:
+    // Lights a newly generated chunk without considering any other chunks. Sky light only enters the columns whose
+    // surface height, the world y of the lowest block above the terrain indexed by x + z * X_SIZE, is at or below the
+    // top of the chunk, so chunks under the terrain start dark rather than open to the sky. Without surface heights
+    // every column is taken to be open.
+    // Must not be called while propagating. Returns the number of voxels visited.
+    unsigned int light_isolated(const Chunk& chunk, Light& light, int chunk_y = 0,
+                                std::span<const int> surface_heights = {});
+
+    // Queues light to be propagated between a newly loaded chunk, which has been lit with light_isolated, and its
+    // loaded neighbours, correcting the sky light where light_isolated was wrong. Run it with propagate.
+    void join_neighbours(int chunk_x, int chunk_y, int chunk_z, const ChunkLookup& lookup);
+
+    // Propagates queued light through up to about max_voxels voxels, so a large join can be split up, e.g. to release
+    // a lock in between. Chunks may be loaded, unloaded or changed in between, as nothing is kept but voxel
+    // coordinates. Returns the number of voxels visited.
+    unsigned int propagate(const ChunkLookup& lookup, unsigned int max_voxels = UINT_MAX);
+
+    // Whether there is queued light left to propagate
+    bool propagating() const {
+        return !sky_add.empty() || !block_add.empty() || !sky_remove.empty() || !block_remove.empty();
+    }
+
+    // Relights after the block at the given voxel has been changed.
+    // The new block must already be in the chunk.
+    // Returns the number of voxels visited.
+    unsigned int update_block(int x, int y, int z, const ChunkLookup& lookup);
+
+    // Appends the chunks, in chunk coordinates, whose changed flag has been set by the engine since the last call, so
+    // a caller can find them without scanning every flag
+    void take_changed_chunks(std::vector<std::array<int, 3>>& out);
+
+    // Copies the light of a chunk and the bordering voxels of its face neighbours into a padded light.
+    // Borders with unloaded neighbours are copied from the nearest voxel in the chunk.
+    static void copy_padded(int chunk_x, int chunk_y, int chunk_z, const ChunkLookup& lookup,
+                            models::PaddedChunkLight<X_SIZE, Y_SIZE, Z_SIZE>& padded);
+};
+
+}  // namespace lighting
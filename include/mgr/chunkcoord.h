@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+
+namespace mgr {
+
+using ChunkCoord = std::tuple<int, int, int>;
+
+struct ChunkCoordHasher {
+    std::size_t operator()(const ChunkCoord& coord) const {
+        const auto [chunk_x, chunk_y, chunk_z] = coord;
+
+        // x and z are 24 bits, y is 16 bits
+        // arrange like
+        // MSB (XXX)(YY)(ZZZ) LSB
+        uint64_t hash = static_cast<uint32_t>(chunk_x) & ~(~0u << 24);
+        hash <<= 16;
+        hash |= static_cast<uint32_t>(chunk_y) & ~(~0u << 16);
+        hash <<= 24;
+        hash |= static_cast<uint32_t>(chunk_z) & ~(~0u << 24);
+
+        // David Stafford's Mix13 for MurmurHash3's 64-bit finalizer
+        hash = (hash ^ (hash >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+        hash = (hash ^ (hash >> 27)) * UINT64_C(0x94D049BB133111EB);
+        hash = hash ^ (hash >> 31);
+
+        return hash;
+    }
+};
+
+}  // namespace mgr
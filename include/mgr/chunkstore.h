@@ -3,97 +3,245 @@
 #include <list>
 #include <unordered_map>
 #include <optional>
+#include <span>
 #include "../models/chunk.h"
+#include "../models/light.h"
+#include "../models/occupancy.h"
+#include "../lighting/lightengine.h"
 #include "../render/chunk.h"
 #include "threadpool.h"
+#include "meshqueue.h"
+#include "chunkcoord.h"
+#include "interest.h"
+#include "wakesignal.h"
+#include "taskgraph.h"
+#include "slabpool.h"
 #include <functional>
 #include <tuple>
+#include <atomic>
 #include "../worldgen/generator.h"
 
 namespace mgr {
 
 struct ChunkStoreEntry {
     models::RenderingChunk chunk;
-    std::vector<uint8_t> vertex_data;
-    unsigned int instance_count;
+    models::RenderingChunkLight light;
+
+    // Set once a mesh of the chunk has been sent for upload
+    bool meshed = false;
+
+    // Set when the chunk needs its vertex data generated again, because its light has changed or the renderer has
+    // freed its mesh. Whatever sets it also notes the chunk in the store's flagged chunks.
+    bool needs_remesh = false;
+
+    // Set while a job to generate the vertex data of the chunk is queued or running
+    bool remesh_queued = false;
 };
 
 // One thread should have access to this at a time.
 class ChunkStoreHandle {
-    using ChunkCoord = std::tuple<int, int, int>;
-
-    struct ChunkCoordHasher {
-        std::size_t operator()(const ChunkCoord& coord) const {
-            const auto [chunk_x, chunk_y, chunk_z] = coord;
-
-            // x and z are 24 bits, y is 16 bits
-            // arrange like
-            // MSB (XXX)(YY)(ZZZ) LSB
-            uint64_t hash = static_cast<uint32_t>(chunk_x) & ~(~0u << 24);
-            hash <<= 16;
-            hash |= static_cast<uint32_t>(chunk_y) & ~(~0u << 16);
-            hash <<= 24;
-            hash |= static_cast<uint32_t>(chunk_z) & ~(~0u << 24);
-
-            // David Stafford's Mix13 for MurmurHash3's 64-bit finalizer
-            hash = (hash ^ (hash >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
-            hash = (hash ^ (hash >> 27)) * UINT64_C(0x94D049BB133111EB);
-            hash = hash ^ (hash >> 31);
-
-            return hash;
-        }
+    struct StoredEntry {
+        ChunkStoreEntry* entry;
+
+        // Pinned chunks are left out of the LRU, so they are never evicted
+        std::optional<std::list<ChunkCoord>::const_iterator> lru_it;
     };
 
-    std::unordered_map<ChunkCoord, std::pair<ChunkStoreEntry, std::list<ChunkCoord>::const_iterator>, ChunkCoordHasher>
-        map;
+    // Chunks are constantly loaded and evicted, so they are kept in slabs rather than each allocated separately
+    SlabPool<ChunkStoreEntry> entries;
+    std::unordered_map<ChunkCoord, StoredEntry, ChunkCoordHasher> map;
     std::list<ChunkCoord> lru;
-    size_t max_size;
+    size_t max_bytes;
+    size_t _bytes_used = 0;
+    ChunkCoord focus = {0, 0, 0};
+
+    // Chunks whose needs_remesh has been set since they were last taken, so they can be queued without scanning
+    std::vector<ChunkCoord> flagged;
+
+    // The memory used by an entry, including its map and LRU nodes. Every entry is the same size, as meshes are only
+    // kept on the GPU.
+    static size_t entry_bytes();
+
+    // Evicts chunks until the store is within its budget, never evicting the given chunk or pinned chunks.
+    // Of the least recently used chunks, the one furthest from the focus is evicted first.
+    void evict_to_budget(const ChunkCoord& keep);
 
     ChunkStoreHandle operator=(const ChunkStoreHandle&) = delete;
     ChunkStoreHandle(const ChunkStoreHandle&) = delete;
 
 public:
-    ChunkStoreHandle(size_t max_size) : max_size(max_size) {}
+    ChunkStoreHandle(size_t max_bytes);
+    ~ChunkStoreHandle();
 
     // Returns a pointer to the chunk at the given coordinates, if it is loaded, otherwise nullptr.
     // Does not mark the chunk as used for the LRU.
     // Assumes chunk is in valid range
     const ChunkStoreEntry* get(int chunk_x, int chunk_y, int chunk_z) const;
 
+    // Returns a pointer to the chunk at the given coordinates, if it is loaded, otherwise nullptr.
+    // Does not mark the chunk as used for the LRU.
+    // Assumes chunk is in valid range
+    ChunkStoreEntry* get(int chunk_x, int chunk_y, int chunk_z);
+
     // Returns a pointer to the chunk at the given coordinates, if it is loaded, otherwise nullptr.
     // Marks the chunk as used for the LRU.
     // Assumes chunk is in valid range
     ChunkStoreEntry* get_and_mark_used(int chunk_x, int chunk_y, int chunk_z);
 
-    // Puts a chunk into the store, evicting the least recently used chunk if necessary.
+    // Puts a chunk into the store, evicting chunks if it is over its memory budget.
+    // A pinned chunk is never evicted until it is unpinned. The store can go over its budget if pinned chunks fill it.
     // Assumes chunk is in valid range
-    void put(int chunk_x, int chunk_y, int chunk_z, const ChunkStoreEntry& entry);
+    void put(int chunk_x, int chunk_y, int chunk_z, const ChunkStoreEntry& entry, bool pinned = false);
+
+    // Pins or unpins a chunk, if it is loaded. An unpinned chunk becomes the most recently used.
+    void set_pinned(const ChunkCoord& coord, bool pinned);
+
+    // Flags a loaded chunk to be meshed again, e.g. when the renderer has freed its mesh
+    void flag_remesh(int chunk_x, int chunk_y, int chunk_z);
+
+    // Notes a chunk whose needs_remesh has been set without flag_remesh, e.g. by the light engine
+    void note_flagged(const ChunkCoord& coord) { flagged.push_back(coord); }
+
+    // Replaces the contents of out with the chunks flagged since the last call
+    void take_flagged(std::vector<ChunkCoord>& out) {
+        out.clear();
+        std::swap(out, flagged);
+    }
+
+    // Sets the chunk around which chunks are kept in preference when evicting
+    void set_focus(int chunk_x, int chunk_y, int chunk_z) { focus = {chunk_x, chunk_y, chunk_z}; }
+
+    // The memory used by the loaded chunks
+    size_t bytes_used() const { return _bytes_used; }
+
+    // The number of loaded chunks
+    size_t size() const { return map.size(); }
 };
 
 // SAFETY: ChunkStore must outlive the thread pool!!
-// A store for chunks, which can be loaded and unloaded.
-// The least recently used chunk is unloaded when the store is full.
+// A store for chunks, which are loaded around a set of interest points such as players.
+// Chunks in range of any point are pinned. Other chunks are unloaded when the store is over its memory budget, picking
+// from the least recently used chunks those which are far from the first point.
 class ChunkStore {
+    using LightEngine = lighting::LightEngine<models::RenderingChunk::X_SIZE, models::RenderingChunk::Y_SIZE,
+                                              models::RenderingChunk::Z_SIZE>;
+
     std::mutex mutex;
     ChunkStoreHandle handle;
-    worldgen::ChunkGenerator<16, 16, 16> chunk_generator;
+    worldgen::ChunkGenerator<models::RenderingChunk::X_SIZE, models::RenderingChunk::Y_SIZE,
+                             models::RenderingChunk::Z_SIZE> chunk_generator;
+
+    // Used for block changes, only while holding the mutex. Loads use an engine per worker.
+    LightEngine light_engine;
+    const LightEngine::ChunkLookup light_lookup;
+
+    // Meshes are handed to the renderer rather than kept in the store. Null when nothing is rendered, e.g. on a server,
+    // in which case chunks are never meshed.
+    MeshUploadQueue* mesh_uploads;
+
+    // Notified when chunks may need meshing, so they are queued by the next update_interest_on_pool. May be null.
+    WakeSignal* on_change;
+
+    // The number of chunks loaded since the store was created
+    std::atomic<uint64_t> _chunks_loaded = 0;
+
+    // Only used while holding the mutex
+    InterestSet interest;
+    std::vector<ChunkCoord> entered_interest;
+    std::vector<ChunkCoord> left_interest;
+    std::vector<std::pair<float, ChunkCoord>> prioritised_loads;
+    std::vector<std::pair<float, ChunkCoord>> prioritised_meshes;
+
+    // Chunks which are loaded ahead of time but neither pinned nor meshed until they come into range of interest
+    InterestSet prefetch_interest;
+    std::vector<ChunkCoord> entered_prefetch;
+    std::vector<ChunkCoord> left_prefetch;
+    std::vector<std::pair<float, ChunkCoord>> prioritised_prefetches;
+    std::vector<ChunkCoord> flagged_remeshes;
+    std::vector<std::array<int, 3>> light_changed_chunks;
+
+    // Loading (generating and lighting) and meshing chunks. A chunk which comes into range is meshed once it and its
+    // neighbours in range have loaded, so it isn't meshed before its borders are known. Each chunk is queued once
+    // however many points it comes into range of.
+    TaskGraph tasks;
+
+    // The data from a chunk and its neighbours needed to mesh it, copied so meshing can happen without the lock
+    struct MeshBorders {
+        models::PaddedChunkLight<models::RenderingChunk::X_SIZE, models::RenderingChunk::Y_SIZE,
+                                 models::RenderingChunk::Z_SIZE>
+            light;
+        models::PaddedOccupancy<models::RenderingChunk::X_SIZE, models::RenderingChunk::Y_SIZE,
+                                models::RenderingChunk::Z_SIZE>
+            occupancy;
+    };
 
-public:
-    ChunkStore(size_t max_size, uint32_t worldgen_seed) : handle(max_size), chunk_generator(worldgen_seed) {}
+    // Flags the loaded neighbours of a newly loaded chunk which have been meshed, or are being meshed, as their borders
+    // were guessed from their own edge voxels while it wasn't loaded. Must hold the mutex.
+    void flag_meshed_neighbours(int chunk_x, int chunk_y, int chunk_z);
+
+    // Copies the mesh borders of a loaded chunk. Must hold the mutex.
+    void copy_mesh_borders(int chunk_x, int chunk_y, int chunk_z, MeshBorders& borders);
+
+    // Generates the vertex data for a chunk and queues it for upload, if the chunk is still loaded.
+    // The chunk must have remesh_queued set, which is cleared once the mesh is queued.
+    void mesh_chunk(int chunk_x, int chunk_y, int chunk_z, const models::RenderingChunk& chunk,
+                    const MeshBorders& borders);
+
+    // Notifies on_change if chunks are meshed
+    void notify_change();
 
-    // Loads the chunks in a cube of side 2n+1 centred on the chunk if they are not already loaded, by sending the work
-    // to the given thread pool.
-    void load_n_around_on_pool(ThreadPool& pool, int chunk_x, int chunk_y, int chunk_z, int n);
+    // Notes the chunks whose light the engine has changed as flagged for meshing. Must hold the mutex.
+    void note_light_changes(LightEngine& engine);
 
-    // Loads a chunk into the store, if it is not already loaded.
-    // If the store is full, the least recently loaded chunk is unloaded.
-    // If the chunk is already loaded, it is treated as if it was just loaded for the above purpose.
+    // The job queued to load a chunk which came into range, which is skipped if it has gone out of range since
+    void load_queued_chunk(int chunk_x, int chunk_y, int chunk_z);
+
+    // Adds the load task of a chunk, and its mesh task if meshing, unless already in the graph. Must hold the mutex.
+    void add_load_task(const ChunkCoord& coord, float priority);
+    void add_mesh_task(const ChunkCoord& coord, float priority);
+
+public:
+    ChunkStore(size_t max_bytes, uint32_t worldgen_seed, MeshUploadQueue* mesh_uploads,
+               WakeSignal* on_change = nullptr);
+
+    // Replaces the interest points chunks are kept loaded around, and loads the chunks which came into range of them by
+    // sending the work to the given thread pool. Only chunks which came into or went out of range since the last call
+    // are visited, and each is queued once however many points it is near. Loaded chunks in range which need a new
+    // mesh are queued for remeshing. The first point becomes the focus for eviction.
+    // With a bias, the chunks which came into range are queued in order of their load_priority.
+    // Chunks around the prefetch points are only loaded, in the same order, and are neither pinned nor meshed until
+    // they come into range of an interest point, so loading ahead doesn't make meshes nobody draws.
+    void update_interest_on_pool(ThreadPool& pool, std::span<const InterestPoint> points,
+                                 const std::optional<LoadBias>& bias = std::nullopt,
+                                 std::span<const InterestPoint> prefetch_points = {});
+
+    // Loads a chunk into the store, if it is not already loaded. It is pinned if it is in range of an interest point.
+    // If the store is over its memory budget, other chunks are unloaded. The chunk is flagged for meshing, which is
+    // queued by update_interest_on_pool if it isn't already.
     // Assumes chunk is in valid range
     void load_chunk(int chunk_x, int chunk_y, int chunk_z);
 
+    // Regenerates the vertex data of a loaded chunk and queues it for upload, e.g. after its light has changed.
+    // Does nothing if the store has no upload queue, or the chunk is already being meshed.
+    void remesh_chunk(int chunk_x, int chunk_y, int chunk_z);
+
+    // Sets the block at the given world voxel coordinates and relights around it, if its chunk is loaded.
+    // The chunk and any chunks with changed light will be remeshed on the next update_interest_on_pool.
+    void set_block(int x, int y, int z, models::Block block);
+
+    // Appends a network record of a loaded chunk to a send buffer, encoded straight from the store under the lock.
+    // Returns false if the chunk isn't loaded.
+    bool encode_chunk(int chunk_x, int chunk_y, int chunk_z, std::vector<uint8_t>& send_buffer);
+
     // Runs the given function with an exclusive handle to the chunk store.
-    // Allows for multiple operations on the store to be performed.
+    // Allows for multiple operations on the store to be performed, including flagging chunks for remeshing.
     void use_handle(const std::function<void(ChunkStoreHandle&)>& f);
+
+    // The number of load and mesh tasks waiting or running
+    size_t queued_tasks() { return tasks.size(); }
+
+    // The number of chunks generated and lit since the store was created, including any since evicted
+    uint64_t chunks_loaded() const { return _chunks_loaded.load(std::memory_order::relaxed); }
 };
 
 }  // namespace mgr
\ No newline at end of file
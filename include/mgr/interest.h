@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+#include "chunkcoord.h"
+
+namespace mgr {
+
+// A point chunks are kept loaded around, such as a player, identified across updates by its id
+struct InterestPoint {
+    uint64_t id;
+    int chunk_x;
+    int chunk_y;
+    int chunk_z;
+
+    // Chunks within this many chunks along each axis are in range
+    int radius;
+};
+
+// Where chunks should be loaded first: near a position, and in front of it more than behind it
+struct LoadBias {
+    // In chunks
+    std::array<float, 3> position;
+
+    // A unit vector, or zero to only prefer nearer chunks
+    std::array<float, 3> direction;
+};
+
+// The order to load a chunk in, lower first. Chunks in front of the bias count as up to half as far away as they are,
+// and chunks behind up to half as far again.
+float load_priority(const ChunkCoord& coord, const LoadBias& bias);
+
+// The union of the cubes of chunks around a set of interest points, kept as the number of cubes each chunk is in.
+// Each update diffs the cube of every point against its cube from the last update, so its cost is proportional to the
+// chunks which came into or went out of range rather than to the size of the cubes.
+class InterestSet {
+    // An inclusive box of chunks, clamped to the chunks which can exist
+    struct Box {
+        std::array<int, 3> min;
+        std::array<int, 3> max;
+    };
+
+    std::unordered_map<uint64_t, Box> boxes;
+    std::unordered_map<ChunkCoord, uint32_t, ChunkCoordHasher> refs;
+
+    static Box box_around(const InterestPoint& point);
+
+public:
+    // Replaces the points with the given ones, which must have unique ids.
+    // Chunks which came into range of any point are appended to entered, and chunks which are now out of range of all
+    // of them to left.
+    void update(std::span<const InterestPoint> points, std::vector<ChunkCoord>& entered, std::vector<ChunkCoord>& left);
+
+    // Whether a chunk is in range of any point
+    bool contains(const ChunkCoord& coord) const { return refs.contains(coord); }
+
+    // The number of chunks in range of any point
+    size_t size() const { return refs.size(); }
+
+    // The number of points
+    size_t points() const { return boxes.size(); }
+};
+
+}  // namespace mgr
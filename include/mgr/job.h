@@ -0,0 +1,145 @@
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <optional>
+#include <stop_token>
+#include <utility>
+#include "threadpool.h"
+
+namespace mgr {
+
+// Coroutine frames of jobs and tasks come from free lists by size rather than the heap, so a job only allocates
+// when more are running than ever before. Frames are shared between threads, as a job which hops onto a pool with
+// resume_on is started on one thread and finished on another.
+void* allocate_job_frame(std::size_t size);
+void free_job_frame(void* frame, std::size_t size);
+
+struct PooledFramePromise {
+    static void* operator new(std::size_t size) { return allocate_job_frame(size); }
+    static void operator delete(void* frame, std::size_t size) { free_job_frame(frame, size); }
+};
+
+// A coroutine which runs to completion without anything waiting for it, e.g.
+//   Job load(ThreadPool& pool, std::stop_token stop) {
+//       if (!co_await resume_on(pool, stop)) co_return;
+//       co_await generate();
+//       co_await mesh();
+//   }
+// It starts on the calling thread, and frees itself when it finishes. Like any other pool job, an exception thrown
+// out of it ends the program. A job still queued when its pool stops is destroyed by the pool instead of resumed.
+struct Job {
+    struct promise_type : PooledFramePromise {
+        Job get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+// Awaiting moves a job onto a thread of the pool, behind the jobs already queued. If the token has been stopped, or
+// the pool has, it isn't moved, and the result is false, so a job can give up before doing work nobody wants.
+// Only a Job can await it, not a Task, as the pool destroys the awaiting coroutine if it stops first, and a Task's
+// frame belongs to whatever awaits it.
+class ResumeOn {
+    ThreadPool& pool;
+    std::stop_token stop;
+    bool enqueued = false;
+
+public:
+    ResumeOn(ThreadPool& pool, std::stop_token stop) : pool(pool), stop(std::move(stop)) {}
+
+    bool await_ready() const { return stop.stop_requested(); }
+
+    bool await_suspend(std::coroutine_handle<Job::promise_type> handle) {
+        enqueued = pool.try_enqueue(ResumeJob{handle});
+        return enqueued;
+    }
+
+    bool await_resume() const { return enqueued && !stop.stop_requested(); }
+};
+
+inline ResumeOn resume_on(ThreadPool& pool, std::stop_token stop = {}) { return {pool, std::move(stop)}; }
+
+struct TaskPromiseBase : PooledFramePromise {
+    std::coroutine_handle<> continuation;
+    std::exception_ptr error;
+
+    // Hands the thread straight back to the awaiting coroutine, without growing the stack
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+        void await_resume() noexcept {}
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            return handle.promise().continuation;
+        }
+    };
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() { error = std::current_exception(); }
+};
+
+template <typename T>
+struct TaskPromise : TaskPromiseBase {
+    std::optional<T> value;
+
+    void return_value(T result) { value.emplace(std::move(result)); }
+
+    T result() {
+        if (error) std::rethrow_exception(error);
+        return std::move(*value);
+    }
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase {
+    void return_void() {}
+
+    void result() {
+        if (error) std::rethrow_exception(error);
+    }
+};
+
+// A stage of a job which returns a result, e.g. co_await generate(coord). It starts when awaited and runs on the same
+// thread until it finishes or awaits something else. Exceptions thrown in it are rethrown by co_await.
+template <typename T = void>
+class [[nodiscard]] Task {
+public:
+    struct promise_type : TaskPromise<T> {
+        Task get_return_object() { return Task{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+    };
+
+private:
+    std::coroutine_handle<promise_type> handle;
+
+    explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+    struct Awaiter {
+        std::coroutine_handle<promise_type> handle;
+
+        bool await_ready() const { return false; }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) {
+            handle.promise().continuation = awaiting;
+            return handle;
+        }
+
+        T await_resume() { return handle.promise().result(); }
+    };
+
+public:
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    Task& operator=(Task&& other) = delete;
+
+    ~Task() {
+        if (handle) handle.destroy();
+    }
+
+    Awaiter operator co_await() && { return Awaiter{handle}; }
+};
+
+}  // namespace mgr
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <mutex>
+#include <stop_token>
+#include <unordered_map>
+#include <functional>
+#include <tuple>
+#include <vector>
+#include <span>
+#include "../models/chunk.h"
+#include "../worldgen/generator.h"
+#include "../render/mesher.h"
+#include "threadpool.h"
+#include "job.h"
+#include "meshqueue.h"
+#include "wakesignal.h"
+
+namespace mgr {
+
+// Returns whether a level of detail node should be drawn for a camera in the given chunk, based on its horizontal
+// position. Level 0 nodes are chunks, and a node at level L covers 2^L chunks along each axis. Levels above
+// config::LOD_LEVELS are far terrain tiles.
+// Each level is drawn in a square ring whose hole is exactly covered by the nodes of the next finer level, so levels
+// never overlap. A positive margin grows the ring by that many nodes on each side, for loading nodes early.
+bool lod_node_in_ring(unsigned int level, int node_x, int node_z, int camera_chunk_x, int camera_chunk_z,
+                      int margin = 0);
+
+// The furthest distance along x or z from the node containing the camera, in nodes of the given level, that a node can
+// be in its ring with a margin of 1.
+int lod_ring_extent(unsigned int level);
+
+struct LodStoreEntry {
+    // False while the node is queued to be generated or remeshed
+    bool loaded = false;
+
+    // Set when the renderer has freed the mesh of the node, so it must be generated again
+    bool needs_remesh = false;
+
+    // Stopped when the node is unloaded, so its job gives up
+    std::stop_source unloaded;
+};
+
+// SAFETY: LodStore must outlive the thread pool!!
+// A store for the level of detail nodes, which are generated straight from the heightmap at a lower resolution without
+// generating any chunks. Their meshes are handed to the renderer rather than kept in the store.
+// Nodes are unloaded once they are outside the rings around the camera.
+class LodStore {
+    using NodeCoord = std::tuple<unsigned int, int, int, int>;
+
+    struct NodeCoordHasher {
+        std::size_t operator()(const NodeCoord& coord) const {
+            const auto [level, node_x, node_y, node_z] = coord;
+
+            // Same layout as the chunk coordinate hash, with the level in the top bits
+            uint64_t hash = static_cast<uint32_t>(node_x) & ~(~0u << 24);
+            hash <<= 16;
+            hash |= static_cast<uint32_t>(node_y) & ~(~0u << 16);
+            hash <<= 24;
+            hash |= static_cast<uint32_t>(node_z) & ~(~0u << 24);
+            hash ^= static_cast<uint64_t>(level) << 60;
+
+            // David Stafford's Mix13 for MurmurHash3's 64-bit finalizer
+            hash = (hash ^ (hash >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+            hash = (hash ^ (hash >> 27)) * UINT64_C(0x94D049BB133111EB);
+            hash = hash ^ (hash >> 31);
+
+            return hash;
+        }
+    };
+
+    std::mutex mutex;
+    std::unordered_map<NodeCoord, LodStoreEntry, NodeCoordHasher> nodes;
+    worldgen::ChunkGenerator<models::RenderingChunk::X_SIZE, models::RenderingChunk::Y_SIZE,
+                             models::RenderingChunk::Z_SIZE> generator;
+
+    MeshUploadQueue& mesh_uploads;
+
+    // Notified when nodes need meshing again. May be null.
+    WakeSignal* on_change;
+
+    // Generates a node from the heightmap
+    Task<> generate_node(models::RenderingChunk& chunk, unsigned int level, int node_x, int node_y, int node_z);
+
+    // Meshes a node on its own into out, which must hold render::max_chunk_instances, and returns its instances
+    Task<std::span<const render::VertexDataInstance>> mesh_node(const models::RenderingChunk& chunk, unsigned int level,
+                                                                int node_x, int node_y, int node_z,
+                                                                std::span<render::VertexDataInstance> out);
+
+    // Generates and meshes a node, queueing the mesh for upload, unless it is unloaded first.
+    Job load_node(unsigned int level, int node_x, int node_y, int node_z, std::stop_token unloaded);
+
+    LodStore operator=(const LodStore&) = delete;
+    LodStore(const LodStore&) = delete;
+
+public:
+    LodStore(uint32_t worldgen_seed, MeshUploadQueue& mesh_uploads, WakeSignal* on_change = nullptr)
+        : generator(worldgen_seed), mesh_uploads(mesh_uploads), on_change(on_change) {}
+
+    // Unloads nodes which are no longer near the rings around the camera, and loads the nodes in the rings which are
+    // not already loaded or need remeshing by sending the work to the given thread pool.
+    void load_rings_on_pool(ThreadPool& pool, int camera_chunk_x, int camera_chunk_z);
+
+    // Runs the given function for each loaded node while holding the lock.
+    void for_each_loaded(
+        const std::function<void(unsigned int level, int node_x, int node_y, int node_z, const LodStoreEntry&)>& f);
+
+    // Marks loaded nodes to be generated again on the next load_rings_on_pool, for when the renderer has freed their
+    // meshes.
+    void request_remesh(std::span<const std::tuple<unsigned int, int, int, int>> nodes);
+};
+
+}  // namespace mgr
@@ -2,21 +2,58 @@
 
 #include "threadpool.h"
 #include "sharedstate.h"
+#include "meshqueue.h"
 #include "chunkstore.h"
+#include "lodstore.h"
+#include "terrainstore.h"
+#include "interest.h"
+#include "wakesignal.h"
 #include <atomic>
+#include <vector>
 
 namespace mgr {
 
-// Thread running at a fixed rate which manages various game related tasks, using its own thread pool.
+// The id of the interest point around the player in the shared state
+constexpr uint64_t PLAYER_INTEREST_ID = 0;
+
+// The id of the interest point around where the player is predicted to be, from their velocity
+constexpr uint64_t PLAYER_PREFETCH_INTEREST_ID = 1;
+
+struct ManagerTickStats {
+    unsigned int ticks = 0;
+    float total_ms = 0;
+    float max_ms = 0;
+};
+
+// Thread which manages various game related tasks, using its own thread pool. It ticks when woken by a change to the
+// shared state or interest points, or by chunks needing meshing, at most once every MGR_MIN_TICK_INTERVAL.
+// Chunks are loaded around the player in the shared state and any other interest points, such as other players.
+// The player's chunks are also loaded ahead of them along their velocity, nearest and in view first.
 // The destructor will block until the manager thread has stopped.
 class Manager {
+    // Declared first, as the stores notify it until they are destroyed
+    WakeSignal wake_signal;
+
     // SAFETY: The chunk store will outlive the threads as the destructor of the ThreadPool will block until all threads
     // have stopped. The ThreadPool destructor will be called before the ChunkStore destructor as it is declared after.
+    MeshUploadQueue _mesh_uploads;
     ChunkStore _chunk_store;
+    LodStore _lod_store;
+    TerrainStore _terrain_store;
 
     std::thread manager_thread;
     SharedState _shared_state;
     std::atomic<bool> should_stop = false;
+
+    // Headless managers have no player, and only load chunks around the other interest points without meshing them
+    const bool headless;
+
+    std::mutex interest_mutex;
+    std::vector<InterestPoint> other_interest_points;
+
+    std::mutex tick_stats_mutex;
+    ManagerTickStats tick_stats;
+
     ThreadPool thread_pool;
 
     Manager operator=(const Manager&) = delete;
@@ -25,12 +62,32 @@ class Manager {
     void manager_main();
 
 public:
-    // Starts the manager thread.
-    Manager(SharedStateView initial_state, uint32_t worldgen_seed);
+    // Starts the manager thread. Meshes are staged in the given memory, which must outlive the manager.
+    Manager(SharedStateView initial_state, uint32_t worldgen_seed, std::span<uint8_t> mesh_staging_memory);
+
+    // Starts a headless manager thread, for servers
+    explicit Manager(uint32_t worldgen_seed);
+
     ~Manager();
 
+    // Replaces the interest points chunks are loaded around, other than the player. Ids must be unique and not
+    // PLAYER_INTEREST_ID or PLAYER_PREFETCH_INTEREST_ID.
+    void set_interest_points(std::vector<InterestPoint> points);
+
+    // Makes the manager tick soon, e.g. after changing something it acts on
+    void wake() { wake_signal.notify(); }
+
+    // Returns the tick stats since the last call, and resets them
+    ManagerTickStats take_tick_stats();
+
+    // The number of jobs waiting for a thread in the manager's pool, and chunk tasks waiting or running
+    size_t queued_jobs() { return thread_pool.queued() + _chunk_store.queued_tasks(); }
+
     SharedState& shared_state() { return _shared_state; }
+    MeshUploadQueue& mesh_uploads() { return _mesh_uploads; }
     ChunkStore& chunk_store() { return _chunk_store; }
+    LodStore& lod_store() { return _lod_store; }
+    TerrainStore& terrain_store() { return _terrain_store; }
 };
 
 }  // namespace mgr
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <span>
+#include <cstdint>
+#include "../render/visibility.h"
+
+namespace mgr {
+
+// A mesh in the staging ring waiting to be uploaded by the render thread.
+// Level 0 meshes are chunks, and higher levels are level of detail nodes.
+struct StagedMesh {
+    unsigned int level;
+    int x;
+    int y;
+    int z;
+
+    // The range of the staging ring holding the vertex data
+    size_t offset;
+    size_t size;
+
+    unsigned int instance_count;
+
+    render::ChunkCulling culling;
+};
+
+// Meshes taken from the queue, along with the staging ring space to release once the GPU has copied them out
+struct StagedBatch {
+    std::vector<StagedMesh> meshes;
+    size_t ring_bytes = 0;
+};
+
+// Hands meshes from the workers which generate them to the render thread which uploads them.
+// Workers copy each mesh straight into a ring of staging memory, which is mapped GPU memory when supported, so the
+// render thread only issues a GPU side copy. Ring space is released in order once those copies complete.
+// Workers wait for space when the ring is full, until the queue is closed.
+class MeshUploadQueue {
+    struct Slot {
+        StagedMesh mesh;
+
+        // Bytes of the ring used, including any skipped at the end of the ring before it
+        size_t ring_bytes;
+
+        // Set once the worker has finished copying the mesh into the ring
+        bool ready;
+    };
+
+    std::mutex mutex;
+    std::condition_variable space_cv;
+    std::span<uint8_t> ring;
+    size_t head = 0;
+    size_t used = 0;
+    std::deque<Slot> slots;
+
+    // The sequence number of the slot at the front of slots
+    uint64_t front_seq = 0;
+
+    uint64_t _stalls = 0;
+    bool closed = false;
+
+    MeshUploadQueue operator=(const MeshUploadQueue&) = delete;
+    MeshUploadQueue(const MeshUploadQueue&) = delete;
+
+public:
+    // The ring memory must outlive the queue
+    MeshUploadQueue(std::span<uint8_t> ring) : ring(ring) {}
+
+    // Copies a mesh into the ring, waiting for space if needed. Returns false if the queue was closed.
+    bool push(unsigned int level, int x, int y, int z, std::span<const uint8_t> vertex_data,
+              unsigned int instance_count, render::ChunkCulling culling);
+
+    // Takes the meshes which are ready, oldest first, stopping once the batch reaches the byte budget.
+    // At least one mesh is taken if any are ready, so meshes larger than the budget still get through.
+    StagedBatch take_ready(size_t byte_budget);
+
+    // Releases ring space from taken batches, which must be released in the order they were taken.
+    void release(size_t ring_bytes);
+
+    // Wakes any waiting workers and drops all later pushes, for shutting down.
+    void close();
+
+    // The number of times a worker has had to wait for space in the ring
+    uint64_t stalls();
+
+    // The bytes of the ring in use, including meshes not yet taken
+    size_t ring_used();
+};
+
+}  // namespace mgr
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace mgr {
+
+// Holds a value which is read far more often than it is written, such as state published by one thread each frame.
+// Reads never block or write shared memory, they only retry if a write happens at the same time. Writes are a few
+// stores, and are serialised with each other without a mutex.
+// The value is kept as atomic words, so any trivially copyable type works and a racing read is never undefined.
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable_v<T>, "values are copied word by word");
+
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    // Odd while a write is in progress
+    std::atomic<uint64_t> sequence = 0;
+    std::array<std::atomic<uint64_t>, WORDS> words;
+
+    void store_words(const T& value) {
+        std::array<uint64_t, WORDS> buffer{};
+        std::memcpy(buffer.data(), &value, sizeof(T));
+
+        for (size_t i = 0; i < WORDS; i++) words[i].store(buffer[i], std::memory_order::relaxed);
+    }
+
+    T load_words() const {
+        std::array<uint64_t, WORDS> buffer;
+        for (size_t i = 0; i < WORDS; i++) buffer[i] = words[i].load(std::memory_order::relaxed);
+
+        std::array<std::byte, sizeof(T)> bytes;
+        std::memcpy(bytes.data(), buffer.data(), sizeof(T));
+        return std::bit_cast<T>(bytes);
+    }
+
+public:
+    explicit SeqLock(const T& initial) { store_words(initial); }
+
+    T load() const {
+        while (true) {
+            const uint64_t before = sequence.load(std::memory_order::acquire);
+
+            if (before % 2 == 0) {
+                const T value = load_words();
+
+                // The words must be read before the sequence is checked again
+                std::atomic_thread_fence(std::memory_order::acquire);
+                if (sequence.load(std::memory_order::relaxed) == before) return value;
+            }
+
+            std::this_thread::yield();
+        }
+    }
+
+    // Replaces the value with f applied to a copy of it, returning the old and new values. f must not throw.
+    template <typename F>
+    std::pair<T, T> update(F&& f) {
+        // Taking the sequence from even to odd locks out other writers
+        uint64_t before = sequence.load(std::memory_order::relaxed);
+
+        while (before % 2 != 0 ||
+               !sequence.compare_exchange_weak(before, before + 1, std::memory_order::acquire,
+                                               std::memory_order::relaxed)) {
+            if (before % 2 != 0) {
+                std::this_thread::yield();
+                before = sequence.load(std::memory_order::relaxed);
+            }
+        }
+
+        // Readers must see the sequence go odd before any of the words change
+        std::atomic_thread_fence(std::memory_order::release);
+
+        const T old_value = load_words();
+        T new_value = old_value;
+        f(new_value);
+        store_words(new_value);
+
+        sequence.store(before + 2, std::memory_order::release);
+
+        return {old_value, new_value};
+    }
+
+    void store(const T& value) {
+        update([&value](T& current) { current = value; });
+    }
+};
+
+}  // namespace mgr
@@ -1,32 +1,46 @@
 #pragma once
 
-#include <mutex>
-#include <functional>
+#include <array>
+#include "seqlock.h"
+#include "wakesignal.h"
 
 namespace mgr {
 
 // A view (copy) of the shared state at a given time.
+// Fields can be added freely, as long as it stays trivially copyable.
 struct SharedStateView {
     int chunk_x;
     int chunk_y;
     int chunk_z;
+
+    // The player's velocity, in chunks per second
+    std::array<float, 3> velocity = {0.0f, 0.0f, 0.0f};
+
+    // The direction the player is looking in, as a unit vector
+    std::array<float, 3> view_direction = {1.0f, 0.0f, 0.0f};
+
+    bool operator==(const SharedStateView&) const = default;
 };
 
+// State published by the render thread for the manager, such as where the player is.
+// Reads are a few loads, which never wait unless a write is happening at the same time, so every thread can read it
+// as often as it likes.
 class SharedState {
-    std::mutex mutex;
-    SharedStateView state;
+    SeqLock<SharedStateView> state;
+
+    // Notified when the state changes
+    WakeSignal* on_change;
 
 public:
-    SharedState(SharedStateView initial_state) : state(initial_state) {}
+    SharedState(SharedStateView initial_state, WakeSignal* on_change = nullptr)
+        : state(initial_state), on_change(on_change) {}
 
-    SharedStateView get() {
-        std::scoped_lock<std::mutex> lock(mutex);
-        return state;
-    }
+    SharedStateView get() const { return state.load(); }
 
-    void modify(const std::function<void(SharedStateView&)>& f) {
-        std::scoped_lock<std::mutex> lock(mutex);
-        f(state);
+    template <typename F>
+    void modify(F&& f) {
+        const auto [old_state, new_state] = state.update(std::forward<F>(f));
+        if (new_state != old_state && on_change != nullptr) on_change->notify();
     }
 };
 
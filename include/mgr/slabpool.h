@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace mgr {
+
+constexpr size_t SLAB_BYTES = size_t{2} << 20;
+
+// Allocates SLAB_BYTES of memory aligned to SLAB_BYTES, so a slab can be backed by one huge page. Where supported, it
+// is marked for transparent huge pages if huge_pages is set. Throws std::bad_alloc on failure.
+void* allocate_slab(bool huge_pages);
+
+void free_slab(void* slab);
+
+// Fixed size slots for objects of one type, carved from slabs which are kept until the pool is destroyed, so objects
+// which come and go constantly, such as chunks, reuse the same memory rather than fragmenting the heap.
+// Objects must be destroyed before the pool. Not thread safe.
+template <typename T>
+class SlabPool {
+    union Slot {
+        Slot* next_free;
+        alignas(T) std::byte storage[sizeof(T)];
+    };
+
+    static constexpr size_t SLOTS_PER_SLAB = SLAB_BYTES / sizeof(Slot);
+    static_assert(SLOTS_PER_SLAB > 0, "objects must fit in a slab");
+
+    std::vector<void*> slabs;
+    Slot* free_slots = nullptr;
+    const bool huge_pages;
+
+    void grow() {
+        Slot* slab = static_cast<Slot*>(allocate_slab(huge_pages));
+        slabs.push_back(slab);
+
+        // Linked in address order, so objects created together are close together
+        for (size_t i = SLOTS_PER_SLAB; i-- > 0;) {
+            slab[i].next_free = free_slots;
+            free_slots = &slab[i];
+        }
+    }
+
+    SlabPool operator=(const SlabPool&) = delete;
+    SlabPool(const SlabPool&) = delete;
+
+public:
+    explicit SlabPool(bool huge_pages = false) : huge_pages(huge_pages) {}
+
+    ~SlabPool() {
+        for (void* slab : slabs) free_slab(slab);
+    }
+
+    template <typename... Args>
+    T* create(Args&&... args) {
+        if (free_slots == nullptr) grow();
+
+        Slot* slot = free_slots;
+        free_slots = slot->next_free;
+
+        try {
+            return new (slot->storage) T(std::forward<Args>(args)...);
+        } catch (...) {
+            slot->next_free = free_slots;
+            free_slots = slot;
+            throw;
+        }
+    }
+
+    void destroy(T* object) {
+        object->~T();
+
+        Slot* slot = reinterpret_cast<Slot*>(object);
+        slot->next_free = free_slots;
+        free_slots = slot;
+    }
+
+    // The memory held by the pool, including free slots
+    size_t bytes_reserved() const { return slabs.size() * SLAB_BYTES; }
+};
+
+}  // namespace mgr
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "chunkcoord.h"
+#include "threadpool.h"
+
+namespace mgr {
+
+// A stage of work on a chunk, numbered by the user of the graph
+struct TaskKey {
+    unsigned int stage;
+    ChunkCoord coord;
+
+    bool operator==(const TaskKey&) const = default;
+};
+
+struct TaskKeyHasher {
+    std::size_t operator()(const TaskKey& key) const { return ChunkCoordHasher()(key.coord) ^ key.stage; }
+};
+
+struct TaskGraphStats {
+    // Tasks added, and tasks not added because the same task was already waiting or running
+    uint64_t added = 0;
+    uint64_t deduplicated = 0;
+};
+
+// Runs tasks on a thread pool once the tasks they depend on have finished, such as meshing a chunk once it and its
+// neighbours have been generated. Ready tasks are run in priority order, lowest first. A task is only in the graph
+// while it is waiting or running, and adding the same task again meanwhile does nothing, so each stage runs once
+// however many later tasks need it.
+// At most max_running tasks are given to the pool at a time, so a task added later with a lower priority still runs
+// before the ones already waiting. Thread safe.
+// Chunks are loaded and meshed with the graph rather than as coroutine jobs (see job.h), which only suit a chain of
+// stages belonging to one job, like loading a LOD node. A chunk's mesh waits on the loads of 27 chunks, each shared
+// with the meshes of its neighbours and run once by priority across all chunks, and no stage waits partway through.
+class TaskGraph {
+    struct Task {
+        TaskKey key;
+        float priority;
+        std::function<void()> run;
+
+        // Dependencies which haven't finished
+        unsigned int waiting_on = 0;
+
+        // Tasks are never moved, as unordered_map nodes are stable
+        std::vector<Task*> dependents;
+    };
+
+    struct ReadyTask {
+        float priority;
+        uint64_t order;
+        Task* task;
+
+        // Lowest priority first, then oldest first
+        bool operator<(const ReadyTask& other) const {
+            return priority != other.priority ? priority > other.priority : order > other.order;
+        }
+    };
+
+    std::mutex mutex;
+    std::unordered_map<TaskKey, Task, TaskKeyHasher> tasks;
+    std::priority_queue<ReadyTask> ready;
+    uint64_t next_order = 0;
+
+    const size_t max_running;
+    size_t running = 0;
+
+    TaskGraphStats stats;
+
+    // The pool given to the last start, which tasks are given to as others finish
+    ThreadPool* pool = nullptr;
+
+    // Adds a task without its function, or returns null if it is already in the graph. Must hold the mutex.
+    Task* insert(const TaskKey& key, float priority, std::span<const TaskKey> dependencies);
+
+    // Gives ready tasks to the pool up to max_running. Must hold the mutex.
+    void dispatch();
+
+    // Runs a task, then finishes it. An exception thrown by the task is reported to stderr rather than ending the
+    // program, and its dependents still run.
+    void run_task(Task* task);
+
+    // Releases the dependents of a task which has run, and removes it from the graph
+    void finish_task(Task* task);
+
+public:
+    explicit TaskGraph(size_t max_running) : max_running(max_running) {}
+
+    // Adds a task which runs once all of the given tasks which are still in the graph have finished, and returns
+    // whether it was added. It isn't if the same task is already waiting or running.
+    // Dependencies which aren't in the graph are taken to have finished, so they must be added first.
+    template <typename F>
+    bool add(const TaskKey& key, float priority, std::span<const TaskKey> dependencies, F&& run) {
+        std::scoped_lock<std::mutex> lock(mutex);
+
+        // The function is only made once the task is known to be new, as it may allocate
+        Task* task = insert(key, priority, dependencies);
+        if (task == nullptr) return false;
+
+        task->run = std::forward<F>(run);
+        return true;
+    }
+
+    // Starts running the ready tasks on the pool, e.g. after adding some. The pool must outlive the tasks.
+    void start(ThreadPool& pool);
+
+    // Whether a task is waiting or running
+    bool contains(const TaskKey& key);
+
+    // The number of tasks waiting or running
+    size_t size();
+
+    // Returns the stats since the last call, and resets them
+    TaskGraphStats take_stats();
+};
+
+}  // namespace mgr
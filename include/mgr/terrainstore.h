@@ -0,0 +1,76 @@
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+#include <functional>
+#include <tuple>
+#include <atomic>
+#include <vector>
+#include "../worldgen/generator.h"
+#include "threadpool.h"
+
+namespace mgr {
+
+struct TerrainTile {
+    // (FAR_TERRAIN_TILE_RESOLUTION + 1)^2 surface heights in blocks, row major along x
+    std::vector<float> heights;
+
+    // False while the tile is queued to be generated
+    bool loaded = false;
+};
+
+// SAFETY: TerrainStore must outlive the thread pool!!
+// A store for the heightmap tiles of the far terrain, drawn in the rings beyond the level of detail rings.
+// A tile at level L covers 2^L chunks along x and z, the same as a level of detail node, and is sampled straight from
+// the heightmap without generating any chunks.
+// Tiles are unloaded once they are outside the rings around the camera.
+class TerrainStore {
+    using TileCoord = std::tuple<unsigned int, int, int>;
+
+    struct TileCoordHasher {
+        std::size_t operator()(const TileCoord& coord) const {
+            const auto [level, tile_x, tile_z] = coord;
+
+            uint64_t hash = static_cast<uint32_t>(tile_x);
+            hash <<= 32;
+            hash |= static_cast<uint32_t>(tile_z);
+            hash ^= static_cast<uint64_t>(level) << 56;
+
+            // David Stafford's Mix13 for MurmurHash3's 64-bit finalizer
+            hash = (hash ^ (hash >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+            hash = (hash ^ (hash >> 27)) * UINT64_C(0x94D049BB133111EB);
+            hash = hash ^ (hash >> 31);
+
+            return hash;
+        }
+    };
+
+    std::mutex mutex;
+    std::unordered_map<TileCoord, TerrainTile, TileCoordHasher> tiles;
+    worldgen::ChunkGenerator<models::RenderingChunk::X_SIZE, models::RenderingChunk::Y_SIZE,
+                             models::RenderingChunk::Z_SIZE> generator;
+
+    // Incremented whenever a tile is loaded
+    std::atomic<uint64_t> _tile_version = 0;
+
+    // Samples a tile, storing it if it is still wanted.
+    void load_tile(unsigned int level, int tile_x, int tile_z);
+
+    TerrainStore operator=(const TerrainStore&) = delete;
+    TerrainStore(const TerrainStore&) = delete;
+
+public:
+    TerrainStore(uint32_t worldgen_seed) : generator(worldgen_seed) {}
+
+    // Unloads tiles which are no longer near the rings around the camera, and loads the tiles in the rings which are
+    // not already loaded by sending the work to the given thread pool.
+    void load_rings_on_pool(ThreadPool& pool, int camera_chunk_x, int camera_chunk_z);
+
+    // Runs the given function for each loaded tile while holding the lock.
+    void for_each_loaded(const std::function<void(unsigned int level, int tile_x, int tile_z, const TerrainTile&)>& f);
+
+    // A counter which changes whenever a tile is loaded.
+    uint64_t tile_version() const { return _tile_version.load(std::memory_order::relaxed); }
+};
+
+}  // namespace mgr
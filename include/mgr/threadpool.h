@@ -1,6 +1,7 @@
 #pragma once
 
-#include <queue>
+#include <coroutine>
+#include <deque>
 #include <functional>
 #include <mutex>
 #include <condition_variable>
@@ -9,10 +10,18 @@
 
 namespace mgr {
 
+// A job which resumes a suspended coroutine. If the pool stops with it still queued, the coroutine is destroyed
+// instead, which frees its frame and runs the destructors of its locals.
+struct ResumeJob {
+    std::coroutine_handle<> handle;
+
+    void operator()() const { handle.resume(); }
+};
+
 // A fixed size thread pool (until stopped)
 // The destructor will block until all threads have stopped.
 class ThreadPool {
-    std::queue<std::function<void()>> jobs;
+    std::deque<std::function<void()>> jobs;
     std::mutex jobs_mutex;
     std::condition_variable jobs_cv;
     std::vector<std::thread> threads;
@@ -30,10 +39,20 @@ public:
     // Enqueues a job to be run by a thread in the pool.
     void enqueue(const std::function<void()>& job);
 
+    // Enqueues a job like enqueue, but returns false instead of throwing if the pool has stopped.
+    bool try_enqueue(const std::function<void()>& job);
+
     // Enqueues a list of jobs to be run by threads in the pool.
     void enqueue(std::span<const std::function<void()>> jobs_todo);
 
-    // Stops and destroys all threads in the pool, clearing any queued jobs.
+    // Enqueues a job to be run before any already queued, e.g. one picked by priority just before it can run.
+    // Returns false without enqueueing it if the pool has stopped, so jobs can queue more work while it stops.
+    bool enqueue_next(const std::function<void()>& job);
+
+    // The number of jobs waiting for a thread, not including those running.
+    size_t queued();
+
+    // Stops and destroys all threads in the pool, clearing any queued jobs and destroying queued coroutines.
     // Blocks until all threads have stopped.
     void stop();
 };
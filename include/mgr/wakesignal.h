@@ -0,0 +1,45 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace mgr {
+
+// Wakes a thread waiting for work. Notifications made before it wakes are coalesced into one.
+class WakeSignal {
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    // The time of the first notification since the last wait, if any
+    std::optional<std::chrono::steady_clock::time_point> first_pending;
+
+public:
+    void notify() {
+        {
+            std::scoped_lock<std::mutex> lock(mutex);
+            if (first_pending) return;
+            first_pending = std::chrono::steady_clock::now();
+        }
+
+        cv.notify_one();
+    }
+
+    // Drops notifications made since the last wait, e.g. because the waiting thread is about to act on them anyway
+    void clear() {
+        std::scoped_lock<std::mutex> lock(mutex);
+        first_pending.reset();
+    }
+
+    // Waits until notified or the deadline passes. Returns the time of the first notification since the last wait,
+    // which is cleared, or nothing if it timed out.
+    std::optional<std::chrono::steady_clock::time_point> wait_until(std::chrono::steady_clock::time_point deadline) {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait_until(lock, deadline, [this] { return first_pending.has_value(); });
+        return std::exchange(first_pending, std::nullopt);
+    }
+};
+
+}  // namespace mgr
@@ -1,46 +1,31 @@
 #pragma once
 
-#include <string>
-#include "../gfxm/matrix.h"
-#include <memory>
+#include <string_view>
+#include <assert.h>
+#include "blockregistry.h"
 
 namespace models {
 
-using BlockId = unsigned short;
-
-struct BlockInfo {
-    std::string name;
-    bool opaque;
-};
-
-constexpr BlockId EMPTY_BLOCK = 0;
-constexpr BlockId STONE_BLOCK = 1;
-constexpr BlockId DIRT_BLOCK = 2;
-
-constexpr std::array<BlockInfo, 3> BUILTIN_BLOCKS = {
-    BlockInfo{.name = "empty", .opaque = false},
-    BlockInfo{.name = "stone", .opaque = true},
-    BlockInfo{.name = "dirt", .opaque = true},
-};
-
+// A block in a chunk, whose properties come from the active block registry
 class Block {
     BlockId _id;
 
-    constexpr const BlockInfo& info() const { return BUILTIN_BLOCKS[_id]; }
-
 public:
     constexpr Block() { _id = EMPTY_BLOCK; }
 
-    constexpr Block(BlockId bid) {
-        assert(bid < BUILTIN_BLOCKS.size());
-        _id = bid;
-    }
+    constexpr Block(BlockId bid) { _id = bid; }
 
     constexpr BlockId id() const { return _id; }
 
-    constexpr std::string name() const { return info().name; }
+    std::string_view name() const { return active_block_registry.name(_id); }
+
+    bool opaque() const { return active_block_registry.opaque(_id); }
+
+    // The block light level emitted by the block, from 0 to 15
+    unsigned char light_emission() const { return active_block_registry.light_emission(_id); }
 
-    constexpr bool opaque() const { return info().opaque; }
+    // The texture layer of a face, with faces in the order of BlockRegistry::face_texture
+    uint16_t face_texture(unsigned int face) const { return active_block_registry.face_texture(_id, face); }
 };
 
 }  // namespace models
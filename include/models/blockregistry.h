@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace models {
+
+using BlockId = unsigned short;
+
+constexpr BlockId EMPTY_BLOCK = 0;
+constexpr BlockId STONE_BLOCK = 1;
+constexpr BlockId DIRT_BLOCK = 2;
+
+// The properties of every block type, loaded at startup.
+// Hot properties are kept in flat tables indexed by block id, so meshing and lighting can look them up directly.
+// Block 0 is always the empty block.
+class BlockRegistry {
+    std::vector<std::string> names;
+    std::vector<uint64_t> opaque_bits;
+    std::vector<uint64_t> collides_bits;
+    std::vector<uint8_t> light_emissions;
+
+    // Texture layers for each face of each block, in the order of block_face_texture
+    std::vector<std::array<uint16_t, 6>> face_textures;
+
+    // The textures used by the blocks, by layer
+    std::vector<std::string> _texture_names;
+
+    // Allows looking up strings by string_view without copying them
+    struct StringHasher {
+        using is_transparent = void;
+        size_t operator()(std::string_view s) const { return std::hash<std::string_view>()(s); }
+    };
+
+    // Indices of the names and textures, so loading thousands of blocks doesn't search them for each one
+    std::unordered_map<std::string, BlockId, StringHasher, std::equal_to<>> ids_by_name;
+    std::unordered_map<std::string, uint16_t, StringHasher, std::equal_to<>> layers_by_texture;
+
+    static bool test_bit(const std::vector<uint64_t>& bits, BlockId id) { return (bits[id >> 6] >> (id & 63)) & 1; }
+
+    // Adds a block, with textures named by face. Returns its id.
+    BlockId add(std::string_view name, bool opaque, bool collides, uint8_t light_emission,
+                const std::array<std::string, 6>& textures);
+
+public:
+    // The empty block, stone and dirt, which the world generator uses
+    static BlockRegistry builtin();
+
+    // Loads blocks from a text file, after the empty block. Each line is
+    //   name opaque light_emission collides texture [bottom_texture side_texture]
+    // with 0 or 1 for flags, and textures named by their file in the assets directory without the extension. A single
+    // texture is used for every face, otherwise the first is for the top. Blank lines and lines starting with # are
+    // skipped. Throws if the file is invalid or leaves out a block the world generator uses.
+    static BlockRegistry load(const std::string& path);
+
+    size_t size() const { return names.size(); }
+
+    std::string_view name(BlockId id) const { return names[id]; }
+    bool opaque(BlockId id) const { return test_bit(opaque_bits, id); }
+    bool collides(BlockId id) const { return test_bit(collides_bits, id); }
+
+    // The block light level emitted by a block, from 0 to 15
+    uint8_t light_emission(BlockId id) const { return light_emissions[id]; }
+
+    // The texture layer of a face of a block. Faces are front (-z), left (-x), back (+z), right (+x), bottom (-y) and
+    // top (+y), the same order as the rotations used for meshing.
+    uint16_t face_texture(BlockId id, unsigned int face) const { return face_textures[id][face]; }
+
+    const std::vector<std::string>& texture_names() const { return _texture_names; }
+
+    // Returns the id of the block with the given name, or EMPTY_BLOCK if there isn't one
+    BlockId find(std::string_view name) const;
+};
+
+// The registry used by Block, which starts as the builtin one
+inline BlockRegistry active_block_registry = BlockRegistry::builtin();
+
+// Replaces the registry used by Block. Must be called before any threads use blocks.
+inline void set_block_registry(BlockRegistry registry) { active_block_registry = std::move(registry); }
+
+}  // namespace models
@@ -24,8 +24,31 @@ public:
         assert(x < X_SIZE && y < Y_SIZE && z < Z_SIZE);
         return blocks[x + y * X_SIZE + z * X_SIZE * Y_SIZE];
     }
+
+    // Returns the block at an index into the chunk, ordered by x then y then z.
+    const Block& block_at(unsigned int i) const {
+        assert(i < blocks.size());
+        return blocks[i];
+    }
+
+    Block& block_at(unsigned int i) {
+        assert(i < blocks.size());
+        return blocks[i];
+    }
 };
 
-using RenderingChunk = Chunk<16, 16, 16>;
+// The size of the chunks the world is loaded, meshed and drawn in, chosen when building (see CMakeLists.txt), e.g.
+// 32 for fewer, larger chunks, or a Y size of 256 for columns
+#ifndef VOXEL_CHUNK_X_SIZE
+#define VOXEL_CHUNK_X_SIZE 16
+#endif
+#ifndef VOXEL_CHUNK_Y_SIZE
+#define VOXEL_CHUNK_Y_SIZE 16
+#endif
+#ifndef VOXEL_CHUNK_Z_SIZE
+#define VOXEL_CHUNK_Z_SIZE 16
+#endif
+
+using RenderingChunk = Chunk<VOXEL_CHUNK_X_SIZE, VOXEL_CHUNK_Y_SIZE, VOXEL_CHUNK_Z_SIZE>;
 
 }  // namespace models
\ No newline at end of file
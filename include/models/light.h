@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <assert.h>
+#include "chunk.h"
+
+namespace models {
+
+using LightLevel = uint8_t;
+
+constexpr LightLevel MIN_LIGHT = 0;
+constexpr LightLevel MAX_LIGHT = 15;
+
+// The light levels of each voxel in a chunk.
+// Each voxel stores a sky light nibble (high) and a block light nibble (low) in one byte, indexed the same as the
+// blocks of a Chunk.
+template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
+class ChunkLight {
+    std::array<uint8_t, X_SIZE * Y_SIZE * Z_SIZE> levels;
+
+public:
+    ChunkLight() noexcept { levels.fill(0); }
+
+    static constexpr unsigned int index(unsigned int x, unsigned int y, unsigned int z) {
+        assert(x < X_SIZE && y < Y_SIZE && z < Z_SIZE);
+        return x + y * X_SIZE + z * X_SIZE * Y_SIZE;
+    }
+
+    // The packed sky and block light at the given index
+    uint8_t packed(unsigned int i) const { return levels[i]; }
+
+    LightLevel sky(unsigned int i) const { return levels[i] >> 4; }
+    LightLevel block(unsigned int i) const { return levels[i] & 0xF; }
+
+    void set_sky(unsigned int i, LightLevel level) {
+        assert(level <= MAX_LIGHT);
+        levels[i] = (levels[i] & 0x0F) | (level << 4);
+    }
+
+    void set_block(unsigned int i, LightLevel level) {
+        assert(level <= MAX_LIGHT);
+        levels[i] = (levels[i] & 0xF0) | level;
+    }
+
+    uint8_t packed(unsigned int x, unsigned int y, unsigned int z) const { return packed(index(x, y, z)); }
+};
+
+// The packed light levels of a chunk, along with a one voxel border taken from its neighbours.
+// Indices range from -1 to SIZE inclusive on each axis. Used for meshing without access to the neighbouring chunks.
+template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
+class PaddedChunkLight {
+    static constexpr int PX = X_SIZE + 2;
+    static constexpr int PY = Y_SIZE + 2;
+    static constexpr int PZ = Z_SIZE + 2;
+
+    std::array<uint8_t, PX * PY * PZ> levels;
+
+public:
+    PaddedChunkLight() noexcept { levels.fill(MAX_LIGHT << 4); }
+
+    uint8_t operator[](int x, int y, int z) const {
+        assert(x >= -1 && x <= X_SIZE && y >= -1 && y <= Y_SIZE && z >= -1 && z <= Z_SIZE);
+        return levels[(x + 1) + (y + 1) * PX + (z + 1) * PX * PY];
+    }
+
+    uint8_t& operator[](int x, int y, int z) {
+        assert(x >= -1 && x <= X_SIZE && y >= -1 && y <= Y_SIZE && z >= -1 && z <= Z_SIZE);
+        return levels[(x + 1) + (y + 1) * PX + (z + 1) * PX * PY];
+    }
+};
+
+using RenderingChunkLight = ChunkLight<RenderingChunk::X_SIZE, RenderingChunk::Y_SIZE, RenderingChunk::Z_SIZE>;
+
+}  // namespace models
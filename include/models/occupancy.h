@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <algorithm>
+#include <assert.h>
+#include "chunk.h"
+
+namespace models {
+
+// Bitmask of which voxels of a chunk are opaque, along with a one voxel border (including edges and corners) taken
+// from its neighbours. Indices range from -1 to SIZE inclusive on each axis.
+// Each row along x is a single word, so neighbour tests during meshing are a shift and a mask.
+template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
+class PaddedOccupancy {
+    static_assert(X_SIZE + 2 <= 64, "rows of the padded chunk must fit in 64 bits");
+
+    static constexpr int PY = Y_SIZE + 2;
+    static constexpr int PZ = Z_SIZE + 2;
+
+    std::array<uint64_t, PY * PZ> rows;
+
+public:
+    PaddedOccupancy() noexcept { rows.fill(0); }
+
+    bool operator[](int x, int y, int z) const {
+        assert(x >= -1 && x <= X_SIZE && y >= -1 && y <= Y_SIZE && z >= -1 && z <= Z_SIZE);
+        return (rows[(y + 1) + (z + 1) * PY] >> (x + 1)) & 1;
+    }
+
+    // Fills the mask from a chunk and its neighbours, indexed by (dx + 1) + (dy + 1) * 3 + (dz + 1) * 9, so the
+    // chunk itself is at 13.
+    // Borders with unloaded (null) neighbours are copied from the nearest voxel in the chunk.
+    void fill(const std::array<const Chunk<X_SIZE, Y_SIZE, Z_SIZE>*, 27>& chunks) {
+        const Chunk<X_SIZE, Y_SIZE, Z_SIZE>* centre = chunks[13];
+        assert(centre != nullptr);
+
+        for (int z = -1; z <= Z_SIZE; z++) {
+            const int dz = z < 0 ? -1 : (z >= Z_SIZE ? 1 : 0);
+
+            for (int y = -1; y <= Y_SIZE; y++) {
+                const int dy = y < 0 ? -1 : (y >= Y_SIZE ? 1 : 0);
+
+                uint64_t row = 0;
+
+                for (int x = -1; x <= X_SIZE; x++) {
+                    const int dx = x < 0 ? -1 : (x >= X_SIZE ? 1 : 0);
+                    const Chunk<X_SIZE, Y_SIZE, Z_SIZE>* chunk = chunks[(dx + 1) + (dy + 1) * 3 + (dz + 1) * 9];
+
+                    bool opaque;
+                    if (chunk != nullptr) {
+                        opaque = (*chunk)[x - dx * X_SIZE, y - dy * Y_SIZE, z - dz * Z_SIZE].opaque();
+                    } else {
+                        opaque = (*centre)[std::clamp(x, 0, X_SIZE - 1), std::clamp(y, 0, Y_SIZE - 1),
+                                           std::clamp(z, 0, Z_SIZE - 1)]
+                                     .opaque();
+                    }
+
+                    row |= (uint64_t)opaque << (x + 1);
+                }
+
+                rows[(y + 1) + (z + 1) * PY] = row;
+            }
+        }
+    }
+};
+
+}  // namespace models
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <vector>
+#include "../models/chunk.h"
+#include "../mgr/chunkcoord.h"
+
+namespace net {
+
+// The first byte of each record
+enum class RecordType : uint8_t { CHUNK = 1, BLOCK_EDITS = 2 };
+
+// The most distinct blocks an encoded chunk can contain, which is as many as any chunk can hold
+template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
+constexpr size_t max_palette_size() {
+    return std::min((size_t)X_SIZE * Y_SIZE * Z_SIZE, (size_t)std::numeric_limits<models::BlockId>::max() + 1);
+}
+
+// Chunk records are
+//   type, chunk x, y and z, palette size, palette block ids, run count, packed runs, run lengths
+// where integers are LEB128 varints, signed ones zigzag encoded. Blocks are run length encoded in the order of
+// Chunk::block_at, and each run's index into the palette is packed into the fewest bits which fit the palette, least
+// significant bit first. Run lengths follow as varints of the length minus one.
+
+// An upper bound on the size of an encoded chunk
+template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
+constexpr size_t max_encoded_chunk_size() {
+    constexpr size_t blocks = (size_t)X_SIZE * Y_SIZE * Z_SIZE;
+
+    // Every block its own run, each with a full palette index, a maximal length varint and a maximal palette
+    return 1 + 3 * 5 + 3 + max_palette_size<X_SIZE, Y_SIZE, Z_SIZE>() * 3 + 5 + blocks * 2 + blocks * 3;
+}
+
+// Encodes a chunk into the start of out, which must be at least max_encoded_chunk_size bytes, and returns the bytes
+// written. Nothing is allocated, so chunks can be encoded straight from the chunk store into a send buffer.
+template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
+size_t encode_chunk(const models::Chunk<X_SIZE, Y_SIZE, Z_SIZE>& chunk, int chunk_x, int chunk_y, int chunk_z,
+                    std::span<uint8_t> out);
+
+// Decodes a chunk record from the start of in into a chunk, e.g. one from a ChunkPool, and returns the bytes read.
+// Nothing is allocated. Throws std::runtime_error if the record is invalid or cut short.
+template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
+size_t decode_chunk(std::span<const uint8_t> in, models::Chunk<X_SIZE, Y_SIZE, Z_SIZE>& chunk, int& chunk_x,
+                    int& chunk_y, int& chunk_z);
+
+// A change to one block of a chunk, by its index in the order of Chunk::block_at
+struct BlockEdit {
+    uint32_t index;
+    models::BlockId block;
+};
+
+// Block edit records are
+//   type, chunk x, y and z, edit count, then for each edit the difference from the last index and the block id
+// with edits sorted by index, as varints.
+
+// An upper bound on the size of an encoded block edit record
+constexpr size_t max_encoded_block_edits_size(size_t edits) { return 1 + 3 * 5 + 5 + edits * (5 + 3); }
+
+// Encodes edits to one chunk into the start of out, which must be at least max_encoded_block_edits_size bytes, and
+// returns the bytes written. The edits are sorted in place, and only the last edit to each block is kept.
+size_t encode_block_edits(int chunk_x, int chunk_y, int chunk_z, std::span<BlockEdit> edits, std::span<uint8_t> out);
+
+// Reads the edits of a block edit record in place, without allocating.
+// Throws std::runtime_error if the record is invalid or cut short, including edits past the end of the chunk.
+class BlockEditReader {
+    std::span<const uint8_t> data;
+    size_t pos = 0;
+    uint32_t remaining;
+    uint32_t index = 0;
+    uint32_t blocks;
+
+public:
+    int chunk_x;
+    int chunk_y;
+    int chunk_z;
+
+    // Reads the header of the record at the start of in, for chunks of the given number of blocks
+    BlockEditReader(std::span<const uint8_t> in, uint32_t blocks);
+
+    // Reads the next edit, returning false once they have all been read
+    bool next(BlockEdit& edit);
+
+    // The bytes of the record read so far, which is the size of the record once every edit has been read
+    size_t bytes_read() const { return pos; }
+};
+
+// Collects block edits by chunk, for sending as one record per chunk
+template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
+class BlockEditBatcher {
+    std::unordered_map<mgr::ChunkCoord, std::vector<BlockEdit>, mgr::ChunkCoordHasher> chunks;
+    size_t edit_count = 0;
+
+public:
+    // Adds an edit of the block at the given world voxel coordinates
+    void add(int x, int y, int z, models::BlockId block);
+
+    // Appends a record for each chunk with edits to out, and clears the batch.
+    void flush(std::vector<uint8_t>& out);
+
+    bool empty() const { return edit_count == 0; }
+};
+
+// Reusable chunks to decode into, so a stream of chunks doesn't allocate one each. Not thread safe.
+template <typename Chunk>
+class ChunkPool {
+    std::vector<std::unique_ptr<Chunk>> free_chunks;
+
+public:
+    // Returns a chunk from the pool, or a new one if it is empty. The blocks are left as they were.
+    std::unique_ptr<Chunk> acquire() {
+        if (free_chunks.empty()) return std::make_unique<Chunk>();
+
+        std::unique_ptr<Chunk> chunk = std::move(free_chunks.back());
+        free_chunks.pop_back();
+        return chunk;
+    }
+
+    void release(std::unique_ptr<Chunk> chunk) { free_chunks.push_back(std::move(chunk)); }
+};
+
+}  // namespace net
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+#include <optional>
+#include <vector>
+#include <tuple>
+#include <cstdint>
+#include "visibility.h"
+#include "occlusion.h"
+
+namespace render {
+
+// Identifies a mesh on the GPU by its level of detail and node coordinates, level 0 being chunks
+using MeshKey = std::tuple<unsigned int, int, int, int>;
+
+struct MeshKeyHasher {
+    std::size_t operator()(const MeshKey &key) const {
+        const auto [level, x, y, z] = key;
+
+        // Same layout as the chunk coordinate hash, with the level in the top bits
+        uint64_t hash = static_cast<uint32_t>(x) & ~(~0u << 24);
+        hash <<= 16;
+        hash |= static_cast<uint32_t>(y) & ~(~0u << 16);
+        hash <<= 24;
+        hash |= static_cast<uint32_t>(z) & ~(~0u << 24);
+        hash ^= static_cast<uint64_t>(level) << 60;
+
+        // David Stafford's Mix13 for MurmurHash3's 64-bit finalizer
+        hash = (hash ^ (hash >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+        hash = (hash ^ (hash >> 27)) * UINT64_C(0x94D049BB133111EB);
+        hash = hash ^ (hash >> 31);
+
+        return hash;
+    }
+};
+
+// The layout glMultiDrawElementsIndirect reads each draw from
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instance_count;
+    GLuint first_index;
+    GLint base_vertex;
+    GLuint base_instance;
+};
+
+// A mesh on the GPU along with the command which draws it
+struct MeshDraw {
+    MeshKey key;
+    DrawElementsIndirectCommand command;
+    ChunkCulling culling;
+};
+
+// The camera chunk which culling is done from, and how far to walk chunk visibility
+struct CullingOrigin {
+    int chunk_x;
+    int chunk_y;
+    int chunk_z;
+    int radius;
+};
+
+// The commands drawing the visible meshes, built from the meshes of the renderer as they were at mesh_generation
+struct DrawList {
+    uint64_t mesh_generation = 0;
+    std::vector<MeshKey> keys;
+    std::vector<DrawElementsIndirectCommand> commands;
+
+    // Boxes made from the solid parts of the chunks near the camera, for the software depth buffer
+    std::vector<Aabb> occluders;
+};
+
+// The world space bounds of a mesh
+Aabb mesh_bounds(const MeshKey &key);
+
+// Builds draw lists on its own thread, so the render thread only has to snapshot its meshes and submit the result.
+// The destructor will block until the builder thread has stopped.
+class DrawListBuilder {
+    struct Request {
+        std::vector<MeshDraw> meshes;
+        uint64_t mesh_generation;
+        CullingOrigin culling_origin;
+        std::function<bool(const MeshKey &, unsigned int instance_count)> visible;
+    };
+
+    std::mutex mutex;
+    std::condition_variable request_cv;
+    std::optional<Request> pending;
+    std::optional<DrawList> built;
+    bool should_stop = false;
+    std::thread builder_thread;
+
+    void builder_main();
+
+    DrawListBuilder(const DrawListBuilder &) = delete;
+    DrawListBuilder &operator=(const DrawListBuilder &) = delete;
+
+public:
+    // Starts the builder thread.
+    DrawListBuilder();
+    ~DrawListBuilder();
+
+    // Builds a draw list of the meshes for which visible is true, replacing any request which has not started yet.
+    // The predicate is run on the builder thread. Chunks which can't be seen from the camera chunk are left out too, and
+    // occluders are made from the chunks near it.
+    void request(std::vector<MeshDraw> meshes, uint64_t mesh_generation, CullingOrigin culling_origin,
+                 std::function<bool(const MeshKey &, unsigned int instance_count)> visible);
+
+    // Takes the latest draw list built since the last call, if any
+    std::optional<DrawList> take();
+};
+
+}  // namespace render
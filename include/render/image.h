@@ -1,10 +1,41 @@
 #pragma once
 
-#include <vector>
+#include <cstdint>
+#include <span>
 #include <string>
+#include "mappedfile.h"
+
+struct spng_ctx;
 
 namespace render {
 
-std::vector<char> load_png_rgb8(const std::string& path, unsigned int& width, unsigned int& height);
+// A PNG file mapped into memory with its header read, ready to be decoded straight into memory chosen by the caller,
+// such as a texture array being built or a mapped buffer.
+class PngImage {
+    MappedFile file;
+    spng_ctx *ctx;
+    std::string path;
+    unsigned int _width;
+    unsigned int _height;
+
+    PngImage(const PngImage &) = delete;
+    PngImage &operator=(const PngImage &) = delete;
+
+public:
+    // Throws if the file can't be opened or its header is invalid
+    explicit PngImage(const std::string &path);
+    ~PngImage();
+
+    unsigned int width() const { return _width; }
+    unsigned int height() const { return _height; }
+
+    // The bytes taken by the image decoded as RGB8
+    size_t rgb8_size() const { return (size_t)_width * _height * 3; }
+
+    // Decodes the image as tightly packed RGB8 rows into out, which must be rgb8_size() bytes.
+    // Rows are decoded one at a time into their place in out, so nothing else is allocated for the pixels.
+    // Throws if the image is invalid. Can only be called once.
+    void decode_rgb8(std::span<uint8_t> out);
+};
 
-}
\ No newline at end of file
+}  // namespace render
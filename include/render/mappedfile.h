@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace render {
+
+// A read only view of a whole file. The file is memory mapped where supported, otherwise read into memory in one go.
+class MappedFile {
+    std::span<const uint8_t> _data;
+    std::vector<uint8_t> fallback;
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+public:
+    // Throws if the file can't be opened
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+
+    std::span<const uint8_t> data() const { return _data; }
+};
+
+}  // namespace render
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include "../models/chunk.h"
+#include "../models/light.h"
+#include "../models/occupancy.h"
+
+namespace render {
+
+// The corners of the quad every face is drawn from
+inline constexpr std::array<float, 12> FACE_VERTS = {
+    -1.0f, 1.0f,  -1.0f,  // top left
+    -1.0f, -1.0f, -1.0f,  // bottom left
+    1.0f,  1.0f,  -1.0f,  // top right
+    1.0f,  -1.0f, -1.0f,  // bottom right
+};
+
+// The data of each face drawn, one instance of FACE_VERTS
+struct __attribute__((packed)) VertexDataInstance {
+    std::array<float, 3> position;
+    float rotation;
+    float xScale;
+    float yScale;
+    float texID;
+    float light;
+    float ao;
+};
+
+// The most instances a chunk can be meshed into, with every face of every voxel drawn
+template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
+constexpr size_t max_chunk_instances() {
+    return size_t{6} * X_SIZE * Y_SIZE * Z_SIZE;
+}
+
+// Generates the instance data for the faces of a chunk, lit by the light of the voxel in front of each face.
+// If occupancy is not null, per-corner ambient occlusion is calculated from it, otherwise faces are unoccluded.
+// Each voxel is scale blocks wide, for meshing level of detail nodes, in which case the coordinates are node coordinates.
+// Instances are written straight into out, which must hold max_chunk_instances, and the start of out holding them is
+// returned. Nothing is allocated, so a buffer can be reused for every chunk, and only the pages written are touched.
+template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
+std::span<const VertexDataInstance> generate_chunk_vertex_data(
+    const models::Chunk<X_SIZE, Y_SIZE, Z_SIZE> &chunk, const models::PaddedChunkLight<X_SIZE, Y_SIZE, Z_SIZE> &light,
+    const models::PaddedOccupancy<X_SIZE, Y_SIZE, Z_SIZE> *occupancy, int chunk_x, int chunk_y, int chunk_z,
+    std::span<VertexDataInstance> out, unsigned int scale = 1);
+
+// The bytes of instances, as uploaded
+inline std::span<const uint8_t> instance_bytes(std::span<const VertexDataInstance> instances) {
+    return {(const uint8_t *)instances.data(), instances.size_bytes()};
+}
+
+}  // namespace render
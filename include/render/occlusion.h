@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include "../gfxm/matrix.h"
+
+namespace render {
+
+// An axis aligned box in world coordinates
+struct Aabb {
+    std::array<float, 3> min;
+    std::array<float, 3> max;
+};
+
+// A low resolution software depth buffer for culling boxes hidden behind occluders, without waiting on the GPU.
+// Occluders are rasterized with AVX2, 8 pixels at a time, storing the inverse of the clip w of the nearest occluder so
+// depth interpolates linearly across the screen.
+// Culling is conservative: occluders which are too close to the camera are skipped, and any box which is too close is
+// visible.
+class OcclusionBuffer {
+    unsigned int width;
+    unsigned int height;
+    std::vector<float> inverse_depth;
+
+    gfxm::Matrix<4, 4> projview;
+
+    struct ScreenVertex {
+        float x;
+        float y;
+        float inverse_w;
+    };
+
+    // Projects the corners of a box to buffer coordinates, where bit 0 of the index picks the max x, bit 1 the max y and
+    // bit 2 the max z. Returns false if any corner is too close to or behind the camera.
+    bool project_corners(const Aabb &box, std::array<ScreenVertex, 8> &out) const;
+
+    // Draws a counter-clockwise triangle, keeping the nearest depth
+    void rasterize_triangle(const ScreenVertex &a, const ScreenVertex &b, const ScreenVertex &c);
+
+public:
+    // The width must be a multiple of 8
+    OcclusionBuffer(unsigned int width, unsigned int height);
+
+    // Clears the buffer for drawing from a new view.
+    void clear(const gfxm::Matrix<4, 4> &projview);
+
+    // Draws a box which hides everything behind it.
+    void draw_occluder(const Aabb &box);
+
+    // Whether any part of a box could be in front of the occluders. Boxes entirely off screen are not visible.
+    bool is_visible(const Aabb &box) const;
+};
+
+}  // namespace render
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <map>
+#include <optional>
+
+namespace render {
+
+// First fit allocator of ranges within a buffer of some capacity, in arbitrary units.
+// Freed ranges are merged with free neighbours, so the buffer doesn't fragment into small unusable ranges.
+class RangeAllocator {
+    // Offset to size of each free range
+    std::map<unsigned int, unsigned int> free_ranges;
+    unsigned int _capacity;
+    unsigned int _used = 0;
+
+public:
+    RangeAllocator(unsigned int capacity);
+
+    // Returns the offset of a newly allocated range, or nothing if no free range is large enough.
+    // Empty ranges are always at offset 0 and need not be freed.
+    std::optional<unsigned int> allocate(unsigned int size);
+
+    // Frees a range previously returned by allocate.
+    void free(unsigned int offset, unsigned int size);
+
+    // Extends the capacity, adding the new space to the end.
+    void grow(unsigned int new_capacity);
+
+    unsigned int capacity() const { return _capacity; }
+
+    // The total size of allocated ranges
+    unsigned int used() const { return _used; }
+};
+
+}  // namespace render
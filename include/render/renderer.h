@@ -1,43 +1,100 @@
 #pragma once
 
 #include "vertexarray.h"
+#include "rangeallocator.h"
+#include "stagingbuffer.h"
+#include "drawlist.h"
+#include "occlusion.h"
+#include "mesher.h"
 #include <vector>
+#include <unordered_map>
+#include <functional>
 #include "../app.h"
 #include "../models/chunk.h"
 
 namespace render {
 
+// Draws chunk and level of detail meshes, which are kept only on the GPU.
+// Each mesh owns a range of instances in one instance buffer, so meshes can be replaced and freed individually, and
+// all of them are drawn with a single multi-draw indirect call.
 class Renderer {
+    struct MeshRange {
+        unsigned int first_instance;
+        unsigned int instance_count;
+        ChunkCulling culling;
+    };
+
     VertexArray vertex_array;
     GLuint program;
     GLuint texture_array;
     GLint projview_uniform;
     GLint lightpos_uniform;
-    std::vector<uint8_t> _vertex_data;
-    unsigned int _instance_count;
+    std::unordered_map<MeshKey, MeshRange, MeshKeyHasher> meshes;
+    RangeAllocator instance_allocator;
+    StagingBuffer staging;
+
+    // Incremented whenever a mesh is uploaded or freed, so draw lists built from older meshes can be detected
+    uint64_t _mesh_generation = 0;
+
+    DrawList draw_list;
+    GLuint indirect_buffer;
+
+    // In commands
+    size_t indirect_capacity = 0;
+    bool draw_list_dirty = false;
+
+    OcclusionBuffer occlusion;
+
+    // The commands of the draw list which pass occlusion culling this frame
+    std::vector<DrawElementsIndirectCommand> unoccluded_commands;
+
+    // Frees the instances of a mesh, without removing it from meshes
+    void free_range(const MeshRange &range);
+
+    DrawElementsIndirectCommand draw_command(const MeshRange &range) const;
+
+    // Updates the draw list to the current meshes, dropping freed meshes and moving replaced ones
+    void patch_draw_list();
+
+    // Culls the commands of the draw list against its occluders, into unoccluded_commands
+    void cull_occluded(const gfxm::Matrix<4, 4> &projview);
 
     Renderer(const Renderer &) = delete;
     Renderer &operator=(const Renderer &) = delete;
 
 public:
-    Renderer() noexcept;
+    Renderer();
     ~Renderer();
 
-    // Clear the added block vertex data ready for new data
-    void reset();
+    // Memory which meshes are written into by other threads before being uploaded, valid while the renderer exists
+    std::span<uint8_t> staging_memory() const { return staging.memory(); }
+
+    // Uploads a mesh from the staging memory, replacing any existing mesh with the same key.
+    void upload_staged_mesh(const MeshKey &key, size_t staging_offset, unsigned int instance_count,
+                            ChunkCulling culling);
+
+    // Marks the given bytes of staging memory to be released once the uploads issued so far have completed.
+    void fence_uploads(size_t staging_bytes);
+
+    // Returns the bytes of staging memory from completed uploads, in the order they were fenced.
+    size_t retire_uploads() { return staging.retire(); }
 
-    // Add block vertex data to the vertex data to be rendered
-    void add_vertex_data(const std::span<const uint8_t> vertex_data, unsigned int instance_count);
+    // Whether a mesh with the given key has been uploaded and not freed
+    bool has_mesh(const MeshKey &key) const { return meshes.contains(key); }
 
-    // Write the vertex data to the vertex array
-    void write_vertex_data();
+    // Frees the meshes for which the predicate is true
+    void free_meshes_if(const std::function<bool(const MeshKey &)> &predicate);
 
-    // Render the vertex data
+    uint64_t mesh_generation() const { return _mesh_generation; }
+
+    // Copies the uploaded meshes and their draw commands, for building a draw list on another thread
+    std::vector<MeshDraw> snapshot_meshes() const;
+
+    // Sets the meshes to be drawn. Meshes uploaded or freed since the snapshot it was built from are accounted for.
+    void set_draw_list(DrawList list);
+
+    // Render the meshes to be drawn
     void render(const App &app);
 };
 
-template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
-unsigned int generate_chunk_vertex_data(const models::Chunk<X_SIZE, Y_SIZE, Z_SIZE> &chunk, int chunk_x, int chunk_y,
-                                        int chunk_z, std::vector<uint8_t> &data);
-
 }  // namespace render
\ No newline at end of file
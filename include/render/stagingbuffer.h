@@ -0,0 +1,47 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <deque>
+#include <vector>
+#include <span>
+#include <cstdint>
+#include "vertexarray.h"
+
+namespace render {
+
+// Memory which other threads can write meshes into, to be copied into a vertex array by the render thread.
+// Uses a persistently mapped coherent buffer when GL_ARB_buffer_storage is supported, so copies stay on the GPU.
+// Otherwise it is host memory uploaded with glBufferSubData.
+class StagingBuffer {
+    GLuint buffer = 0;
+    std::vector<uint8_t> host_memory;
+    std::span<uint8_t> _memory;
+
+    // Fences after copies out of the buffer, with the bytes to release once each has passed
+    std::deque<std::pair<GLsync, size_t>> in_flight;
+    size_t unfenced_bytes = 0;
+
+    StagingBuffer(const StagingBuffer &) = delete;
+    StagingBuffer &operator=(const StagingBuffer &) = delete;
+
+public:
+    StagingBuffer(size_t size) noexcept;
+    ~StagingBuffer();
+
+    // The memory to write into, valid until the buffer is destroyed
+    std::span<uint8_t> memory() const { return _memory; }
+
+    // Whether the memory is mapped GPU memory rather than host memory
+    bool persistent() const { return buffer != 0; }
+
+    // Copies part of the buffer into the data of a vertex array
+    void copy_to(VertexArray &vertex_array, size_t offset, size_t size, size_t dst_offset);
+
+    // Marks the given bytes to be released once the copies issued so far have completed.
+    void fence(size_t bytes);
+
+    // Returns the bytes from fences which have passed, in the order they were fenced.
+    size_t retire();
+};
+
+}  // namespace render
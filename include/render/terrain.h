@@ -0,0 +1,44 @@
+#pragma once
+
+#include "vertexarray.h"
+#include <vector>
+#include <span>
+#include "../app.h"
+
+namespace render {
+
+// Draws the far terrain as a heightmap. Every tile shares one grid mesh, and is an instance which reads its heights
+// from a layer of a texture array, so all tiles are drawn in a single draw call.
+class TerrainRenderer {
+    VertexArray vertex_array;
+    GLuint program;
+    GLuint height_texture;
+    GLint projview_uniform;
+    GLint camerapos_uniform;
+    unsigned int texture_layers = 0;
+    std::vector<uint8_t> _vertex_data;
+    std::vector<float> _heights;
+    unsigned int _tile_count;
+
+    TerrainRenderer(const TerrainRenderer &) = delete;
+    TerrainRenderer &operator=(const TerrainRenderer &) = delete;
+
+public:
+    TerrainRenderer() noexcept;
+    ~TerrainRenderer();
+
+    // Clear the added tiles ready for new tiles
+    void reset();
+
+    // Add a tile of the given level of detail, with (FAR_TERRAIN_TILE_RESOLUTION + 1)^2 heights in blocks
+    void add_tile(unsigned int level, int tile_x, int tile_z, std::span<const float> heights);
+
+    // Write the tiles to the vertex array and height texture
+    void write_tiles();
+
+    // Render the tiles. Must be drawn before the chunks, with the depth buffer cleared in between, as it uses its own
+    // depth range.
+    void render(const App &app);
+};
+
+}  // namespace render
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace render {
+
+// The pixels of every layer of a texture array with its mip levels, ready to upload.
+// Levels are stored largest first, each holding all of its layers in order as tightly packed RGB8 rows.
+struct TextureArrayImage {
+    unsigned int width = 0;
+    unsigned int height = 0;
+    unsigned int layers = 0;
+    unsigned int mip_levels = 0;
+    std::vector<uint8_t> pixels;
+
+    // The offset of a mip level in pixels
+    size_t level_offset(unsigned int level) const;
+};
+
+// Loads the PNGs in a directory with the given names (without the extension) as the layers of a texture array, in
+// order. Images are decoded and their mip levels box filtered on a temporary thread pool.
+// The result is cached in a binary file, which is used instead of the PNGs until any of them change.
+// Throws if an image is missing, invalid or a different size to the others.
+TextureArrayImage load_texture_array(const std::string &dir, const std::vector<std::string> &names,
+                                     const std::string &cache_path);
+
+// Creates a GL_TEXTURE_2D_ARRAY from an image, uploading every mip level, and leaves it bound
+GLuint create_texture_array(const TextureArrayImage &image);
+
+}  // namespace render
@@ -50,12 +50,41 @@ public:
         glDrawElementsInstanced(GL_TRIANGLES, this->indices_count(), INDICES_TYPE_GL, 0, count);
     }
 
+    // Draw the commands in the given indirect buffer, each drawing the indices with its own instances
+    void multi_draw_indirect(GLuint indirect_buffer, GLsizei draw_count) {
+        this->bind();
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, INDICES_TYPE_GL, nullptr, draw_count, 0);
+    }
+
+    // Draw without indices, for vertex arrays created with none
+    void draw_arrays_instanced(unsigned int vertex_count, unsigned int count) {
+        this->bind();
+        glDrawArraysInstanced(GL_TRIANGLES, 0, vertex_count, count);
+    }
+
     void set_data(std::span<const uint8_t> data) {
         this->bind();
         glBindBuffer(GL_ARRAY_BUFFER, this->vbo);
         glBufferData(GL_ARRAY_BUFFER, data.size_bytes(), data.data(), GL_DYNAMIC_DRAW);
     }
 
+    // Overwrite part of the data, which must be within its current size
+    void set_sub_data(std::size_t offset, std::span<const uint8_t> data) {
+        glBindBuffer(GL_ARRAY_BUFFER, this->vbo);
+        glBufferSubData(GL_ARRAY_BUFFER, offset, data.size_bytes(), data.data());
+    }
+
+    // Overwrite part of the data with part of another buffer, copied on the GPU
+    void copy_sub_data(GLuint src_buffer, std::size_t src_offset, std::size_t offset, std::size_t size) {
+        glBindBuffer(GL_COPY_READ_BUFFER, src_buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, this->vbo);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, src_offset, offset, size);
+    }
+
+    // Grow the data to the given size, keeping the existing data at the start
+    void grow(std::size_t old_size, std::size_t new_size);
+
     std::size_t indices_count() const { return this->m_indices_count; }
 };
 
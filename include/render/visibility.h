@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "../models/chunk.h"
+
+namespace render {
+
+// Which pairs of faces of a chunk are connected by a path through its non-opaque voxels, one bit for each of the 15
+// pairs. Faces are numbered -x, +x, -y, +y, -z, +z, so the opposite of a face is face ^ 1.
+using FaceConnectivity = uint16_t;
+
+// For chunks which are not known to block anything, such as ones which are not meshed yet
+constexpr FaceConnectivity ALL_FACES_CONNECTED = 0x7FFF;
+
+// What meshing finds out about a chunk for culling it and the chunks behind it
+struct ChunkCulling {
+    FaceConnectivity face_connectivity = ALL_FACES_CONNECTED;
+
+    // The number of layers from the bottom of the chunk which are entirely opaque, for use as an occluder
+    uint16_t solid_height = 0;
+};
+
+// Whether the given faces are connected, which is always true for a face and itself
+bool faces_connected(FaceConnectivity connectivity, unsigned int face_a, unsigned int face_b);
+
+// Flood fills the non-opaque voxels of a chunk to find which of its faces can see each other through it.
+template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
+FaceConnectivity chunk_face_connectivity(const models::Chunk<X_SIZE, Y_SIZE, Z_SIZE> &chunk);
+
+// Counts the layers from the bottom of a chunk which are entirely opaque.
+template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
+uint16_t chunk_solid_height(const models::Chunk<X_SIZE, Y_SIZE, Z_SIZE> &chunk);
+
+// Finds the chunks which could be seen from the camera chunk, within a cube of chunks around it.
+// Starting from the camera chunk, chunks are walked through faces connected inside each chunk, only ever moving away
+// from the camera, so chunks hidden behind solid ground or cave walls are never reached.
+class ChunkVisibility {
+    int centre_x;
+    int centre_y;
+    int centre_z;
+    int radius;
+    int side;
+
+    std::vector<FaceConnectivity> connectivity;
+
+    // The faces each chunk has been entered through, so chunks which have been reached are non-zero
+    std::vector<uint8_t> entered;
+
+    unsigned int _visible_count = 0;
+
+    int index(int chunk_x, int chunk_y, int chunk_z) const;
+
+public:
+    // Chunks start out with all faces connected
+    ChunkVisibility(int camera_chunk_x, int camera_chunk_y, int camera_chunk_z, int radius);
+
+    // Sets the connectivity of a chunk, ignoring chunks outside the cube
+    void set_connectivity(int chunk_x, int chunk_y, int chunk_z, FaceConnectivity faces);
+
+    // Walks the chunks from the camera chunk. Must be called before is_visible.
+    void update();
+
+    // Whether a chunk could be seen. Chunks outside the cube are never culled.
+    bool is_visible(int chunk_x, int chunk_y, int chunk_z) const;
+
+    // The number of chunks in the cube found to be visible
+    unsigned int visible_count() const { return _visible_count; }
+};
+
+}  // namespace render
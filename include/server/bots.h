@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "../mgr/interest.h"
+
+namespace server {
+
+// Scripted players for running a server without clients, e.g. to load test it.
+// Each bot walks across the surface in a straight line, turning to a random direction every few seconds.
+class BotSwarm {
+    struct Bot {
+        // Position and velocity in chunks
+        float x;
+        float z;
+        float dx;
+        float dz;
+
+        float seconds_to_turn;
+    };
+
+    std::vector<Bot> bots;
+    std::mt19937 rng;
+    uint64_t first_id;
+
+    void turn(Bot& bot);
+
+public:
+    // Places bots at random within spread chunks of the origin, along x and z. Bots have ids counting up from first_id.
+    BotSwarm(unsigned int count, uint32_t seed, float spread, uint64_t first_id);
+
+    // Moves the bots on by the given time
+    void step(float seconds);
+
+    // Appends interest points with the given radius around the bots
+    void interest_points(std::vector<mgr::InterestPoint>& out, int radius) const;
+
+    size_t size() const { return bots.size(); }
+};
+
+}  // namespace server
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+#include "../mgr/interest.h"
+#include "../mgr/sharedstate.h"
+
+namespace server {
+
+// Accepts clients on a loopback TCP port. Each client reports the chunk its player is in as lines of text,
+//   chunk_x chunk_y chunk_z
+// and the latest complete line is used. Sockets are non-blocking and are polled once per tick.
+class ClientListener {
+    struct Client {
+        uint64_t id;
+        int fd;
+        std::string buffer;
+        std::optional<mgr::SharedStateView> position;
+    };
+
+    int listen_fd;
+    std::vector<Client> clients;
+    uint64_t next_id;
+
+    // Reads what a client has sent, returning false if it has disconnected or sent something invalid
+    static bool read_client(Client& client);
+
+    ClientListener(const ClientListener&) = delete;
+    ClientListener& operator=(const ClientListener&) = delete;
+
+public:
+    // Clients are given ids counting up from first_id.
+    // Throws std::system_error if the port can't be listened on.
+    ClientListener(uint16_t port, uint64_t first_id);
+    ~ClientListener();
+
+    // Accepts new clients and reads their positions, dropping any which have disconnected
+    void poll();
+
+    // Appends interest points with the given radius around the clients which have sent a position
+    void interest_points(std::vector<mgr::InterestPoint>& out, int radius) const;
+
+    size_t client_count() const { return clients.size(); }
+};
+
+}  // namespace server
@@ -2,6 +2,7 @@
 
 #include "../models/chunk.h"
 #include <FastNoise/FastNoise.h>
+#include <span>
 
 namespace worldgen {
 
@@ -13,7 +14,20 @@ class ChunkGenerator {
 public:
     ChunkGenerator(uint32_t seed) noexcept;
 
-    void generate(models::Chunk<X_SIZE, Y_SIZE, Z_SIZE> &chunk, int chunk_x, int chunk_y, int chunk_z) const;
+    // If surface_heights is given, it is filled with the world y of the lowest air block above the terrain in each
+    // column, indexed by x + z * X_SIZE, which may be outside the chunk.
+    void generate(models::Chunk<X_SIZE, Y_SIZE, Z_SIZE> &chunk, int chunk_x, int chunk_y, int chunk_z,
+                  std::span<int> surface_heights = {}) const;
+
+    // Generates a level of detail node, where each voxel covers 2^level blocks along each axis and the node covers
+    // 2^level chunks along each axis. The heightmap is sampled once per voxel column.
+    // Level 0 is the same as generate.
+    void generate_lod(models::Chunk<X_SIZE, Y_SIZE, Z_SIZE> &chunk, int node_x, int node_y, int node_z,
+                      unsigned int level, std::span<int> surface_heights = {}) const;
+
+    // Samples the surface height in blocks on a size by size grid of block corners, step blocks apart, starting at the
+    // given block. The start must be a multiple of step. Used for far terrain, without generating any chunks.
+    void generate_heightmap(float *heights, int block_x, int block_z, unsigned int size, unsigned int step) const;
 };
 
 };  // namespace worldgen
\ No newline at end of file
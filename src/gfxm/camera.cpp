@@ -24,18 +24,22 @@ static Matrix<4, 4> look_in_direction(const Matrix<3, 1>& camera_pos, const Matr
         .translate(translation);
 }
 
-// Produces a view transoformation matrix for a camera looking with a given pitch and yaw (radians)
-// A pitch of 0 is horizontal, increasing pitch from 0 will cause the camera to look upwards.
-// A yaw of 0 is towards +x, increasing yaw from 0 will rotate towards -z.
-static Matrix<4, 4> look_pitch_yaw(const Matrix<3, 1>& camera_pos, float pitch_rad, float yaw_rad,
-                                   const Matrix<3, 1>& world_up) {
+// The unit vector in the direction of a given pitch and yaw (radians)
+static Matrix<3, 1> direction_pitch_yaw(float pitch_rad, float yaw_rad) {
     float sinpitch = sinf(pitch_rad);
     float cospitch = cosf(pitch_rad);
     float sinyaw = sinf(yaw_rad);
     float cosyaw = cosf(yaw_rad);
 
-    Matrix<3, 1> direction({cosyaw * cospitch, sinpitch, cospitch * sinyaw});
-    return look_in_direction(camera_pos, direction, world_up);
+    return Matrix<3, 1>({cosyaw * cospitch, sinpitch, cospitch * sinyaw});
+}
+
+// Produces a view transoformation matrix for a camera looking with a given pitch and yaw (radians)
+// A pitch of 0 is horizontal, increasing pitch from 0 will cause the camera to look upwards.
+// A yaw of 0 is towards +x, increasing yaw from 0 will rotate towards -z.
+static Matrix<4, 4> look_pitch_yaw(const Matrix<3, 1>& camera_pos, float pitch_rad, float yaw_rad,
+                                   const Matrix<3, 1>& world_up) {
+    return look_in_direction(camera_pos, direction_pitch_yaw(pitch_rad, yaw_rad), world_up);
 }
 
 // TODO: better way of doing this
@@ -44,4 +48,6 @@ void Camera::move(const Matrix<3, 1>& translation) {
     _pos = _pos + to_world;
 }
 
+Matrix<3, 1> Camera::direction() const { return direction_pitch_yaw(_pitch, _yaw); }
+
 Matrix<4, 4> Camera::view() const { return look_pitch_yaw(_pos, _pitch, _yaw, CAMERA_WORLD_UP); }
\ No newline at end of file
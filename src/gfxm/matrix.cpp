@@ -0,0 +1,50 @@
+#include <gfxm/matrix.h>
+
+using namespace gfxm;
+
+void gfxm::transform_points(const Matrix<4, 4>& matrix, std::span<const std::array<float, 3>> points,
+                            std::span<std::array<float, 4>> out) {
+    assert(out.size() >= points.size());
+
+    size_t i = 0;
+
+#ifdef __AVX__
+    // Points are transposed into registers of 8 xs, ys and zs, then each row of the matrix is applied to all of them
+    for (; i + 8 <= points.size(); i += 8) {
+        alignas(32) std::array<std::array<float, 8>, 3> in;
+
+        for (unsigned int j = 0; j < 8; j++) {
+            in[0][j] = points[i + j][0];
+            in[1][j] = points[i + j][1];
+            in[2][j] = points[i + j][2];
+        }
+
+        const __m256 x = _mm256_load_ps(in[0].data());
+        const __m256 y = _mm256_load_ps(in[1].data());
+        const __m256 z = _mm256_load_ps(in[2].data());
+
+        alignas(32) std::array<std::array<float, 8>, 4> result;
+
+        for (unsigned char r = 0; r < 4; r++) {
+            __m256 sum = _mm256_mul_ps(_mm256_set1_ps(matrix[r, 0]), x);
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(matrix[r, 1]), y));
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(matrix[r, 2]), z));
+            sum = _mm256_add_ps(sum, _mm256_set1_ps(matrix[r, 3]));
+
+            _mm256_store_ps(result[r].data(), sum);
+        }
+
+        for (unsigned int j = 0; j < 8; j++) {
+            out[i + j] = {result[0][j], result[1][j], result[2][j], result[3][j]};
+        }
+    }
+#endif
+
+    for (; i < points.size(); i++) {
+        const auto& [x, y, z] = points[i];
+
+        for (unsigned char r = 0; r < 4; r++) {
+            out[i][r] = matrix[r, 0] * x + matrix[r, 1] * y + matrix[r, 2] * z + matrix[r, 3];
+        }
+    }
+}
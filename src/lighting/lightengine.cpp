@@ -0,0 +1,434 @@
+#include <lighting/lightengine.h>
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <tracy/Tracy.hpp>
+
+using namespace lighting;
+
+static constexpr std::array<std::array<int, 3>, 6> DIRECTIONS = {{
+    {1, 0, 0},
+    {-1, 0, 0},
+    {0, 1, 0},
+    {0, -1, 0},
+    {0, 0, 1},
+    {0, 0, -1},
+}};
+
+// Division rounding towards negative infinity, b must be positive
+static inline int floor_div(int a, int b) {
+    int q = a / b;
+    return (a % b != 0 && a < 0) ? q - 1 : q;
+}
+
+template <LightChannel CHANNEL, typename Light>
+static inline models::LightLevel get_level(const Light& light, unsigned int i) {
+    if constexpr (CHANNEL == LightChannel::SKY) {
+        return light.sky(i);
+    } else {
+        return light.block(i);
+    }
+}
+
+template <LightChannel CHANNEL, typename Light>
+static inline void set_level(Light& light, unsigned int i, models::LightLevel level) {
+    if constexpr (CHANNEL == LightChannel::SKY) {
+        light.set_sky(i, level);
+    } else {
+        light.set_block(i, level);
+    }
+}
+
+template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
+bool LightEngine<X_SIZE, Y_SIZE, Z_SIZE>::VoxelFinder::find(int x, int y, int z, ChunkRef& ref, unsigned int& index) {
+    const int chunk_x = floor_div(x, X_SIZE);
+    const int chunk_y = floor_div(y, Y_SIZE);
+    const int chunk_z = floor_div(z, Z_SIZE);
+
+    size_t i = 0;
+    for (; i < cache_size; i++) {
+        const Cached& cached = cache[i];
+        if (cached.chunk_x == chunk_x && cached.chunk_y == chunk_y && cached.chunk_z == chunk_z) break;
+    }
+
+    if (i < cache_size) {
+        ref = cache[i].ref;
+    } else {
+        ref = lookup(chunk_x, chunk_y, chunk_z);
+
+        // Unloaded chunks are cached too, as light will often try to spread into them repeatedly
+        cache[cache_next] = Cached{.chunk_x = chunk_x, .chunk_y = chunk_y, .chunk_z = chunk_z, .ref = ref};
+        cache_next = (cache_next + 1) % cache.size();
+        cache_size = std::min(cache_size + 1, cache.size());
+    }
+
+    if (ref.chunk == nullptr) return false;
+
+    index = Light::index(x - chunk_x * X_SIZE, y - chunk_y * Y_SIZE, z - chunk_z * Z_SIZE);
+    return true;
+}
+
+template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
+void LightEngine<X_SIZE, Y_SIZE, Z_SIZE>::mark_changed(const ChunkRef& ref, int x, int y, int z) {
+    if (ref.changed == nullptr || *ref.changed) return;
+
+    *ref.changed = true;
+    changed_chunks.push_back({floor_div(x, X_SIZE), floor_div(y, Y_SIZE), floor_div(z, Z_SIZE)});
+}
+
+template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
+void LightEngine<X_SIZE, Y_SIZE, Z_SIZE>::take_changed_chunks(std::vector<std::array<int, 3>>& out) {
+    out.insert(out.end(), changed_chunks.begin(), changed_chunks.end());
+    changed_chunks.clear();
+}
+
+template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
+template <LightChannel CHANNEL>
+unsigned int LightEngine<X_SIZE, Y_SIZE, Z_SIZE>::run_add(VoxelFinder& finder, std::vector<AddNode>& queue,
+                                                          size_t& head, unsigned int& budget) {
+    unsigned int visited = 0;
+
+    // New nodes are appended while iterating, so the queue is walked by index
+    for (; head < queue.size() && budget > 0; head++, budget--) {
+        const AddNode node = queue[head];
+
+        ChunkRef ref;
+        unsigned int i;
+        if (!finder.find(node.x, node.y, node.z, ref, i)) continue;
+
+        visited++;
+
+        const models::LightLevel level = get_level<CHANNEL>(*ref.light, i);
+        if (level <= 1) continue;
+
+        for (const auto& [dx, dy, dz] : DIRECTIONS) {
+            ChunkRef n_ref;
+            unsigned int n_i;
+            if (!finder.find(node.x + dx, node.y + dy, node.z + dz, n_ref, n_i)) continue;
+
+            if (n_ref.chunk->block_at(n_i).opaque()) continue;
+
+            const bool sky_down = CHANNEL == LightChannel::SKY && dy == -1 && level == models::MAX_LIGHT;
+            const models::LightLevel new_level = sky_down ? models::MAX_LIGHT : level - 1;
+
+            if (get_level<CHANNEL>(*n_ref.light, n_i) >= new_level) continue;
+
+            set_level<CHANNEL>(*n_ref.light, n_i, new_level);
+            mark_changed(n_ref, node.x + dx, node.y + dy, node.z + dz);
+
+            queue.push_back(AddNode{.x = node.x + dx, .y = node.y + dy, .z = node.z + dz});
+        }
+    }
+
+    if (head == queue.size()) {
+        queue.clear();
+        head = 0;
+    }
+
+    return visited;
+}
+
+template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
+template <LightChannel CHANNEL>
+unsigned int LightEngine<X_SIZE, Y_SIZE, Z_SIZE>::run_remove(VoxelFinder& finder, std::vector<RemoveNode>& queue,
+                                                             size_t& head, std::vector<AddNode>& add_queue,
+                                                             unsigned int& budget) {
+    unsigned int visited = 0;
+
+    for (; head < queue.size() && budget > 0; head++, budget--) {
+        const RemoveNode node = queue[head];
+        visited++;
+
+        for (const auto& [dx, dy, dz] : DIRECTIONS) {
+            ChunkRef n_ref;
+            unsigned int n_i;
+            if (!finder.find(node.x + dx, node.y + dy, node.z + dz, n_ref, n_i)) continue;
+
+            const models::LightLevel n_level = get_level<CHANNEL>(*n_ref.light, n_i);
+            if (n_level == 0) continue;
+
+            const bool sky_down = CHANNEL == LightChannel::SKY && dy == -1 && node.level == models::MAX_LIGHT &&
+                                  n_level == models::MAX_LIGHT;
+
+            if (n_level < node.level || sky_down) {
+                // The neighbour may have been lit by the removed light, so remove it too
+                set_level<CHANNEL>(*n_ref.light, n_i, 0);
+                mark_changed(n_ref, node.x + dx, node.y + dy, node.z + dz);
+
+                queue.push_back(RemoveNode{.x = node.x + dx, .y = node.y + dy, .z = node.z + dz, .level = n_level});
+
+                if constexpr (CHANNEL == LightChannel::BLOCK) {
+                    const unsigned char emission = n_ref.chunk->block_at(n_i).light_emission();
+                    if (emission > 0) {
+                        set_level<CHANNEL>(*n_ref.light, n_i, emission);
+                        add_queue.push_back(AddNode{.x = node.x + dx, .y = node.y + dy, .z = node.z + dz});
+                    }
+                }
+            } else {
+                // The neighbour is lit from elsewhere, so it can light the removed area again
+                add_queue.push_back(AddNode{.x = node.x + dx, .y = node.y + dy, .z = node.z + dz});
+            }
+        }
+    }
+
+    if (head == queue.size()) {
+        queue.clear();
+        head = 0;
+    }
+
+    return visited;
+}
+
+template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
+void LightEngine<X_SIZE, Y_SIZE, Z_SIZE>::queue_border(int chunk_x, int chunk_y, int chunk_z, int dx, int dy, int dz,
+                                                       const ChunkRef& a, const ChunkRef& b) {
+    const int a_x = chunk_x * X_SIZE, a_y = chunk_y * Y_SIZE, a_z = chunk_z * Z_SIZE;
+    const int b_x = a_x + dx * X_SIZE, b_y = a_y + dy * Y_SIZE, b_z = a_z + dz * Z_SIZE;
+
+    auto queue_voxel = [this](const ChunkRef& ref, int origin_x, int origin_y, int origin_z, unsigned int x,
+                              unsigned int y, unsigned int z) {
+        const unsigned int i = Light::index(x, y, z);
+        const AddNode node{.x = origin_x + (int)x, .y = origin_y + (int)y, .z = origin_z + (int)z};
+
+        if (ref.light->sky(i) > 1) sky_add.push_back(node);
+        if (ref.light->block(i) > 1) block_add.push_back(node);
+    };
+
+    if (dx != 0) {
+        const unsigned int face_a = dx > 0 ? X_SIZE - 1 : 0;
+        const unsigned int face_b = X_SIZE - 1 - face_a;
+
+        for (unsigned int z = 0; z < Z_SIZE; z++) {
+            for (unsigned int y = 0; y < Y_SIZE; y++) {
+                queue_voxel(a, a_x, a_y, a_z, face_a, y, z);
+                queue_voxel(b, b_x, b_y, b_z, face_b, y, z);
+            }
+        }
+    } else if (dy != 0) {
+        const unsigned int face_a = dy > 0 ? Y_SIZE - 1 : 0;
+        const unsigned int face_b = Y_SIZE - 1 - face_a;
+
+        for (unsigned int z = 0; z < Z_SIZE; z++) {
+            for (unsigned int x = 0; x < X_SIZE; x++) {
+                queue_voxel(a, a_x, a_y, a_z, x, face_a, z);
+                queue_voxel(b, b_x, b_y, b_z, x, face_b, z);
+            }
+        }
+    } else {
+        const unsigned int face_a = dz > 0 ? Z_SIZE - 1 : 0;
+        const unsigned int face_b = Z_SIZE - 1 - face_a;
+
+        for (unsigned int y = 0; y < Y_SIZE; y++) {
+            for (unsigned int x = 0; x < X_SIZE; x++) {
+                queue_voxel(a, a_x, a_y, a_z, x, y, face_a);
+                queue_voxel(b, b_x, b_y, b_z, x, y, face_b);
+            }
+        }
+    }
+}
+
+template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
+unsigned int LightEngine<X_SIZE, Y_SIZE, Z_SIZE>::light_isolated(const Chunk& chunk, Light& light, int chunk_y,
+                                                                 std::span<const int> surface_heights) {
+    ZoneScopedN("LightEngine::light_isolated");
+    assert(!propagating());
+    assert(surface_heights.empty() || surface_heights.size() == (size_t)X_SIZE * Z_SIZE);
+
+    const ChunkRef self{.chunk = &chunk, .light = &light, .changed = nullptr};
+    const ChunkLookup lookup = [&self](int chunk_x, int chunk_y, int chunk_z) {
+        return chunk_x == 0 && chunk_y == 0 && chunk_z == 0 ? self : ChunkRef{};
+    };
+    VoxelFinder finder(lookup);
+
+    light = Light();
+
+    const int chunk_top = chunk_y * Y_SIZE + Y_SIZE;
+
+    for (int z = 0; z < Z_SIZE; z++) {
+        for (int x = 0; x < X_SIZE; x++) {
+            // Sky light goes straight down until it hits an opaque block, if the column isn't covered by terrain above
+            const bool open = surface_heights.empty() || surface_heights[x + z * X_SIZE] <= chunk_top;
+
+            for (int y = Y_SIZE - 1; open && y >= 0 && !chunk[x, y, z].opaque(); y--) {
+                light.set_sky(Light::index(x, y, z), models::MAX_LIGHT);
+                sky_add.push_back(AddNode{.x = x, .y = y, .z = z});
+            }
+
+            for (int y = 0; y < Y_SIZE; y++) {
+                const unsigned char emission = chunk[x, y, z].light_emission();
+
+                if (emission > 0) {
+                    light.set_block(Light::index(x, y, z), emission);
+                    block_add.push_back(AddNode{.x = x, .y = y, .z = z});
+                }
+            }
+        }
+    }
+
+    unsigned int budget = UINT_MAX;
+    unsigned int visited = run_add<LightChannel::SKY>(finder, sky_add, sky_add_head, budget);
+    visited += run_add<LightChannel::BLOCK>(finder, block_add, block_add_head, budget);
+
+    return visited;
+}
+
+template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
+void LightEngine<X_SIZE, Y_SIZE, Z_SIZE>::join_neighbours(int chunk_x, int chunk_y, int chunk_z,
+                                                          const ChunkLookup& lookup) {
+    ZoneScopedN("LightEngine::join_neighbours");
+
+    const ChunkRef self = lookup(chunk_x, chunk_y, chunk_z);
+    if (self.chunk == nullptr) return;
+
+    // Sky light of 15 can only come from directly above, so remove it where the voxel above doesn't have it
+    auto fix_sky_column = [this](const ChunkRef& upper, const ChunkRef& lower, int lower_chunk_x, int lower_chunk_y,
+                                 int lower_chunk_z) {
+        for (unsigned int z = 0; z < Z_SIZE; z++) {
+            for (unsigned int x = 0; x < X_SIZE; x++) {
+                const unsigned int upper_i = Light::index(x, 0, z);
+                const unsigned int lower_i = Light::index(x, Y_SIZE - 1, z);
+
+                if (lower.light->sky(lower_i) == models::MAX_LIGHT && upper.light->sky(upper_i) != models::MAX_LIGHT) {
+                    const int voxel_x = lower_chunk_x * X_SIZE + (int)x;
+                    const int voxel_y = lower_chunk_y * Y_SIZE + Y_SIZE - 1;
+                    const int voxel_z = lower_chunk_z * Z_SIZE + (int)z;
+
+                    lower.light->set_sky(lower_i, 0);
+                    mark_changed(lower, voxel_x, voxel_y, voxel_z);
+
+                    sky_remove.push_back(
+                        RemoveNode{.x = voxel_x, .y = voxel_y, .z = voxel_z, .level = models::MAX_LIGHT});
+                }
+            }
+        }
+    };
+
+    const ChunkRef above = lookup(chunk_x, chunk_y + 1, chunk_z);
+    if (above.chunk != nullptr) fix_sky_column(above, self, chunk_x, chunk_y, chunk_z);
+
+    const ChunkRef below = lookup(chunk_x, chunk_y - 1, chunk_z);
+    if (below.chunk != nullptr) fix_sky_column(self, below, chunk_x, chunk_y - 1, chunk_z);
+
+    for (const auto& [dx, dy, dz] : DIRECTIONS) {
+        const ChunkRef neighbour = lookup(chunk_x + dx, chunk_y + dy, chunk_z + dz);
+        if (neighbour.chunk != nullptr) queue_border(chunk_x, chunk_y, chunk_z, dx, dy, dz, self, neighbour);
+    }
+}
+
+template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
+unsigned int LightEngine<X_SIZE, Y_SIZE, Z_SIZE>::propagate(const ChunkLookup& lookup, unsigned int max_voxels) {
+    ZoneScopedN("LightEngine::propagate");
+
+    // Made for each call, as cached chunks may be unloaded in between
+    VoxelFinder finder(lookup);
+    unsigned int budget = max_voxels;
+
+    // Removals must finish before their channel is added, or light about to be removed could spread
+    unsigned int visited = run_remove<LightChannel::SKY>(finder, sky_remove, sky_remove_head, sky_add, budget);
+    visited += run_remove<LightChannel::BLOCK>(finder, block_remove, block_remove_head, block_add, budget);
+
+    if (sky_remove.empty()) visited += run_add<LightChannel::SKY>(finder, sky_add, sky_add_head, budget);
+    if (block_remove.empty()) visited += run_add<LightChannel::BLOCK>(finder, block_add, block_add_head, budget);
+
+    return visited;
+}
+
+template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
+unsigned int LightEngine<X_SIZE, Y_SIZE, Z_SIZE>::update_block(int x, int y, int z, const ChunkLookup& lookup) {
+    ZoneScopedN("LightEngine::update_block");
+
+    VoxelFinder finder(lookup);
+
+    ChunkRef ref;
+    unsigned int i;
+    if (!finder.find(x, y, z, ref, i)) return 0;
+
+    // Remove all light from the voxel, then let its neighbours light it again if it is not opaque
+    const models::LightLevel sky = ref.light->sky(i);
+    const models::LightLevel block = ref.light->block(i);
+
+    if (sky > 0) {
+        ref.light->set_sky(i, 0);
+        sky_remove.push_back(RemoveNode{.x = x, .y = y, .z = z, .level = sky});
+    }
+
+    if (block > 0) {
+        ref.light->set_block(i, 0);
+        block_remove.push_back(RemoveNode{.x = x, .y = y, .z = z, .level = block});
+    }
+
+    mark_changed(ref, x, y, z);
+
+    for (const auto& [dx, dy, dz] : DIRECTIONS) {
+        sky_add.push_back(AddNode{.x = x + dx, .y = y + dy, .z = z + dz});
+        block_add.push_back(AddNode{.x = x + dx, .y = y + dy, .z = z + dz});
+    }
+
+    unsigned int budget = UINT_MAX;
+    unsigned int visited = run_remove<LightChannel::SKY>(finder, sky_remove, sky_remove_head, sky_add, budget);
+    visited += run_remove<LightChannel::BLOCK>(finder, block_remove, block_remove_head, block_add, budget);
+
+    const unsigned char emission = ref.chunk->block_at(i).light_emission();
+    if (emission > 0) {
+        ref.light->set_block(i, emission);
+        block_add.push_back(AddNode{.x = x, .y = y, .z = z});
+    }
+
+    visited += run_add<LightChannel::SKY>(finder, sky_add, sky_add_head, budget);
+    visited += run_add<LightChannel::BLOCK>(finder, block_add, block_add_head, budget);
+
+    return visited;
+}
+
+template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
+void LightEngine<X_SIZE, Y_SIZE, Z_SIZE>::copy_padded(int chunk_x, int chunk_y, int chunk_z, const ChunkLookup& lookup,
+                                                      models::PaddedChunkLight<X_SIZE, Y_SIZE, Z_SIZE>& padded) {
+    const ChunkRef self = lookup(chunk_x, chunk_y, chunk_z);
+    assert(self.light != nullptr);
+
+    for (int z = -1; z <= Z_SIZE; z++) {
+        for (int y = -1; y <= Y_SIZE; y++) {
+            for (int x = -1; x <= X_SIZE; x++) {
+                padded[x, y, z] = self.light->packed(std::clamp(x, 0, X_SIZE - 1), std::clamp(y, 0, Y_SIZE - 1),
+                                                     std::clamp(z, 0, Z_SIZE - 1));
+            }
+        }
+    }
+
+    for (const auto& [dx, dy, dz] : DIRECTIONS) {
+        const ChunkRef neighbour = lookup(chunk_x + dx, chunk_y + dy, chunk_z + dz);
+        if (neighbour.light == nullptr) continue;
+
+        if (dx != 0) {
+            const int face = dx > 0 ? X_SIZE : -1;
+            const unsigned int from = dx > 0 ? 0 : X_SIZE - 1;
+
+            for (int z = 0; z < Z_SIZE; z++) {
+                for (int y = 0; y < Y_SIZE; y++) {
+                    padded[face, y, z] = neighbour.light->packed(from, y, z);
+                }
+            }
+        } else if (dy != 0) {
+            const int face = dy > 0 ? Y_SIZE : -1;
+            const unsigned int from = dy > 0 ? 0 : Y_SIZE - 1;
+
+            for (int z = 0; z < Z_SIZE; z++) {
+                for (int x = 0; x < X_SIZE; x++) {
+                    padded[x, face, z] = neighbour.light->packed(x, from, z);
+                }
+            }
+        } else {
+            const int face = dz > 0 ? Z_SIZE : -1;
+            const unsigned int from = dz > 0 ? 0 : Z_SIZE - 1;
+
+            for (int y = 0; y < Y_SIZE; y++) {
+                for (int x = 0; x < X_SIZE; x++) {
+                    padded[x, y, face] = neighbour.light->packed(x, y, from);
+                }
+            }
+        }
+    }
+}
+
+template class lighting::LightEngine<models::RenderingChunk::X_SIZE, models::RenderingChunk::Y_SIZE,
+                                     models::RenderingChunk::Z_SIZE>;
@@ -9,7 +9,10 @@
 #include <config.h>
 #include <mgr/manager.h>
 #include <mgr/sharedstate.h>
+#include <mgr/lodstore.h>
+#include <models/blockregistry.h>
 #include <render/renderer.h>
+#include <render/terrain.h>
 #include <tracy/Tracy.hpp>
 #include <tracy/TracyOpenGL.hpp>
 
@@ -111,75 +114,219 @@ static void glmain(GLFWwindow *window, App &app) {
 
     std::cout << "worldgen seed: " << worldgen_seed << std::endl;
 
+    // The renderer owns the memory meshes are staged in, so it must outlive the manager
+    render::Renderer renderer;
+    render::TerrainRenderer terrain_renderer;
+
     mgr::Manager manager{mgr::SharedStateView{
                              .chunk_x = 0,
                              .chunk_y = 0,
                              .chunk_z = 0,
                          },
-                         worldgen_seed};
+                         worldgen_seed, renderer.staging_memory()};
 
-    render::Renderer renderer;
+    render::DrawListBuilder draw_list_builder;
 
-    bool should_regen_vertex_data = true;
+    bool should_regen_draw_list = true;
+    bool should_regen_terrain = true;
+    uint64_t terrain_tile_version = 0;
     float delta_time = 0;
+    gfxm::Vec<3> last_camera_pos = app.camera().pos();
 
     while (!glfwWindowShouldClose(window)) {
         auto time = std::chrono::steady_clock::now();
         delta_time = std::chrono::duration<float>(time - last_frame_timestamp).count();
         last_frame_timestamp = time;
 
+        TracyPlot("frame_ms", delta_time * 1000.0f);
+
         HandleInputResult input_result = handle_input(window, app, delta_time);
 
         int chunk_x = std::floor(app.camera().pos()[0] / ((float)config::BLOCK_SIZE * models::RenderingChunk::X_SIZE));
         int chunk_y = std::floor(app.camera().pos()[1] / ((float)config::BLOCK_SIZE * models::RenderingChunk::Y_SIZE));
         int chunk_z = std::floor(app.camera().pos()[2] / ((float)config::BLOCK_SIZE * models::RenderingChunk::Z_SIZE));
 
-        if (input_result == HandleInputResult::QUIT) {
-            break;
-        } else if (input_result == HandleInputResult::MOVED) {
-            manager.shared_state().modify([chunk_x, chunk_y, chunk_z](mgr::SharedStateView &state) {
+        if (input_result == HandleInputResult::QUIT) break;
+
+        // The manager loads ahead of the player along their velocity, and in view first, so both are updated every
+        // frame even when the player hasn't moved
+        {
+            const gfxm::Vec<3> moved = app.camera().pos() - last_camera_pos;
+            last_camera_pos = app.camera().pos();
+
+            const gfxm::Vec<3> direction = app.camera().direction();
+            const std::array<float, 3> chunk_size = {(float)config::BLOCK_SIZE * models::RenderingChunk::X_SIZE,
+                                                     (float)config::BLOCK_SIZE * models::RenderingChunk::Y_SIZE,
+                                                     (float)config::BLOCK_SIZE * models::RenderingChunk::Z_SIZE};
+
+            std::array<float, 3> velocity = {0.0f, 0.0f, 0.0f};
+            std::array<float, 3> view_direction;
+
+            for (unsigned int axis = 0; axis < 3; axis++) {
+                if (delta_time > 0.0f) velocity[axis] = moved[axis] / (delta_time * chunk_size[axis]);
+                view_direction[axis] = direction[axis];
+            }
+
+            manager.shared_state().modify([&](mgr::SharedStateView &state) {
                 state.chunk_x = chunk_x;
                 state.chunk_y = chunk_y;
                 state.chunk_z = chunk_z;
+                state.velocity = velocity;
+                state.view_direction = view_direction;
             });
+        }
 
+        if (input_result == HandleInputResult::MOVED) {
             // Changed chunk, so rendered chunks will be different
-            should_regen_vertex_data = true;
+            should_regen_draw_list = true;
+            should_regen_terrain = true;
         }
 
-        if (should_regen_vertex_data) {
-            ZoneScopedN("regen_vertex_data");
+        // Upload the meshes generated since the last frame, up to a budget so frames stay smooth when many chunks
+        // finish at once. The staging memory is released once the GPU has copied them out.
+        {
+            ZoneScopedN("upload_meshes");
+
+            manager.mesh_uploads().release(renderer.retire_uploads());
+
+            const mgr::StagedBatch batch = manager.mesh_uploads().take_ready(config::MESH_UPLOAD_BYTES_PER_FRAME);
+            [[maybe_unused]] size_t upload_bytes = 0;
+
+            for (const mgr::StagedMesh &mesh : batch.meshes) {
+                renderer.upload_staged_mesh({mesh.level, mesh.x, mesh.y, mesh.z}, mesh.offset, mesh.instance_count,
+                                            mesh.culling);
+                upload_bytes += mesh.size;
+            }
+
+            renderer.fence_uploads(batch.ring_bytes);
+
+            TracyPlot("mesh_upload_bytes", (int64_t)upload_bytes);
+            TracyPlot("mesh_staging_used", (int64_t)manager.mesh_uploads().ring_used());
+            TracyPlot("mesh_staging_stalls", (int64_t)manager.mesh_uploads().stalls());
+
+            if (!batch.meshes.empty()) should_regen_draw_list = true;
+        }
+
+        if (should_regen_draw_list) {
+            ZoneScopedN("regen_draw_list");
+
+            should_regen_draw_list = false;
+
+            // Free the meshes of chunks and nodes which the stores have unloaded, or soon will
+            renderer.free_meshes_if([chunk_x, chunk_y, chunk_z](const render::MeshKey &key) {
+                const auto [level, x, y, z] = key;
+
+                if (level == 0) {
+                    return std::max({std::abs(x - chunk_x), std::abs(y - chunk_y), std::abs(z - chunk_z)}) >
+                           config::RENDER_DISTANCE + 2;
+                }
+
+                return !mgr::lod_node_in_ring(level, x, z, chunk_x, chunk_z, 2);
+            });
+
+            // Picking the visible meshes is done on the builder thread, and the result is taken on a later frame
+            const render::CullingOrigin culling_origin{
+                .chunk_x = chunk_x, .chunk_y = chunk_y, .chunk_z = chunk_z, .radius = config::RENDER_DISTANCE};
+
+            draw_list_builder.request(renderer.snapshot_meshes(), renderer.mesh_generation(), culling_origin,
+                                      [chunk_x, chunk_y, chunk_z](const render::MeshKey &key, unsigned int) {
+                                          const auto [level, x, y, z] = key;
 
-            should_regen_vertex_data = false;
+                                          if (level == 0 && std::max({std::abs(x - chunk_x), std::abs(y - chunk_y),
+                                                                      std::abs(z - chunk_z)}) > config::RENDER_DISTANCE) {
+                                              return false;
+                                          }
 
-            renderer.reset();
+                                          // Chunks covered by the level of detail rings are left out too
+                                          return mgr::lod_node_in_ring(level, x, z, chunk_x, chunk_z);
+                                      });
+
+            // Loaded chunks and nodes whose meshes have been freed are meshed again
+            manager.chunk_store().use_handle([&renderer, chunk_x, chunk_y, chunk_z](mgr::ChunkStoreHandle &chunk_store) {
+                ZoneScopedN("chunk_store_use");
+
+                for (int dx = -config::RENDER_DISTANCE; dx <= config::RENDER_DISTANCE; dx++) {
+                    for (int dz = -config::RENDER_DISTANCE; dz <= config::RENDER_DISTANCE; dz++) {
+                        if (!mgr::lod_node_in_ring(0, chunk_x + dx, chunk_z + dz, chunk_x, chunk_z)) continue;
 
-            manager.chunk_store().use_handle(
-                [&renderer, &should_regen_vertex_data, chunk_x, chunk_y, chunk_z](const auto &chunk_store) {
-                    ZoneScopedN("chunk_store_use");
-                    for (int dx = -config::RENDER_DISTANCE; dx <= config::RENDER_DISTANCE; dx++) {
                         for (int dy = -config::RENDER_DISTANCE; dy <= config::RENDER_DISTANCE; dy++) {
-                            for (int dz = -config::RENDER_DISTANCE; dz <= config::RENDER_DISTANCE; dz++) {
-                                const mgr::ChunkStoreEntry *entry =
-                                    chunk_store.get(chunk_x + dx, chunk_y + dy, chunk_z + dz);
-                                if (entry != nullptr) {
-                                    renderer.add_vertex_data(entry->vertex_data, entry->instance_count);
-                                } else if (chunk_y + dy >= config::MIN_CHUNK_Y && chunk_y + dy <= config::MAX_CHUNK_Y) {
-                                    // A chunk is not available yet
-                                    should_regen_vertex_data = true;
-                                }
+                            if (chunk_y + dy < config::MIN_CHUNK_Y || chunk_y + dy > config::MAX_CHUNK_Y) continue;
+
+                            mgr::ChunkStoreEntry *entry = chunk_store.get(chunk_x + dx, chunk_y + dy, chunk_z + dz);
+
+                            if (entry != nullptr && entry->meshed && !entry->remesh_queued &&
+                                !renderer.has_mesh({0, chunk_x + dx, chunk_y + dy, chunk_z + dz})) {
+                                chunk_store.flag_remesh(chunk_x + dx, chunk_y + dy, chunk_z + dz);
                             }
                         }
                     }
-                });
+                }
+            });
+
+            std::vector<render::MeshKey> lod_missing;
+            manager.lod_store().for_each_loaded([&renderer, &lod_missing, chunk_x, chunk_z](
+                                                    unsigned int level, int node_x, int node_y, int node_z,
+                                                    const mgr::LodStoreEntry &) {
+                if (!mgr::lod_node_in_ring(level, node_x, node_z, chunk_x, chunk_z)) return;
+                if (!renderer.has_mesh({level, node_x, node_y, node_z})) {
+                    lod_missing.push_back({level, node_x, node_y, node_z});
+                }
+            });
+
+            if (!lod_missing.empty()) manager.lod_store().request_remesh(lod_missing);
+        }
+
+        if (std::optional<render::DrawList> draw_list = draw_list_builder.take()) {
+            // Instances in each ring, level 0 being the full resolution chunks
+            std::array<unsigned int, config::LOD_LEVELS + 1> ring_instances{};
+
+            for (size_t i = 0; i < draw_list->keys.size(); i++) {
+                const unsigned int level = std::get<0>(draw_list->keys[i]);
+                if (level <= config::LOD_LEVELS) ring_instances[level] += draw_list->commands[i].instance_count;
+            }
+
+            [[maybe_unused]] static constexpr std::array<const char *, 4> RING_INSTANCES_PLOTS = {
+                "ring0_instances", "ring1_instances", "ring2_instances", "ring3_instances"};
+
+            for (unsigned int level = 0; level <= config::LOD_LEVELS && level < RING_INSTANCES_PLOTS.size(); level++) {
+                TracyPlot(RING_INSTANCES_PLOTS[level], (int64_t)ring_instances[level]);
+            }
 
-            renderer.write_vertex_data();
+            renderer.set_draw_list(std::move(*draw_list));
+        }
+
+        if (manager.terrain_store().tile_version() != terrain_tile_version) {
+            should_regen_terrain = true;
+        }
+
+        if (should_regen_terrain) {
+            ZoneScopedN("regen_terrain");
+
+            should_regen_terrain = false;
+            terrain_tile_version = manager.terrain_store().tile_version();
+
+            terrain_renderer.reset();
+
+            manager.terrain_store().for_each_loaded([&terrain_renderer, chunk_x, chunk_z](
+                                                        unsigned int level, int tile_x, int tile_z,
+                                                        const mgr::TerrainTile &tile) {
+                if (!mgr::lod_node_in_ring(level, tile_x, tile_z, chunk_x, chunk_z)) return;
+
+                terrain_renderer.add_tile(level, tile_x, tile_z, tile.heights);
+            });
+
+            terrain_renderer.write_tiles();
         }
 
         {
             TracyGpuZone("render");
             glClearColor(0.4f, 0.4f, 0.7f, 1.0f);
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            // The far terrain has its own depth range and is always behind the chunks
+            terrain_renderer.render(app);
+            glClear(GL_DEPTH_BUFFER_BIT);
+
             renderer.render(app);
         }
 
@@ -194,6 +341,9 @@ static void glmain(GLFWwindow *window, App &app) {
 }
 
 int main() {
+    // Before anything uses blocks, as the registry must not change once other threads are running
+    models::set_block_registry(models::BlockRegistry::load("../assets/blocks.txt"));
+
     if (!glfwInit()) throw std::runtime_error("glfwInit failed");
 
     constexpr int width = 1200;
@@ -1,110 +1,536 @@
 #include <mgr/chunkstore.h>
 #include <config.h>
 #include <iostream>
+#include <algorithm>
+#include <array>
 #include <functional>
-#include <render/renderer.h>
+#include <memory>
+#include <utility>
+#include <render/mesher.h>
+#include <render/visibility.h>
+#include <net/chunkcodec.h>
+#include <tracy/Tracy.hpp>
 
 using namespace mgr;
 
+// The stages of work on a chunk in the task graph
+static constexpr unsigned int LOAD_STAGE = 0;
+static constexpr unsigned int MESH_STAGE = 1;
+
+// Division rounding towards negative infinity, b must be positive
+static inline int floor_div(int a, int b) {
+    int q = a / b;
+    return (a % b != 0 && a < 0) ? q - 1 : q;
+}
+
+ChunkStoreHandle::ChunkStoreHandle(size_t max_bytes) : entries(config::CHUNK_STORE_HUGE_PAGES), max_bytes(max_bytes) {}
+
+ChunkStoreHandle::~ChunkStoreHandle() {
+    for (auto& [coord, stored] : map) entries.destroy(stored.entry);
+}
+
 const ChunkStoreEntry* ChunkStoreHandle::get(int chunk_x, int chunk_y, int chunk_z) const {
     assert(chunk_x <= config::MAX_CHUNK_X && chunk_x >= config::MIN_CHUNK_X);
     // assert(chunk_y <= config::MAX_CHUNK_Y && chunk_y >= config::MIN_CHUNK_Y); - easy to trigger, other for debugging
     assert(chunk_z <= config::MAX_CHUNK_Z && chunk_z >= config::MIN_CHUNK_Z);
 
-    const ChunkStoreHandle::ChunkCoord coord = {chunk_x, chunk_y, chunk_z};
+    const ChunkCoord coord = {chunk_x, chunk_y, chunk_z};
 
     auto it = map.find(coord);
 
     if (it != map.end()) {
-        return &it->second.first;
+        return it->second.entry;
     } else {
         return nullptr;
     }
 }
 
+ChunkStoreEntry* ChunkStoreHandle::get(int chunk_x, int chunk_y, int chunk_z) {
+    return const_cast<ChunkStoreEntry*>(std::as_const(*this).get(chunk_x, chunk_y, chunk_z));
+}
+
 ChunkStoreEntry* ChunkStoreHandle::get_and_mark_used(int chunk_x, int chunk_y, int chunk_z) {
     assert(chunk_x <= config::MAX_CHUNK_X && chunk_x >= config::MIN_CHUNK_X);
     assert(chunk_y <= config::MAX_CHUNK_Y && chunk_y >= config::MIN_CHUNK_Y);
     assert(chunk_z <= config::MAX_CHUNK_Z && chunk_z >= config::MIN_CHUNK_Z);
 
-    const ChunkStoreHandle::ChunkCoord coord = {chunk_x, chunk_y, chunk_z};
+    const ChunkCoord coord = {chunk_x, chunk_y, chunk_z};
 
     auto it = map.find(coord);
 
     if (it != map.end()) {
-        lru.splice(lru.begin(), lru, it->second.second);
-        return &it->second.first;
+        if (it->second.lru_it) lru.splice(lru.begin(), lru, *it->second.lru_it);
+        return it->second.entry;
     } else {
         return nullptr;
     }
 }
 
-void ChunkStoreHandle::put(int chunk_x, int chunk_y, int chunk_z, const ChunkStoreEntry& entry) {
+void ChunkStoreHandle::put(int chunk_x, int chunk_y, int chunk_z, const ChunkStoreEntry& entry, bool pinned) {
     assert(chunk_x <= config::MAX_CHUNK_X && chunk_x >= config::MIN_CHUNK_X);
     assert(chunk_y <= config::MAX_CHUNK_Y && chunk_y >= config::MIN_CHUNK_Y);
     assert(chunk_z <= config::MAX_CHUNK_Z && chunk_z >= config::MIN_CHUNK_Z);
 
-    const ChunkStoreHandle::ChunkCoord coord = {chunk_x, chunk_y, chunk_z};
+    const ChunkCoord coord = {chunk_x, chunk_y, chunk_z};
 
     auto it = map.find(coord);
     if (it != map.end()) {
-        map.erase(coord);
-        lru.erase(it->second.second);
-    } else if (lru.size() == max_size) {
-        ChunkCoord last = lru.back();
-        lru.pop_back();
-        map.erase(last);
+        _bytes_used -= entry_bytes();
+        if (it->second.lru_it) lru.erase(*it->second.lru_it);
+        entries.destroy(it->second.entry);
+        map.erase(it);
     }
 
-    map.emplace(coord, std::make_pair(entry, lru.emplace(lru.begin(), coord)));
+    const auto lru_it = pinned ? std::nullopt : std::optional(lru.emplace(lru.begin(), coord));
+    map.emplace(coord, StoredEntry{.entry = entries.create(entry), .lru_it = lru_it});
+    _bytes_used += entry_bytes();
+
+    evict_to_budget(coord);
 }
 
-void ChunkStore::load_chunk(int chunk_x, int chunk_y, int chunk_z) {
-    // TODO need to avoid loading/overwriting chunks that are already loaded
+void ChunkStoreHandle::set_pinned(const ChunkCoord& coord, bool pinned) {
+    auto it = map.find(coord);
+    if (it == map.end() || it->second.lru_it.has_value() != pinned) return;
+
+    if (pinned) {
+        lru.erase(*it->second.lru_it);
+        it->second.lru_it = std::nullopt;
+    } else {
+        it->second.lru_it = lru.emplace(lru.begin(), coord);
+        evict_to_budget(coord);
+    }
+}
+
+void ChunkStoreHandle::flag_remesh(int chunk_x, int chunk_y, int chunk_z) {
+    ChunkStoreEntry* entry = get(chunk_x, chunk_y, chunk_z);
+    if (entry == nullptr || entry->needs_remesh) return;
+
+    entry->needs_remesh = true;
+    flagged.push_back({chunk_x, chunk_y, chunk_z});
+}
+
+size_t ChunkStoreHandle::entry_bytes() {
+    // Node sizes are estimates, as the node types are private to the standard library
+    constexpr size_t MAP_NODE_BYTES = sizeof(void*) + sizeof(std::size_t) + sizeof(ChunkCoord) + sizeof(StoredEntry);
+    constexpr size_t LRU_NODE_BYTES = 2 * sizeof(void*) + sizeof(ChunkCoord);
+
+    return sizeof(ChunkStoreEntry) + MAP_NODE_BYTES + LRU_NODE_BYTES;
+}
+
+void ChunkStoreHandle::evict_to_budget(const ChunkCoord& keep) {
+    const auto [focus_x, focus_y, focus_z] = focus;
+
+    while (_bytes_used > max_bytes && !lru.empty()) {
+        auto victim = lru.end();
+        int victim_dist = 0;
+
+        auto it = lru.end();
+        for (unsigned int i = 0; i < config::CHUNK_EVICTION_CANDIDATES && it != lru.begin(); i++) {
+            --it;
+            if (*it == keep) continue;
+
+            const auto [chunk_x, chunk_y, chunk_z] = *it;
+            const int dist = std::max({std::abs(chunk_x - focus_x), std::abs(chunk_y - focus_y),
+                                       std::abs(chunk_z - focus_z)});
+
+            // Ties go to the least recently used, which is found first
+            if (victim == lru.end() || dist > victim_dist) {
+                victim = it;
+                victim_dist = dist;
+            }
+        }
+
+        if (victim == lru.end()) break;
+
+        auto victim_it = map.find(*victim);
+        _bytes_used -= entry_bytes();
+        entries.destroy(victim_it->second.entry);
+        map.erase(victim_it);
+        lru.erase(victim);
+    }
+}
+
+ChunkStore::ChunkStore(size_t max_bytes, uint32_t worldgen_seed, MeshUploadQueue* mesh_uploads,
+                       WakeSignal* on_change)
+    : handle(max_bytes),
+      chunk_generator(worldgen_seed),
+      light_lookup([this](int chunk_x, int chunk_y, int chunk_z) -> LightEngine::ChunkRef {
+          if (chunk_y > config::MAX_CHUNK_Y || chunk_y < config::MIN_CHUNK_Y) return {};
+          if (chunk_x > config::MAX_CHUNK_X || chunk_x < config::MIN_CHUNK_X) return {};
+          if (chunk_z > config::MAX_CHUNK_Z || chunk_z < config::MIN_CHUNK_Z) return {};
+
+          ChunkStoreEntry* entry = handle.get(chunk_x, chunk_y, chunk_z);
+          if (entry == nullptr) return {};
+
+          // Without an upload queue chunks are never meshed, so light changes needn't flag them
+          return {.chunk = &entry->chunk,
+                  .light = &entry->light,
+                  .changed = this->mesh_uploads != nullptr ? &entry->needs_remesh : nullptr};
+      }),
+      mesh_uploads(mesh_uploads),
+      on_change(on_change),
+      tasks(config::mgr_thread_count()) {}
+
+void ChunkStore::notify_change() {
+    if (mesh_uploads != nullptr && on_change != nullptr) on_change->notify();
+}
+
+void ChunkStore::note_light_changes(LightEngine& engine) {
+    light_changed_chunks.clear();
+    engine.take_changed_chunks(light_changed_chunks);
+
+    for (const auto& [chunk_x, chunk_y, chunk_z] : light_changed_chunks) {
+        handle.note_flagged({chunk_x, chunk_y, chunk_z});
+    }
+}
+
+void ChunkStore::flag_meshed_neighbours(int chunk_x, int chunk_y, int chunk_z) {
+    for (int dz = -1; dz <= 1; dz++) {
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                if (dx == 0 && dy == 0 && dz == 0) continue;
+
+                // The lookup skips chunks out of the world
+                const LightEngine::ChunkRef neighbour = light_lookup(chunk_x + dx, chunk_y + dy, chunk_z + dz);
+                if (neighbour.chunk == nullptr) continue;
+
+                const ChunkStoreEntry* entry = handle.get(chunk_x + dx, chunk_y + dy, chunk_z + dz);
+                if (entry->meshed || entry->remesh_queued) handle.flag_remesh(chunk_x + dx, chunk_y + dy, chunk_z + dz);
+            }
+        }
+    }
+}
+
+void ChunkStore::copy_mesh_borders(int chunk_x, int chunk_y, int chunk_z, MeshBorders& borders) {
+    LightEngine::copy_padded(chunk_x, chunk_y, chunk_z, light_lookup, borders.light);
+
+    if constexpr (config::AMBIENT_OCCLUSION) {
+        std::array<const models::RenderingChunk*, 27> chunks;
+
+        for (int dz = -1; dz <= 1; dz++) {
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    chunks[(dx + 1) + (dy + 1) * 3 + (dz + 1) * 9] =
+                        light_lookup(chunk_x + dx, chunk_y + dy, chunk_z + dz).chunk;
+                }
+            }
+        }
+
+        borders.occupancy.fill(chunks);
+    }
+}
+
+void ChunkStore::mesh_chunk(int chunk_x, int chunk_y, int chunk_z, const models::RenderingChunk& chunk,
+                            const MeshBorders& borders) {
+    constexpr size_t MAX_INSTANCES = render::max_chunk_instances<
+        models::RenderingChunk::X_SIZE, models::RenderingChunk::Y_SIZE, models::RenderingChunk::Z_SIZE>();
+
+    // The vertex data is copied into the upload ring, so each worker reuses one buffer big enough for any chunk
+    thread_local std::unique_ptr<render::VertexDataInstance[]> instance_buffer =
+        std::make_unique_for_overwrite<render::VertexDataInstance[]>(MAX_INSTANCES);
 
+    const std::span<const render::VertexDataInstance> instances = render::generate_chunk_vertex_data(
+        chunk, borders.light, config::AMBIENT_OCCLUSION ? &borders.occupancy : nullptr, chunk_x, chunk_y, chunk_z,
+        std::span(instance_buffer.get(), MAX_INSTANCES));
+
+    const render::ChunkCulling culling{.face_connectivity = render::chunk_face_connectivity(chunk),
+                                       .solid_height = render::chunk_solid_height(chunk)};
+
+    {
+        std::scoped_lock<std::mutex> lock(mutex);
+
+        // Unloaded while it was being meshed
+        if (handle.get(chunk_x, chunk_y, chunk_z) == nullptr) return;
+    }
+
+    // Pushing can wait for the render thread to free staging space, which may need the lock.
+    // No other mesh of the chunk is pushed meanwhile, as remesh_queued is still set.
+    const bool pushed = mesh_uploads->push(0, chunk_x, chunk_y, chunk_z, render::instance_bytes(instances),
+                                           instances.size(), culling);
+
+    std::scoped_lock<std::mutex> lock(mutex);
+
+    ChunkStoreEntry* entry = handle.get(chunk_x, chunk_y, chunk_z);
+    if (entry == nullptr) return;
+
+    entry->meshed = pushed;
+    entry->remesh_queued = false;
+
+    // Changed while it was being meshed
+    if (entry->needs_remesh) notify_change();
+}
+
+void ChunkStore::load_chunk(int chunk_x, int chunk_y, int chunk_z) {
     ChunkStoreEntry entry = ChunkStoreEntry();
-    chunk_generator.generate(entry.chunk, chunk_x, chunk_y, chunk_z);
-    entry.instance_count =
-        render::generate_chunk_vertex_data(entry.chunk, chunk_x, chunk_y, chunk_z, entry.vertex_data);
+    std::array<int, models::RenderingChunk::X_SIZE * models::RenderingChunk::Z_SIZE> surface_heights;
+    chunk_generator.generate(entry.chunk, chunk_x, chunk_y, chunk_z, surface_heights);
+
+    // Light the chunk on its own first, so only propagation across its borders needs to hold the lock.
+    // Each worker keeps its engine, so the propagation queues keep their capacity between chunks.
+    thread_local LightEngine load_light_engine;
+
+    const auto light_start = std::chrono::steady_clock::now();
+    [[maybe_unused]] unsigned int light_visited =
+        load_light_engine.light_isolated(entry.chunk, entry.light, chunk_y, surface_heights);
+
+    {
+        std::scoped_lock<std::mutex> lock(mutex);
+
+        // Already loaded by another job
+        if (handle.get(chunk_x, chunk_y, chunk_z) != nullptr) return;
+
+        handle.put(chunk_x, chunk_y, chunk_z, entry, interest.contains({chunk_x, chunk_y, chunk_z}));
+        load_light_engine.join_neighbours(chunk_x, chunk_y, chunk_z, light_lookup);
+        light_visited += load_light_engine.propagate(light_lookup, config::LIGHT_JOIN_SLICE_VOXELS);
+        note_light_changes(load_light_engine);
+
+        if (mesh_uploads != nullptr) {
+            handle.flag_remesh(chunk_x, chunk_y, chunk_z);
+            flag_meshed_neighbours(chunk_x, chunk_y, chunk_z);
+        }
+    }
+
+    // The rest of the join is done in slices, letting others take the lock in between. Chunks whose light changes after
+    // they are meshed are flagged again, and this chunk isn't meshed until its load finishes.
+    while (load_light_engine.propagating()) {
+        std::scoped_lock<std::mutex> lock(mutex);
+
+        light_visited += load_light_engine.propagate(light_lookup, config::LIGHT_JOIN_SLICE_VOXELS);
+        note_light_changes(load_light_engine);
+    }
+
+    [[maybe_unused]] const float light_seconds =
+        std::chrono::duration<float>(std::chrono::steady_clock::now() - light_start).count();
+    TracyPlot("light_voxels_per_sec", (float)light_visited / light_seconds);
+
+    _chunks_loaded.fetch_add(1, std::memory_order::relaxed);
+
+    // The chunk, and neighbours whose light changed, need meshing
+    notify_change();
+}
+
+void ChunkStore::remesh_chunk(int chunk_x, int chunk_y, int chunk_z) {
+    if (mesh_uploads == nullptr) return;
+
+    models::RenderingChunk chunk;
+    MeshBorders borders;
+
+    {
+        std::scoped_lock<std::mutex> lock(mutex);
+
+        ChunkStoreEntry* entry = handle.get(chunk_x, chunk_y, chunk_z);
+        if (entry == nullptr) return;
+
+        // Noted again so it isn't forgotten, as the running mesh may have copied the chunk before it was flagged
+        if (entry->remesh_queued) {
+            if (entry->needs_remesh) handle.note_flagged({chunk_x, chunk_y, chunk_z});
+            return;
+        }
+
+        // Changes after this point will cause another remesh
+        entry->remesh_queued = true;
+        entry->needs_remesh = false;
+        chunk = entry->chunk;
+        copy_mesh_borders(chunk_x, chunk_y, chunk_z, borders);
+    }
+
+    mesh_chunk(chunk_x, chunk_y, chunk_z, chunk, borders);
+}
+
+void ChunkStore::set_block(int x, int y, int z, models::Block block) {
+    ZoneScopedN("ChunkStore::set_block");
+
+    constexpr int X_SIZE = models::RenderingChunk::X_SIZE;
+    constexpr int Y_SIZE = models::RenderingChunk::Y_SIZE;
+    constexpr int Z_SIZE = models::RenderingChunk::Z_SIZE;
+
+    const int chunk_x = floor_div(x, X_SIZE);
+    const int chunk_y = floor_div(y, Y_SIZE);
+    const int chunk_z = floor_div(z, Z_SIZE);
+
+    if (chunk_y > config::MAX_CHUNK_Y || chunk_y < config::MIN_CHUNK_Y) return;
 
     std::scoped_lock<std::mutex> lock(mutex);
-    handle.put(chunk_x, chunk_y, chunk_z, entry);
+
+    ChunkStoreEntry* entry = handle.get(chunk_x, chunk_y, chunk_z);
+    if (entry == nullptr) return;
+
+    entry->chunk[x - chunk_x * X_SIZE, y - chunk_y * Y_SIZE, z - chunk_z * Z_SIZE] = block;
+    if (mesh_uploads != nullptr) handle.flag_remesh(chunk_x, chunk_y, chunk_z);
+
+    [[maybe_unused]] unsigned int light_visited = light_engine.update_block(x, y, z, light_lookup);
+    note_light_changes(light_engine);
+    TracyPlot("light_update_voxels", (int64_t)light_visited);
+
+    notify_change();
 }
 
-void ChunkStore::load_n_around_on_pool(ThreadPool& pool, int chunk_x, int chunk_y, int chunk_z, int n) {
+bool ChunkStore::encode_chunk(int chunk_x, int chunk_y, int chunk_z, std::vector<uint8_t>& send_buffer) {
+    ZoneScopedN("ChunkStore::encode_chunk");
+
+    constexpr size_t MAX_SIZE = net::max_encoded_chunk_size<
+        models::RenderingChunk::X_SIZE, models::RenderingChunk::Y_SIZE, models::RenderingChunk::Z_SIZE>();
+
     std::scoped_lock<std::mutex> lock(mutex);
 
-    // Get jobs to load the chunks in each direction, including the chunk itself
-    std::vector<std::function<void()>> jobs_todo;
+    const ChunkStoreEntry* entry = handle.get(chunk_x, chunk_y, chunk_z);
+    if (entry == nullptr) return false;
 
-    for (int dx = -n; dx <= n; dx++) {
-        if (chunk_x + dx > config::MAX_CHUNK_X || chunk_x + dx < config::MIN_CHUNK_X) continue;
+    const size_t start = send_buffer.size();
+    send_buffer.resize(start + MAX_SIZE);
 
-        for (int dy = -n; dy <= n; dy++) {
-            if (chunk_y + dy > config::MAX_CHUNK_Y || chunk_y + dy < config::MIN_CHUNK_Y) continue;
+    size_t size;
+    try {
+        size = net::encode_chunk(entry->chunk, chunk_x, chunk_y, chunk_z, std::span(send_buffer).subspan(start));
+    } catch (...) {
+        // Don't leave the unwritten space in the buffer
+        send_buffer.resize(start);
+        throw;
+    }
 
-            for (int dz = -n; dz <= n; dz++) {
-                if (chunk_z + dz > config::MAX_CHUNK_Z || chunk_z + dz < config::MIN_CHUNK_Z) continue;
+    send_buffer.resize(start + size);
 
-                int new_chunk_x = chunk_x + dx;
-                int new_chunk_y = chunk_y + dy;
-                int new_chunk_z = chunk_z + dz;
+    return true;
+}
 
-                ChunkStoreEntry* maybe_chunk = handle.get_and_mark_used(new_chunk_x, new_chunk_y, new_chunk_z);
+void ChunkStore::load_queued_chunk(int chunk_x, int chunk_y, int chunk_z) {
+    {
+        std::scoped_lock<std::mutex> lock(mutex);
 
-                if (maybe_chunk == nullptr) {
-                    jobs_todo.push_back([this, new_chunk_x, new_chunk_y, new_chunk_z] {
-                        load_chunk(new_chunk_x, new_chunk_y, new_chunk_z);
-                    });
-                }
+        const ChunkCoord coord = {chunk_x, chunk_y, chunk_z};
+        if (!interest.contains(coord) && !prefetch_interest.contains(coord)) return;
+    }
+
+    load_chunk(chunk_x, chunk_y, chunk_z);
+}
+
+void ChunkStore::add_load_task(const ChunkCoord& coord, float priority) {
+    const auto [chunk_x, chunk_y, chunk_z] = coord;
+    tasks.add({LOAD_STAGE, coord}, priority, {},
+              [this, chunk_x, chunk_y, chunk_z] { load_queued_chunk(chunk_x, chunk_y, chunk_z); });
+}
+
+void ChunkStore::add_mesh_task(const ChunkCoord& coord, float priority) {
+    const auto [chunk_x, chunk_y, chunk_z] = coord;
+
+    // A chunk's mesh depends on the blocks and light of its neighbours, so it waits for those being loaded
+    std::array<TaskKey, 27> dependencies;
+    size_t i = 0;
+
+    for (int dx = -1; dx <= 1; dx++) {
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dz = -1; dz <= 1; dz++) {
+                dependencies[i++] = {LOAD_STAGE, {chunk_x + dx, chunk_y + dy, chunk_z + dz}};
             }
         }
     }
 
-    pool.enqueue(jobs_todo);
+    tasks.add({MESH_STAGE, coord}, priority, dependencies,
+              [this, chunk_x, chunk_y, chunk_z] { remesh_chunk(chunk_x, chunk_y, chunk_z); });
 }
 
-void ChunkStore::use_handle(const std::function<void(ChunkStoreHandle&)>& f) {
+void ChunkStore::update_interest_on_pool(ThreadPool& pool, std::span<const InterestPoint> points,
+                                         const std::optional<LoadBias>& bias,
+                                         std::span<const InterestPoint> prefetch_points) {
+    ZoneScopedN("ChunkStore::update_interest_on_pool");
+
     std::scoped_lock<std::mutex> lock(mutex);
-    f(handle);
+
+    if (!points.empty()) handle.set_focus(points[0].chunk_x, points[0].chunk_y, points[0].chunk_z);
+
+    entered_interest.clear();
+    left_interest.clear();
+    interest.update(points, entered_interest, left_interest);
+
+    entered_prefetch.clear();
+    left_prefetch.clear();
+    prefetch_interest.update(prefetch_points, entered_prefetch, left_prefetch);
+
+    TracyPlot("chunk_store_bytes", (int64_t)handle.bytes_used());
+    TracyPlot("chunk_store_chunks", (int64_t)handle.size());
+    TracyPlot("interest_chunks", (int64_t)interest.size());
+    TracyPlot("prefetch_chunks", (int64_t)prefetch_interest.size());
+
+    for (const ChunkCoord& coord : left_interest) handle.set_pinned(coord, false);
+
+    prioritised_loads.clear();
+    prioritised_meshes.clear();
+    prioritised_prefetches.clear();
+
+    for (const ChunkCoord& coord : entered_interest) {
+        const auto [chunk_x, chunk_y, chunk_z] = coord;
+        const float priority = bias ? load_priority(coord, *bias) : 0.0f;
+
+        if (const ChunkStoreEntry* entry = handle.get(chunk_x, chunk_y, chunk_z); entry != nullptr) {
+            handle.set_pinned(coord, true);
+
+            // Prefetched chunks, and flagged chunks which were dropped below while out of range, are meshed now
+            if (entry->needs_remesh) prioritised_meshes.push_back({priority, coord});
+        } else {
+            prioritised_loads.push_back({priority, coord});
+            prioritised_meshes.push_back({priority, coord});
+        }
+    }
+
+    for (const ChunkCoord& coord : entered_prefetch) {
+        const auto [chunk_x, chunk_y, chunk_z] = coord;
+        if (interest.contains(coord) || handle.get(chunk_x, chunk_y, chunk_z) != nullptr) continue;
+
+        prioritised_prefetches.push_back({bias ? load_priority(coord, *bias) : 0.0f, coord});
+    }
+
+    // Ties run in the order they are added
+    if (bias) {
+        for (auto* prioritised : {&prioritised_loads, &prioritised_meshes, &prioritised_prefetches}) {
+            std::sort(prioritised->begin(), prioritised->end(),
+                      [](const auto& a, const auto& b) { return a.first < b.first; });
+        }
+    }
+
+    for (const auto& [priority, coord] : prioritised_loads) add_load_task(coord, priority);
+
+    // Only loaded. They keep their priority when they come into range, as their load task is already in the graph, so
+    // they are ordered by the same bias rather than put behind the chunks in range.
+    for (const auto& [priority, coord] : prioritised_prefetches) add_load_task(coord, priority);
+
+    if (mesh_uploads != nullptr) {
+        for (const auto& [priority, coord] : prioritised_meshes) add_mesh_task(coord, priority);
+
+        // Only the chunks flagged for remeshing (by loads, the light engine and the renderer) since the last update are
+        // visited. Chunks being meshed are kept for a later update, and those with a mesh task waiting are skipped by
+        // the graph.
+        handle.take_flagged(flagged_remeshes);
+
+        for (const ChunkCoord& coord : flagged_remeshes) {
+            const auto [chunk_x, chunk_y, chunk_z] = coord;
+
+            const ChunkStoreEntry* entry = handle.get(chunk_x, chunk_y, chunk_z);
+            if (entry == nullptr || !entry->needs_remesh || !interest.contains(coord)) continue;
+
+            if (entry->remesh_queued) {
+                handle.note_flagged(coord);
+                continue;
+            }
+
+            tasks.add({MESH_STAGE, coord}, bias ? load_priority(coord, *bias) : 0.0f, {},
+                      [this, chunk_x, chunk_y, chunk_z] { remesh_chunk(chunk_x, chunk_y, chunk_z); });
+        }
+
+        TracyPlot("flagged_remeshes", (int64_t)flagged_remeshes.size());
+    }
+
+    [[maybe_unused]] const TaskGraphStats stats = tasks.take_stats();
+    TracyPlot("task_graph_added", (int64_t)stats.added);
+    TracyPlot("task_graph_deduplicated", (int64_t)stats.deduplicated);
+
+    tasks.start(pool);
+}
+
+void ChunkStore::use_handle(const std::function<void(ChunkStoreHandle&)>& f) {
+    {
+        std::scoped_lock<std::mutex> lock(mutex);
+        f(handle);
+    }
+
+    notify_change();
 }
\ No newline at end of file
@@ -0,0 +1,113 @@
+#include <mgr/interest.h>
+#include <config.h>
+#include <algorithm>
+#include <cmath>
+#include <optional>
+
+using namespace mgr;
+
+float mgr::load_priority(const ChunkCoord& coord, const LoadBias& bias) {
+    const auto [chunk_x, chunk_y, chunk_z] = coord;
+
+    // Measured from the middle of the chunk
+    const float dx = chunk_x + 0.5f - bias.position[0];
+    const float dy = chunk_y + 0.5f - bias.position[1];
+    const float dz = chunk_z + 0.5f - bias.position[2];
+
+    const float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+    if (distance == 0.0f) return 0.0f;
+
+    const float cos_angle = (dx * bias.direction[0] + dy * bias.direction[1] + dz * bias.direction[2]) / distance;
+    return distance * (1.0f - 0.5f * cos_angle);
+}
+
+InterestSet::Box InterestSet::box_around(const InterestPoint& point) {
+    return {.min = {std::max(point.chunk_x - point.radius, config::MIN_CHUNK_X),
+                    std::max(point.chunk_y - point.radius, config::MIN_CHUNK_Y),
+                    std::max(point.chunk_z - point.radius, config::MIN_CHUNK_Z)},
+            .max = {std::min(point.chunk_x + point.radius, config::MAX_CHUNK_X),
+                    std::min(point.chunk_y + point.radius, config::MAX_CHUNK_Y),
+                    std::min(point.chunk_z + point.radius, config::MAX_CHUNK_Z)}};
+}
+
+// Calls f for each chunk in the box from min to max, inclusive
+template <typename F>
+static void for_each_in_box(const std::array<int, 3>& min, const std::array<int, 3>& max, F&& f) {
+    for (int x = min[0]; x <= max[0]; x++) {
+        for (int y = min[1]; y <= max[1]; y++) {
+            for (int z = min[2]; z <= max[2]; z++) {
+                f(ChunkCoord{x, y, z});
+            }
+        }
+    }
+}
+
+// Calls f for each chunk in box a which is not in box b, without visiting the chunks they share.
+// The part of a outside b is split into up to 6 slabs: either side of b along x, then along y within b's x range, then
+// along z within b's x and y ranges.
+template <typename Box, typename F>
+static void for_each_in_difference(const Box& a, const std::optional<Box>& b, F&& f) {
+    for (unsigned int axis = 0; axis < 3; axis++) {
+        if (!b || b->max[axis] < a.min[axis] || b->min[axis] > a.max[axis]) {
+            for_each_in_box(a.min, a.max, f);
+            return;
+        }
+    }
+
+    std::array<int, 3> min = a.min;
+    std::array<int, 3> max = a.max;
+
+    for (unsigned int axis = 0; axis < 3; axis++) {
+        // Below b
+        if (min[axis] < b->min[axis]) {
+            std::array<int, 3> slab_max = max;
+            slab_max[axis] = b->min[axis] - 1;
+            for_each_in_box(min, slab_max, f);
+            min[axis] = b->min[axis];
+        }
+
+        // Above b
+        if (max[axis] > b->max[axis]) {
+            std::array<int, 3> slab_min = min;
+            slab_min[axis] = b->max[axis] + 1;
+            for_each_in_box(slab_min, max, f);
+            max[axis] = b->max[axis];
+        }
+    }
+}
+
+void InterestSet::update(std::span<const InterestPoint> points, std::vector<ChunkCoord>& entered,
+                         std::vector<ChunkCoord>& left) {
+    std::unordered_map<uint64_t, Box> new_boxes;
+    new_boxes.reserve(points.size());
+
+    // References are all added before any are removed, so a chunk passed from one point to another is never reported
+    // as leaving and entering
+    for (const InterestPoint& point : points) {
+        const Box box = box_around(point);
+        new_boxes.emplace(point.id, box);
+
+        auto old = boxes.find(point.id);
+        const std::optional<Box> old_box = old != boxes.end() ? std::optional(old->second) : std::nullopt;
+
+        for_each_in_difference(box, old_box, [this, &entered](const ChunkCoord& coord) {
+            if (refs[coord]++ == 0) entered.push_back(coord);
+        });
+    }
+
+    for (const auto& [id, old_box] : boxes) {
+        auto now = new_boxes.find(id);
+        const std::optional<Box> box = now != new_boxes.end() ? std::optional(now->second) : std::nullopt;
+
+        for_each_in_difference(old_box, box, [this, &left](const ChunkCoord& coord) {
+            auto it = refs.find(coord);
+
+            if (--it->second == 0) {
+                refs.erase(it);
+                left.push_back(coord);
+            }
+        });
+    }
+
+    boxes = std::move(new_boxes);
+}
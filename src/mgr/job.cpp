@@ -0,0 +1,93 @@
+#include <mgr/job.h>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <mutex>
+#include <new>
+#include <vector>
+
+using namespace mgr;
+
+// Frames are rounded up to a power of two size class, and larger ones come straight from the heap
+static constexpr unsigned int MIN_CLASS_BITS = 6;
+static constexpr unsigned int MAX_CLASS_BITS = 16;
+static constexpr size_t CLASS_COUNT = MAX_CLASS_BITS - MIN_CLASS_BITS + 1;
+
+// Each thread keeps up to two batches of free frames of each size, and swaps whole batches with the shared lists, so
+// the shared lock is taken once per batch
+static constexpr size_t BATCH_SIZE = 32;
+
+struct SharedFrames {
+    std::mutex mutex;
+    std::array<std::vector<void*>, CLASS_COUNT> frames;
+
+    ~SharedFrames() {
+        for (size_t size_class = 0; size_class < CLASS_COUNT; size_class++) {
+            for (void* frame : frames[size_class]) ::operator delete(frame, size_t{1} << (size_class + MIN_CLASS_BITS));
+        }
+    }
+};
+
+static SharedFrames shared_frames;
+
+struct ThreadFrames {
+    std::array<std::vector<void*>, CLASS_COUNT> frames;
+
+    ~ThreadFrames() {
+        std::scoped_lock<std::mutex> lock(shared_frames.mutex);
+
+        for (size_t size_class = 0; size_class < CLASS_COUNT; size_class++) {
+            shared_frames.frames[size_class].insert(shared_frames.frames[size_class].end(),
+                                                    frames[size_class].begin(), frames[size_class].end());
+        }
+    }
+};
+
+static thread_local ThreadFrames thread_frames;
+
+static size_t size_class(size_t size) {
+    return std::bit_width(std::max(size, size_t{1} << MIN_CLASS_BITS) - 1) - MIN_CLASS_BITS;
+}
+
+void* mgr::allocate_job_frame(size_t size) {
+    const size_t frame_class = size_class(size);
+    if (frame_class >= CLASS_COUNT) return ::operator new(size);
+
+    std::vector<void*>& frames = thread_frames.frames[frame_class];
+
+    if (frames.empty()) {
+        std::scoped_lock<std::mutex> lock(shared_frames.mutex);
+        std::vector<void*>& shared = shared_frames.frames[frame_class];
+
+        const size_t count = std::min(BATCH_SIZE, shared.size());
+        frames.insert(frames.end(), shared.end() - count, shared.end());
+        shared.resize(shared.size() - count);
+    }
+
+    if (frames.empty()) return ::operator new(size_t{1} << (frame_class + MIN_CLASS_BITS));
+
+    void* frame = frames.back();
+    frames.pop_back();
+    return frame;
+}
+
+void mgr::free_job_frame(void* frame, size_t size) {
+    const size_t frame_class = size_class(size);
+
+    if (frame_class >= CLASS_COUNT) {
+        ::operator delete(frame, size);
+        return;
+    }
+
+    std::vector<void*>& frames = thread_frames.frames[frame_class];
+    if (frames.capacity() == 0) frames.reserve(2 * BATCH_SIZE);
+
+    frames.push_back(frame);
+    if (frames.size() < 2 * BATCH_SIZE) return;
+
+    std::scoped_lock<std::mutex> lock(shared_frames.mutex);
+    std::vector<void*>& shared = shared_frames.frames[frame_class];
+
+    shared.insert(shared.end(), frames.end() - BATCH_SIZE, frames.end());
+    frames.resize(frames.size() - BATCH_SIZE);
+}
@@ -0,0 +1,197 @@
+#include <mgr/lodstore.h>
+#include <config.h>
+#include <render/mesher.h>
+#include <render/visibility.h>
+#include <memory>
+#include <tracy/Tracy.hpp>
+
+using namespace mgr;
+
+static constexpr unsigned int TOP_LEVEL = config::LOD_LEVELS + config::FAR_TERRAIN_LEVELS;
+
+// The radius of the hole in the ring of a level, in nodes of that level
+static constexpr int hole_radius(unsigned int level) {
+    if (level <= config::LOD_LEVELS) return config::LOD_HOLE_RADIUS;
+
+    // The far terrain starts where the level of detail rings end
+    return config::LOD_RENDER_DISTANCE >> (config::LOD_LEVELS + 1);
+}
+
+// The radius of the coarsest ring in nodes of the coarsest level
+static constexpr int TOP_RADIUS =
+    ((config::FAR_TERRAIN_LEVELS > 0 ? config::FAR_TERRAIN_DISTANCE : config::LOD_RENDER_DISTANCE) +
+     (1 << TOP_LEVEL) - 1) >>
+    TOP_LEVEL;
+
+static_assert(config::LOD_LEVELS >= 1, "there must be at least one level of detail ring");
+static_assert(2 * hole_radius(1) + 1 <= config::RENDER_DISTANCE,
+              "the full resolution chunks must be loaded as far as the hole of the first ring reaches");
+static_assert(TOP_RADIUS > hole_radius(TOP_LEVEL), "the coarsest ring must not be empty");
+
+static constexpr bool holes_nest() {
+    // The hole of each level must fit inside the nodes in the hole of the next coarser level
+    for (unsigned int level = 1; level < TOP_LEVEL; level++) {
+        if (2 * hole_radius(level + 1) < hole_radius(level)) return false;
+    }
+
+    return true;
+}
+
+static_assert(holes_nest(), "level of detail ring holes must nest");
+
+bool mgr::lod_node_in_ring(unsigned int level, int node_x, int node_z, int camera_chunk_x, int camera_chunk_z,
+                           int margin) {
+    // Right shifts round towards negative infinity, giving the node containing the camera
+    const int dist = std::max(std::abs(node_x - (camera_chunk_x >> level)), std::abs(node_z - (camera_chunk_z >> level)));
+
+    // Inside the hole covered by the next finer level
+    if (level > 0 && dist <= hole_radius(level) - margin) return false;
+
+    if (level == TOP_LEVEL) return dist <= TOP_RADIUS + margin;
+
+    // Inside the hole of the next coarser level
+    const int parent_dist = std::max(std::abs((node_x >> 1) - (camera_chunk_x >> (level + 1))),
+                                     std::abs((node_z >> 1) - (camera_chunk_z >> (level + 1))));
+
+    return parent_dist <= hole_radius(level + 1) + margin;
+}
+
+int mgr::lod_ring_extent(unsigned int level) {
+    return level == TOP_LEVEL ? TOP_RADIUS + 1 : 2 * (hole_radius(level + 1) + 2);
+}
+
+Task<> LodStore::generate_node(models::RenderingChunk& chunk, unsigned int level, int node_x, int node_y,
+                               int node_z) {
+    generator.generate_lod(chunk, node_x, node_y, node_z, level);
+    co_return;
+}
+
+Task<std::span<const render::VertexDataInstance>> LodStore::mesh_node(const models::RenderingChunk& chunk,
+                                                                      unsigned int level, int node_x, int node_y,
+                                                                      int node_z,
+                                                                      std::span<render::VertexDataInstance> out) {
+    // Nodes are meshed on their own, with full sky light and only their own voxels occluding.
+    // Faces on the edges of nodes are always kept, which covers cracks between levels.
+    models::PaddedChunkLight<models::RenderingChunk::X_SIZE, models::RenderingChunk::Y_SIZE,
+                             models::RenderingChunk::Z_SIZE>
+        light;
+    models::PaddedOccupancy<models::RenderingChunk::X_SIZE, models::RenderingChunk::Y_SIZE,
+                            models::RenderingChunk::Z_SIZE>
+        occupancy;
+
+    std::array<const models::RenderingChunk*, 27> chunks{};
+    chunks[13] = &chunk;
+    occupancy.fill(chunks);
+
+    co_return render::generate_chunk_vertex_data(chunk, light, config::AMBIENT_OCCLUSION ? &occupancy : nullptr,
+                                                 node_x, node_y, node_z, out, 1u << level);
+}
+
+Job LodStore::load_node(unsigned int level, int node_x, int node_y, int node_z, std::stop_token unloaded) {
+    if (unloaded.stop_requested()) co_return;
+
+    models::RenderingChunk chunk;
+    co_await generate_node(chunk, level, node_x, node_y, node_z);
+
+    // Left the rings while it was being generated
+    if (unloaded.stop_requested()) co_return;
+
+    // The job is started on the worker and its tasks finish on the same thread, as it never awaits resume_on, so each
+    // worker reuses one buffer big enough for any node. The vertex data is copied into the upload ring before the job
+    // finishes.
+    constexpr size_t MAX_INSTANCES = render::max_chunk_instances<
+        models::RenderingChunk::X_SIZE, models::RenderingChunk::Y_SIZE, models::RenderingChunk::Z_SIZE>();
+    thread_local std::unique_ptr<render::VertexDataInstance[]> instance_buffer =
+        std::make_unique_for_overwrite<render::VertexDataInstance[]>(MAX_INSTANCES);
+
+    const std::span<const render::VertexDataInstance> instances =
+        co_await mesh_node(chunk, level, node_x, node_y, node_z, std::span(instance_buffer.get(), MAX_INSTANCES));
+
+    if (unloaded.stop_requested()) co_return;
+
+    // Pushing can wait for the render thread to free staging space, which may need the lock.
+    // No other mesh of the node is pushed meanwhile, as it is not marked loaded yet.
+    // Nodes are never culled by the chunk visibility walk, and don't occlude
+    if (!mesh_uploads.push(level, node_x, node_y, node_z, render::instance_bytes(instances), instances.size(),
+                           render::ChunkCulling{})) {
+        co_return;
+    }
+
+    std::scoped_lock<std::mutex> lock(mutex);
+
+    // Unloaded while it was being pushed
+    if (unloaded.stop_requested()) co_return;
+
+    nodes.at({level, node_x, node_y, node_z}).loaded = true;
+}
+
+void LodStore::load_rings_on_pool(ThreadPool& pool, int camera_chunk_x, int camera_chunk_z) {
+    ZoneScopedN("LodStore::load_rings_on_pool");
+
+    std::scoped_lock<std::mutex> lock(mutex);
+
+    // Keep nodes just outside the rings, so moving back and forth doesn't regenerate them
+    std::erase_if(nodes, [camera_chunk_x, camera_chunk_z](auto& item) {
+        const auto& [level, node_x, node_y, node_z] = item.first;
+        if (lod_node_in_ring(level, node_x, node_z, camera_chunk_x, camera_chunk_z, 2)) return false;
+
+        item.second.unloaded.request_stop();
+        return true;
+    });
+
+    // Jobs are queued as plain functions which start the coroutine, so a queued node doesn't hold a frame
+    std::vector<std::function<void()>> jobs_todo;
+
+    for (unsigned int level = 1; level <= config::LOD_LEVELS; level++) {
+        const int camera_node_x = camera_chunk_x >> level;
+        const int camera_node_z = camera_chunk_z >> level;
+
+        const int extent = lod_ring_extent(level);
+
+        for (int node_x = camera_node_x - extent; node_x <= camera_node_x + extent; node_x++) {
+            for (int node_z = camera_node_z - extent; node_z <= camera_node_z + extent; node_z++) {
+                if (!lod_node_in_ring(level, node_x, node_z, camera_chunk_x, camera_chunk_z, 1)) continue;
+
+                for (int node_y = config::MIN_CHUNK_Y >> level; node_y <= config::MAX_CHUNK_Y >> level; node_y++) {
+                    auto [it, inserted] = nodes.try_emplace({level, node_x, node_y, node_z});
+
+                    if (inserted || it->second.needs_remesh) {
+                        it->second.needs_remesh = false;
+                        it->second.loaded = false;
+                        jobs_todo.push_back([this, level, node_x, node_y, node_z,
+                                             unloaded = it->second.unloaded.get_token()] {
+                            load_node(level, node_x, node_y, node_z, unloaded);
+                        });
+                    }
+                }
+            }
+        }
+    }
+
+    pool.enqueue(jobs_todo);
+}
+
+void LodStore::request_remesh(std::span<const std::tuple<unsigned int, int, int, int>> nodes_to_remesh) {
+    {
+        std::scoped_lock<std::mutex> lock(mutex);
+
+        for (const NodeCoord& coord : nodes_to_remesh) {
+            auto it = nodes.find(coord);
+            if (it != nodes.end() && it->second.loaded) it->second.needs_remesh = true;
+        }
+    }
+
+    if (on_change != nullptr) on_change->notify();
+}
+
+void LodStore::for_each_loaded(
+    const std::function<void(unsigned int level, int node_x, int node_y, int node_z, const LodStoreEntry&)>& f) {
+    std::scoped_lock<std::mutex> lock(mutex);
+
+    for (const auto& [coord, entry] : nodes) {
+        if (!entry.loaded) continue;
+
+        const auto& [level, node_x, node_y, node_z] = coord;
+        f(level, node_x, node_y, node_z, entry);
+    }
+}
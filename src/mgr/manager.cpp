@@ -1,36 +1,153 @@
 #include <mgr/manager.h>
 #include <config.h>
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <cmath>
+#include <optional>
 #include <iostream>
+#include <utility>
+#include <tracy/Tracy.hpp>
 
 using namespace mgr;
 
 void Manager::manager_main() {
+    std::vector<InterestPoint> interest_points;
+    std::vector<InterestPoint> prefetch_points;
+
+    // Long enough ago that the first tick happens at once
+    std::chrono::steady_clock::time_point last_tick;
+
     while (!should_stop.load(std::memory_order::relaxed)) {
+        // Ticks anyway after a while, in case a change was missed
+        const std::optional<std::chrono::steady_clock::time_point> woken =
+            wake_signal.wait_until(last_tick + config::MGR_MAX_TICK_INTERVAL);
+
+        if (should_stop.load(std::memory_order::relaxed)) break;
+
+        // Changes made while waiting out the rest of the interval are coalesced into this tick
+        std::this_thread::sleep_until(last_tick + config::MGR_MIN_TICK_INTERVAL);
+        wake_signal.clear();
+
         const auto now = std::chrono::steady_clock::now();
-        const auto wake_time = now + config::MGR_TICK_DURATION;
+        last_tick = now;
+
+        if (woken) {
+            [[maybe_unused]] const float wake_latency_ms =
+                std::chrono::duration<float, std::milli>(now - *woken).count();
+            TracyPlot("manager_wake_latency_ms", wake_latency_ms);
+        }
 
         // TODO: only add more jobs if the queue is not too full?
         // FIXME: in debug mode chunk loading can be slow, sometimes causing them to not load at all
 
-        // Load chunks around the player
         auto shared_state = _shared_state.get();
-        _chunk_store.load_n_around_on_pool(thread_pool, shared_state.chunk_x, shared_state.chunk_y,
-                                           shared_state.chunk_z, config::RENDER_DISTANCE + 2);
 
-        std::this_thread::sleep_until(wake_time);
+        interest_points.clear();
+        prefetch_points.clear();
+
+        std::optional<LoadBias> load_bias;
+
+        // The player comes first, so it is the focus for eviction
+        if (!headless) {
+            interest_points.push_back({.id = PLAYER_INTEREST_ID,
+                                       .chunk_x = shared_state.chunk_x,
+                                       .chunk_y = shared_state.chunk_y,
+                                       .chunk_z = shared_state.chunk_z,
+                                       .radius = config::RENDER_DISTANCE + 2});
+
+            // The chunks the player is heading towards are loaded before they get there, rather than once they are in
+            // range, as fast movement can outrun loading. They are only meshed once in range, as the renderer frees
+            // meshes beyond it.
+            std::array<int, 3> ahead;
+            for (unsigned int axis = 0; axis < 3; axis++) {
+                ahead[axis] = std::clamp((int)std::round(shared_state.velocity[axis] * config::PREFETCH_SECONDS),
+                                         -config::MAX_PREFETCH_DISTANCE, config::MAX_PREFETCH_DISTANCE);
+            }
+
+            if (ahead != std::array<int, 3>{0, 0, 0}) {
+                prefetch_points.push_back({.id = PLAYER_PREFETCH_INTEREST_ID,
+                                           .chunk_x = shared_state.chunk_x + ahead[0],
+                                           .chunk_y = shared_state.chunk_y + ahead[1],
+                                           .chunk_z = shared_state.chunk_z + ahead[2],
+                                           .radius = config::RENDER_DISTANCE + 2});
+            }
+
+            load_bias = LoadBias{.position = {shared_state.chunk_x + 0.5f, shared_state.chunk_y + 0.5f,
+                                              shared_state.chunk_z + 0.5f},
+                                 .direction = shared_state.view_direction};
+        }
+
+        {
+            std::scoped_lock<std::mutex> lock(interest_mutex);
+            interest_points.insert(interest_points.end(), other_interest_points.begin(), other_interest_points.end());
+        }
+
+        // Load chunks around the interest points
+        _chunk_store.update_interest_on_pool(thread_pool, interest_points, load_bias, prefetch_points);
+
+        if (!headless) {
+            // Load the lower detail rings beyond them
+            _lod_store.load_rings_on_pool(thread_pool, shared_state.chunk_x, shared_state.chunk_z);
+
+            // And the far terrain beyond those
+            _terrain_store.load_rings_on_pool(thread_pool, shared_state.chunk_x, shared_state.chunk_z);
+        }
+
+        const float tick_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - now).count();
+        TracyPlot("manager_tick_ms", tick_ms);
+
+        {
+            std::scoped_lock<std::mutex> lock(tick_stats_mutex);
+            tick_stats.ticks++;
+            tick_stats.total_ms += tick_ms;
+            tick_stats.max_ms = std::max(tick_stats.max_ms, tick_ms);
+        }
     }
 }
 
-Manager::Manager(SharedStateView initial_state, uint32_t worldgen_seed)
-    : _chunk_store(config::MAX_CHUNKS_LOADED, worldgen_seed),
-      _shared_state(initial_state),
+Manager::Manager(SharedStateView initial_state, uint32_t worldgen_seed, std::span<uint8_t> mesh_staging_memory)
+    : _mesh_uploads(mesh_staging_memory),
+      _chunk_store(config::CHUNK_STORE_BYTE_BUDGET, worldgen_seed, &_mesh_uploads, &wake_signal),
+      _lod_store(worldgen_seed, _mesh_uploads, &wake_signal),
+      _terrain_store(worldgen_seed),
+      _shared_state(initial_state, &wake_signal),
+      headless(false),
+      thread_pool(config::mgr_thread_count()) {
+    manager_thread = std::thread(&Manager::manager_main, this);
+}
+
+Manager::Manager(uint32_t worldgen_seed)
+    : _mesh_uploads(std::span<uint8_t>()),
+      _chunk_store(config::CHUNK_STORE_BYTE_BUDGET, worldgen_seed, nullptr, &wake_signal),
+      _lod_store(worldgen_seed, _mesh_uploads, &wake_signal),
+      _terrain_store(worldgen_seed),
+      _shared_state(SharedStateView{.chunk_x = 0, .chunk_y = 0, .chunk_z = 0}, &wake_signal),
+      headless(true),
       thread_pool(config::mgr_thread_count()) {
     manager_thread = std::thread(&Manager::manager_main, this);
 }
 
 Manager::~Manager() {
     should_stop.store(true, std::memory_order::relaxed);
+    wake_signal.notify();
 
     if (manager_thread.joinable()) manager_thread.join();
+
+    // Workers waiting for staging space would otherwise stop the thread pool from stopping
+    _mesh_uploads.close();
+}
+
+void Manager::set_interest_points(std::vector<InterestPoint> points) {
+    {
+        std::scoped_lock<std::mutex> lock(interest_mutex);
+        other_interest_points = std::move(points);
+    }
+
+    wake_signal.notify();
+}
+
+ManagerTickStats Manager::take_tick_stats() {
+    std::scoped_lock<std::mutex> lock(tick_stats_mutex);
+    return std::exchange(tick_stats, {});
 }
@@ -0,0 +1,110 @@
+#include <mgr/meshqueue.h>
+#include <assert.h>
+#include <cstring>
+
+using namespace mgr;
+
+bool MeshUploadQueue::push(unsigned int level, int x, int y, int z, std::span<const uint8_t> vertex_data,
+                           unsigned int instance_count, render::ChunkCulling culling) {
+    const size_t size = vertex_data.size();
+    assert(size <= ring.size());
+
+    size_t offset;
+    uint64_t seq;
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        // Meshes are never split, so a mesh which doesn't fit before the end of the ring skips to the start
+        auto padding = [this, size] { return head + size > ring.size() ? ring.size() - head : 0; };
+        auto has_space = [this, size, &padding] { return closed || used + padding() + size <= ring.size(); };
+
+        if (!has_space()) {
+            _stalls++;
+            space_cv.wait(lock, has_space);
+        }
+
+        if (closed) return false;
+
+        const size_t pad = padding();
+        offset = head + size > ring.size() ? 0 : head;
+        head = offset + size;
+        used += pad + size;
+
+        slots.push_back({.mesh = {.level = level,
+                                  .x = x,
+                                  .y = y,
+                                  .z = z,
+                                  .offset = offset,
+                                  .size = size,
+                                  .instance_count = instance_count,
+                                  .culling = culling},
+                         .ring_bytes = pad + size,
+                         .ready = false});
+        seq = front_seq + slots.size() - 1;
+    }
+
+    // Copy without the lock, so workers can fill the ring in parallel
+    if (size > 0) std::memcpy(ring.data() + offset, vertex_data.data(), size);
+
+    std::scoped_lock<std::mutex> lock(mutex);
+    slots[seq - front_seq].ready = true;
+
+    return true;
+}
+
+StagedBatch MeshUploadQueue::take_ready(size_t byte_budget) {
+    std::scoped_lock<std::mutex> lock(mutex);
+
+    StagedBatch batch;
+    size_t batch_size = 0;
+
+    while (!slots.empty() && slots.front().ready) {
+        const Slot& slot = slots.front();
+        if (!batch.meshes.empty() && batch_size + slot.mesh.size > byte_budget) break;
+
+        batch.meshes.push_back(slot.mesh);
+        batch.ring_bytes += slot.ring_bytes;
+        batch_size += slot.mesh.size;
+
+        slots.pop_front();
+        front_seq++;
+    }
+
+    return batch;
+}
+
+void MeshUploadQueue::release(size_t ring_bytes) {
+    if (ring_bytes == 0) return;
+
+    {
+        std::scoped_lock<std::mutex> lock(mutex);
+
+        assert(ring_bytes <= used);
+        used -= ring_bytes;
+
+        // Nothing is reserved, so start from the beginning again rather than skipping the end later
+        if (used == 0) head = 0;
+    }
+
+    space_cv.notify_all();
+}
+
+void MeshUploadQueue::close() {
+    {
+        std::scoped_lock<std::mutex> lock(mutex);
+        closed = true;
+    }
+
+    space_cv.notify_all();
+}
+
+uint64_t MeshUploadQueue::stalls() {
+    std::scoped_lock<std::mutex> lock(mutex);
+    return _stalls;
+}
+
+size_t MeshUploadQueue::ring_used() {
+    std::scoped_lock<std::mutex> lock(mutex);
+    return used;
+}
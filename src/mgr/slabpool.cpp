@@ -0,0 +1,48 @@
+#include <mgr/slabpool.h>
+#include <cstdint>
+
+#ifdef _WIN32
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+using namespace mgr;
+
+#ifdef _WIN32
+
+void* mgr::allocate_slab(bool) {
+    void* slab = _aligned_malloc(SLAB_BYTES, SLAB_BYTES);
+    if (slab == nullptr) throw std::bad_alloc();
+
+    return slab;
+}
+
+void mgr::free_slab(void* slab) { _aligned_free(slab); }
+
+#else
+
+void* mgr::allocate_slab(bool huge_pages) {
+    // Map twice the size and trim it to an aligned slab, as mmap only aligns to pages
+    void* mapping = mmap(nullptr, 2 * SLAB_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) throw std::bad_alloc();
+
+    const uintptr_t start = reinterpret_cast<uintptr_t>(mapping);
+    const uintptr_t aligned = (start + SLAB_BYTES - 1) & ~(uintptr_t)(SLAB_BYTES - 1);
+
+    if (aligned > start) munmap(mapping, aligned - start);
+    munmap(reinterpret_cast<void*>(aligned + SLAB_BYTES), start + SLAB_BYTES - aligned);
+
+    void* slab = reinterpret_cast<void*>(aligned);
+
+#ifdef MADV_HUGEPAGE
+    // Only advice, so failure (e.g. huge pages being disabled) is ignored
+    if (huge_pages) madvise(slab, SLAB_BYTES, MADV_HUGEPAGE);
+#endif
+
+    return slab;
+}
+
+void mgr::free_slab(void* slab) { munmap(slab, SLAB_BYTES); }
+
+#endif
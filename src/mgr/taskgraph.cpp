@@ -0,0 +1,107 @@
+#include <mgr/taskgraph.h>
+#include <tracy/Tracy.hpp>
+#include <exception>
+#include <iostream>
+#include <utility>
+
+using namespace mgr;
+
+TaskGraph::Task* TaskGraph::insert(const TaskKey& key, float priority, std::span<const TaskKey> dependencies) {
+    auto [it, inserted] = tasks.try_emplace(key);
+
+    if (!inserted) {
+        stats.deduplicated++;
+        return nullptr;
+    }
+
+    stats.added++;
+
+    Task& task = it->second;
+    task.key = key;
+    task.priority = priority;
+
+    for (const TaskKey& dependency : dependencies) {
+        auto dependency_it = tasks.find(dependency);
+        if (dependency_it == tasks.end()) continue;
+
+        dependency_it->second.dependents.push_back(&task);
+        task.waiting_on++;
+    }
+
+    if (task.waiting_on == 0) ready.push({.priority = priority, .order = next_order++, .task = &task});
+
+    return &task;
+}
+
+void TaskGraph::start(ThreadPool& pool) {
+    std::scoped_lock<std::mutex> lock(mutex);
+
+    this->pool = &pool;
+    dispatch();
+}
+
+void TaskGraph::dispatch() {
+    while (running < max_running && !ready.empty()) {
+        Task* task = ready.top().task;
+
+        // Ahead of other jobs, as the graph only gives the pool as many tasks as it can run.
+        // Capturing only two pointers keeps the job small enough not to allocate.
+        if (!pool->enqueue_next([this, task] { run_task(task); })) break;
+
+        ready.pop();
+        running++;
+    }
+
+    TracyPlot("task_graph_tasks", (int64_t)tasks.size());
+}
+
+void TaskGraph::run_task(Task* task) {
+    std::function<void()> run;
+
+    {
+        std::scoped_lock<std::mutex> lock(mutex);
+        run = std::move(task->run);
+    }
+
+    // A task which throws is reported and still finishes, so it can be added again and doesn't hold up its dependents
+    // or the graph. Rethrowing would end the program, as pool jobs mustn't throw.
+    try {
+        run();
+    } catch (const std::exception& e) {
+        std::cerr << "task of stage " << task->key.stage << " failed: " << e.what() << std::endl;
+    } catch (...) {
+        std::cerr << "task of stage " << task->key.stage << " failed" << std::endl;
+    }
+
+    finish_task(task);
+}
+
+void TaskGraph::finish_task(Task* task) {
+    std::scoped_lock<std::mutex> lock(mutex);
+
+    for (Task* dependent : task->dependents) {
+        if (--dependent->waiting_on == 0) {
+            ready.push({.priority = dependent->priority, .order = next_order++, .task = dependent});
+        }
+    }
+
+    tasks.erase(task->key);
+    running--;
+
+    dispatch();
+}
+
+bool TaskGraph::contains(const TaskKey& key) {
+    std::scoped_lock<std::mutex> lock(mutex);
+    return tasks.contains(key);
+}
+
+size_t TaskGraph::size() {
+    std::scoped_lock<std::mutex> lock(mutex);
+    return tasks.size();
+}
+
+TaskGraphStats TaskGraph::take_stats() {
+    std::scoped_lock<std::mutex> lock(mutex);
+    return std::exchange(stats, {});
+}
@@ -0,0 +1,91 @@
+#include <mgr/terrainstore.h>
+#include <mgr/lodstore.h>
+#include <models/chunk.h>
+#include <config.h>
+#include <chrono>
+#include <tracy/Tracy.hpp>
+
+using namespace mgr;
+
+static_assert(models::RenderingChunk::X_SIZE == models::RenderingChunk::Z_SIZE, "far terrain tiles must be square");
+static_assert(models::RenderingChunk::X_SIZE % config::FAR_TERRAIN_TILE_RESOLUTION == 0,
+              "far terrain samples must land on block corners");
+
+void TerrainStore::load_tile(unsigned int level, int tile_x, int tile_z) {
+    ZoneScopedN("TerrainStore::load_tile");
+
+    [[maybe_unused]] const auto start = std::chrono::steady_clock::now();
+
+    constexpr unsigned int SAMPLES = config::FAR_TERRAIN_TILE_RESOLUTION + 1;
+
+    // Tiles cover whole chunks, so samples always land on block corners
+    const int tile_blocks = models::RenderingChunk::X_SIZE << level;
+    const unsigned int step = tile_blocks / config::FAR_TERRAIN_TILE_RESOLUTION;
+
+    std::vector<float> heights(SAMPLES * SAMPLES);
+    generator.generate_heightmap(heights.data(), tile_x * tile_blocks, tile_z * tile_blocks, SAMPLES, step);
+
+    [[maybe_unused]] const double tile_ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    TracyPlot("far_terrain_tile_ms", tile_ms);
+
+    std::scoped_lock<std::mutex> lock(mutex);
+
+    // Unloaded while it was being generated
+    auto it = tiles.find({level, tile_x, tile_z});
+    if (it == tiles.end()) return;
+
+    it->second.heights = std::move(heights);
+    it->second.loaded = true;
+    _tile_version.fetch_add(1, std::memory_order::relaxed);
+}
+
+void TerrainStore::load_rings_on_pool(ThreadPool& pool, int camera_chunk_x, int camera_chunk_z) {
+    ZoneScopedN("TerrainStore::load_rings_on_pool");
+
+    std::scoped_lock<std::mutex> lock(mutex);
+
+    // Keep tiles just outside the rings, so moving back and forth doesn't regenerate them
+    std::erase_if(tiles, [camera_chunk_x, camera_chunk_z](const auto& item) {
+        const auto& [level, tile_x, tile_z] = item.first;
+        return !lod_node_in_ring(level, tile_x, tile_z, camera_chunk_x, camera_chunk_z, 2);
+    });
+
+    std::vector<std::function<void()>> jobs_todo;
+
+    for (unsigned int level = config::LOD_LEVELS + 1; level <= config::LOD_LEVELS + config::FAR_TERRAIN_LEVELS;
+         level++) {
+        const int camera_tile_x = camera_chunk_x >> level;
+        const int camera_tile_z = camera_chunk_z >> level;
+
+        const int extent = lod_ring_extent(level);
+
+        for (int tile_x = camera_tile_x - extent; tile_x <= camera_tile_x + extent; tile_x++) {
+            for (int tile_z = camera_tile_z - extent; tile_z <= camera_tile_z + extent; tile_z++) {
+                if (!lod_node_in_ring(level, tile_x, tile_z, camera_chunk_x, camera_chunk_z, 1)) continue;
+
+                auto [it, inserted] = tiles.try_emplace({level, tile_x, tile_z});
+
+                if (inserted) {
+                    jobs_todo.push_back([this, level, tile_x, tile_z] { load_tile(level, tile_x, tile_z); });
+                }
+            }
+        }
+    }
+
+    TracyPlot("far_terrain_tiles", (int64_t)tiles.size());
+
+    pool.enqueue(jobs_todo);
+}
+
+void TerrainStore::for_each_loaded(
+    const std::function<void(unsigned int level, int tile_x, int tile_z, const TerrainTile&)>& f) {
+    std::scoped_lock<std::mutex> lock(mutex);
+
+    for (const auto& [coord, tile] : tiles) {
+        if (!tile.loaded) continue;
+
+        const auto& [level, tile_x, tile_z] = coord;
+        f(level, tile_x, tile_z, tile);
+    }
+}
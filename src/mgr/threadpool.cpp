@@ -1,4 +1,5 @@
 #include <mgr/threadpool.h>
+#include <utility>
 
 using namespace mgr;
 
@@ -15,15 +16,15 @@ void ThreadPool::thread_main() {
             std::unique_lock<std::mutex> lock(jobs_mutex);
             jobs_cv.wait(lock, [this] { return !jobs.empty(); });
 
-            job = jobs.front();
-
             // Check if the job is the stopper
-            void (*const* target_ptr)(void) = job.target<void (*)(void)>();
+            void (*const* target_ptr)(void) = jobs.front().target<void (*)(void)>();
             if (target_ptr && *target_ptr == STOPPER) {
                 return;
             }
 
-            jobs.pop();
+            job = std::move(jobs.front());
+
+            jobs.pop_front();
         }
 
         job();
@@ -47,8 +48,18 @@ void ThreadPool::enqueue(const std::function<void()>& job) {
         throw std::runtime_error("attempt to enqueue job on stopped thread pool");
     }
 
-    jobs.push(job);
+    jobs.push_back(job);
+    jobs_cv.notify_one();
+}
+
+bool ThreadPool::try_enqueue(const std::function<void()>& job) {
+    std::scoped_lock<std::mutex> lock(jobs_mutex);
+
+    if (threads.size() == 0) return false;
+
+    jobs.push_back(job);
     jobs_cv.notify_one();
+    return true;
 }
 
 void ThreadPool::enqueue(std::span<const std::function<void()>> jobs_todo) {
@@ -59,13 +70,29 @@ void ThreadPool::enqueue(std::span<const std::function<void()>> jobs_todo) {
     }
 
     for (const auto& job : jobs_todo) {
-        jobs.push(job);
+        jobs.push_back(job);
         jobs_cv.notify_one();
     }
 }
 
+bool ThreadPool::enqueue_next(const std::function<void()>& job) {
+    std::scoped_lock<std::mutex> lock(jobs_mutex);
+
+    if (threads.size() == 0) return false;
+
+    jobs.push_front(job);
+    jobs_cv.notify_one();
+    return true;
+}
+
+size_t ThreadPool::queued() {
+    std::scoped_lock<std::mutex> lock(jobs_mutex);
+    return jobs.size();
+}
+
 void ThreadPool::stop() {
     std::vector<std::thread> moved_threads;
+    std::deque<std::function<void()>> cleared_jobs;
 
     {
         std::scoped_lock<std::mutex> lock(jobs_mutex);
@@ -75,8 +102,8 @@ void ThreadPool::stop() {
         }
 
         // Add a special job to the queue to tell the threads to stop
-        jobs = {};
-        jobs.push(STOPPER);
+        cleared_jobs = std::exchange(jobs, {});
+        jobs.push_back(STOPPER);
 
         moved_threads = std::move(threads);
         threads.clear();
@@ -91,4 +118,9 @@ void ThreadPool::stop() {
     }
 
     jobs = {};
+
+    // Once no thread can be resuming them, and without the lock, as their destructors may use the pool
+    for (const auto& job : cleared_jobs) {
+        if (const ResumeJob* resume = job.target<ResumeJob>()) resume->handle.destroy();
+    }
 }
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include <models/blockregistry.h>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <limits>
+
+using namespace models;
+
+// Indices of the faces in face_textures
+static constexpr unsigned int BOTTOM_FACE = 4;
+static constexpr unsigned int TOP_FACE = 5;
+
+BlockId BlockRegistry::add(std::string_view name, bool opaque, bool collides, uint8_t light_emission,
+                           const std::array<std::string, 6>& textures) {
+    if (names.size() > std::numeric_limits<BlockId>::max()) throw std::runtime_error("too many block types");
+
+    const BlockId id = names.size();
+
+    names.emplace_back(name);
+    ids_by_name.try_emplace(std::string(name), id);
+    light_emissions.push_back(light_emission);
+
+    if ((id & 63) == 0) {
+        opaque_bits.push_back(0);
+        collides_bits.push_back(0);
+    }
+
+    opaque_bits[id >> 6] |= (uint64_t)opaque << (id & 63);
+    collides_bits[id >> 6] |= (uint64_t)collides << (id & 63);
+
+    // Textures are given layers in the order they are first used
+    std::array<uint16_t, 6> layers{};
+
+    for (unsigned int face = 0; face < 6; face++) {
+        if (textures[face].empty()) continue;
+
+        auto [it, inserted] = layers_by_texture.try_emplace(textures[face], _texture_names.size());
+        if (inserted) _texture_names.push_back(textures[face]);
+
+        layers[face] = it->second;
+    }
+
+    face_textures.push_back(layers);
+
+    return id;
+}
+
+BlockRegistry BlockRegistry::builtin() {
+    BlockRegistry registry;
+
+    registry.add("empty", false, false, 0, {});
+    registry.add("stone", true, true, 0, {"stone", "stone", "stone", "stone", "stone", "stone"});
+    registry.add("dirt", true, true, 0, {"dirt", "dirt", "dirt", "dirt", "dirt", "dirt"});
+
+    return registry;
+}
+
+BlockRegistry BlockRegistry::load(const std::string& path) {
+    std::ifstream file{path};
+
+    if (!file.good()) {
+        throw std::runtime_error(std::string("error opening file: ") + path);
+    }
+
+    BlockRegistry registry;
+    registry.add("empty", false, false, 0, {});
+
+    std::string line;
+    unsigned int line_number = 0;
+
+    while (std::getline(file, line)) {
+        line_number++;
+
+        std::istringstream fields{line};
+        std::string name;
+        if (!(fields >> name) || name.starts_with('#')) continue;
+
+        const auto error = [&path, line_number](const std::string& message) {
+            return std::runtime_error(path + ":" + std::to_string(line_number) + ": " + message);
+        };
+
+        unsigned int opaque, light_emission, collides;
+        if (!(fields >> opaque >> light_emission >> collides) || opaque > 1 || light_emission > 15 || collides > 1) {
+            throw error("expected opaque (0 or 1), light emission (0 to 15) and collides (0 or 1)");
+        }
+
+        std::vector<std::string> textures;
+        for (std::string texture; fields >> texture;) textures.push_back(texture);
+
+        std::array<std::string, 6> face_textures;
+
+        if (textures.size() == 1) {
+            face_textures.fill(textures[0]);
+        } else if (textures.size() == 3) {
+            face_textures.fill(textures[2]);
+            face_textures[TOP_FACE] = textures[0];
+            face_textures[BOTTOM_FACE] = textures[1];
+        } else {
+            throw error("expected one texture, or top, bottom and side textures");
+        }
+
+        if (registry.find(name) != EMPTY_BLOCK || name == "empty") throw error("duplicate block " + name);
+
+        registry.add(name, opaque, collides, light_emission, face_textures);
+    }
+
+    // The world generator places these by id
+    if (registry.find("stone") != STONE_BLOCK || registry.find("dirt") != DIRT_BLOCK) {
+        throw std::runtime_error(path + ": the first blocks must be stone then dirt");
+    }
+
+    return registry;
+}
+
+BlockId BlockRegistry::find(std::string_view name) const {
+    auto it = ids_by_name.find(name);
+    return it == ids_by_name.end() ? EMPTY_BLOCK : it->second;
+}
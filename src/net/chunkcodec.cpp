@@ -0,0 +1,380 @@
+#include <net/chunkcodec.h>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <limits>
+#include <stdexcept>
+
+using namespace net;
+
+// Writes to a buffer known to be large enough
+class Writer {
+    std::span<uint8_t> out;
+    size_t pos = 0;
+
+public:
+    explicit Writer(std::span<uint8_t> out) : out(out) {}
+
+    void byte(uint8_t value) { out[pos++] = value; }
+
+    void varint(uint32_t value) {
+        while (value >= 0x80) {
+            out[pos++] = (value & 0x7F) | 0x80;
+            value >>= 7;
+        }
+
+        out[pos++] = value;
+    }
+
+    void signed_varint(int value) { varint(((uint32_t)value << 1) ^ (uint32_t)(value >> 31)); }
+
+    size_t size() const { return pos; }
+};
+
+// Reads from a buffer which may be invalid or cut short
+class Reader {
+    std::span<const uint8_t> in;
+
+public:
+    size_t pos;
+
+    Reader(std::span<const uint8_t> in, size_t pos = 0) : in(in), pos(pos) {}
+
+    [[noreturn]] static void fail() { throw std::runtime_error("invalid or truncated network record"); }
+
+    uint8_t byte() {
+        if (pos >= in.size()) fail();
+        return in[pos++];
+    }
+
+    uint32_t varint() {
+        uint32_t value = 0;
+
+        for (unsigned int shift = 0; shift < 35; shift += 7) {
+            const uint8_t b = byte();
+            value |= (uint32_t)(b & 0x7F) << shift;
+            if ((b & 0x80) == 0) return value;
+        }
+
+        fail();
+    }
+
+    int signed_varint() {
+        const uint32_t value = varint();
+        return (int)(value >> 1) ^ -(int)(value & 1);
+    }
+
+    // Reads count values of bits bits each, least significant bit first
+    template <typename F>
+    void packed(size_t count, unsigned int bits, F&& use_value) {
+        if (bits == 0) {
+            for (size_t i = 0; i < count; i++) use_value(i, 0);
+            return;
+        }
+
+        if (in.size() - pos < (count * bits + 7) / 8) fail();
+
+        const uint32_t mask = (1u << bits) - 1;
+        uint64_t buffer = 0;
+        unsigned int buffered = 0;
+
+        for (size_t i = 0; i < count; i++) {
+            while (buffered < bits) {
+                buffer |= (uint64_t)in[pos++] << buffered;
+                buffered += 8;
+            }
+
+            use_value(i, buffer & mask);
+            buffer >>= bits;
+            buffered -= bits;
+        }
+    }
+};
+
+// The bits needed for an index into a palette of the given size
+static unsigned int index_bits(size_t palette_size) { return std::bit_width(palette_size - 1); }
+
+// The index after the end of the run of blocks starting at start
+template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
+static unsigned int run_end(const models::Chunk<X_SIZE, Y_SIZE, Z_SIZE>& chunk, unsigned int start) {
+    constexpr unsigned int BLOCKS = X_SIZE * Y_SIZE * Z_SIZE;
+    constexpr unsigned int GROUP = 16;
+
+    const models::BlockId id = chunk.block_at(start).id();
+    unsigned int i = start + 1;
+
+    // Most of a chunk is long runs of air or stone, so blocks are compared a group at a time, which vectorises
+    while (i + GROUP <= BLOCKS) {
+        unsigned int differences = 0;
+        for (unsigned int j = 0; j < GROUP; j++) differences |= chunk.block_at(i + j).id() ^ id;
+
+        if (differences != 0) break;
+        i += GROUP;
+    }
+
+    while (i < BLOCKS && chunk.block_at(i).id() == id) i++;
+
+    return i;
+}
+
+template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
+size_t net::encode_chunk(const models::Chunk<X_SIZE, Y_SIZE, Z_SIZE>& chunk, int chunk_x, int chunk_y, int chunk_z,
+                         std::span<uint8_t> out) {
+    constexpr unsigned int BLOCKS = X_SIZE * Y_SIZE * Z_SIZE;
+
+    assert((out.size() >= max_encoded_chunk_size<X_SIZE, Y_SIZE, Z_SIZE>()));
+
+    // Chunks hold few distinct blocks, so the palette is searched from the block of the last run
+    constexpr size_t MAX_PALETTE_SIZE = max_palette_size<X_SIZE, Y_SIZE, Z_SIZE>();
+
+    std::array<models::BlockId, MAX_PALETTE_SIZE> palette;
+    size_t palette_size = 0;
+    unsigned int run_count = 0;
+
+    auto palette_index = [&palette, &palette_size](models::BlockId id) -> size_t {
+        return std::find(palette.begin(), palette.begin() + palette_size, id) - palette.begin();
+    };
+
+    // Runs are found again for each pass rather than stored, so nothing needs allocating
+    auto for_each_run = [&chunk](auto&& f) {
+        for (unsigned int start = 0; start < BLOCKS;) {
+            const unsigned int end = run_end(chunk, start);
+            f(chunk.block_at(start).id(), end - start);
+            start = end;
+        }
+    };
+
+    for_each_run([&](models::BlockId id, unsigned int) {
+        run_count++;
+
+        // The palette fits every distinct block a chunk can hold
+        if (palette_index(id) == palette_size) palette[palette_size++] = id;
+    });
+
+    Writer writer{out};
+
+    writer.byte((uint8_t)RecordType::CHUNK);
+    writer.signed_varint(chunk_x);
+    writer.signed_varint(chunk_y);
+    writer.signed_varint(chunk_z);
+
+    writer.varint(palette_size);
+    for (size_t i = 0; i < palette_size; i++) writer.varint(palette[i]);
+
+    writer.varint(run_count);
+
+    // Runs are visited in order, so their indices are buffered a few at a time for packing
+    {
+        const unsigned int bits = index_bits(palette_size);
+        uint64_t buffer = 0;
+        unsigned int buffered = 0;
+
+        for_each_run([&](models::BlockId id, unsigned int) {
+            if (bits == 0) return;
+
+            buffer |= (uint64_t)palette_index(id) << buffered;
+            buffered += bits;
+
+            while (buffered >= 8) {
+                writer.byte(buffer);
+                buffer >>= 8;
+                buffered -= 8;
+            }
+        });
+
+        if (buffered > 0) writer.byte(buffer);
+    }
+
+    for_each_run([&writer](models::BlockId, unsigned int length) { writer.varint(length - 1); });
+
+    return writer.size();
+}
+
+template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
+size_t net::decode_chunk(std::span<const uint8_t> in, models::Chunk<X_SIZE, Y_SIZE, Z_SIZE>& chunk, int& chunk_x,
+                         int& chunk_y, int& chunk_z) {
+    constexpr unsigned int BLOCKS = X_SIZE * Y_SIZE * Z_SIZE;
+    constexpr size_t MAX_PALETTE_SIZE = max_palette_size<X_SIZE, Y_SIZE, Z_SIZE>();
+
+    Reader reader{in};
+
+    if (reader.byte() != (uint8_t)RecordType::CHUNK) Reader::fail();
+
+    chunk_x = reader.signed_varint();
+    chunk_y = reader.signed_varint();
+    chunk_z = reader.signed_varint();
+
+    const uint32_t palette_size = reader.varint();
+    if (palette_size == 0 || palette_size > MAX_PALETTE_SIZE) Reader::fail();
+
+    std::array<models::BlockId, MAX_PALETTE_SIZE> palette;
+    for (uint32_t i = 0; i < palette_size; i++) {
+        const uint32_t id = reader.varint();
+        if (id > std::numeric_limits<models::BlockId>::max()) Reader::fail();
+        palette[i] = id;
+    }
+
+    const uint32_t run_count = reader.varint();
+    if (run_count == 0 || run_count > BLOCKS) Reader::fail();
+
+    // The blocks of each run are filled once its length is known, so the indices are read into the first block of
+    // each run meanwhile. Runs are at most one per block, so run i's index fits in block i.
+    reader.packed(run_count, index_bits(palette_size), [&](size_t i, uint32_t index) {
+        if (index >= palette_size) Reader::fail();
+        chunk.block_at(i) = models::Block(index);
+    });
+
+    // Lengths are checked before any block is filled
+    const size_t lengths_start = reader.pos;
+    unsigned int total = 0;
+
+    for (uint32_t i = 0; i < run_count; i++) {
+        const uint32_t length_minus_one = reader.varint();
+        if (length_minus_one >= BLOCKS - total) Reader::fail();
+        total += length_minus_one + 1;
+    }
+
+    if (total != BLOCKS) Reader::fail();
+
+    const size_t end = reader.pos;
+
+    // Filling forwards would overwrite the indices of later runs, so runs are filled from the last, walking the
+    // lengths backwards
+    unsigned int next_start = BLOCKS;
+    size_t length_end = end;
+
+    for (uint32_t run = run_count; run-- > 0;) {
+        // Step back over the varint of this run's length
+        size_t length_start = length_end - 1;
+        while (length_start > lengths_start && (in[length_start - 1] & 0x80)) length_start--;
+
+        Reader length_reader{in, length_start};
+        const unsigned int length = length_reader.varint() + 1;
+        const unsigned int run_start = next_start - length;
+
+        const models::Block block{palette[chunk.block_at(run).id()]};
+        std::fill(&chunk.block_at(run_start), &chunk.block_at(run_start) + length, block);
+
+        next_start = run_start;
+        length_end = length_start;
+    }
+
+    return end;
+}
+
+size_t net::encode_block_edits(int chunk_x, int chunk_y, int chunk_z, std::span<BlockEdit> edits,
+                               std::span<uint8_t> out) {
+    assert(out.size() >= max_encoded_block_edits_size(edits.size()));
+
+    // A stable sort keeps edits to the same block in order, so the last is kept
+    std::stable_sort(edits.begin(), edits.end(),
+                     [](const BlockEdit& a, const BlockEdit& b) { return a.index < b.index; });
+
+    size_t count = 0;
+    for (size_t i = 0; i < edits.size(); i++) {
+        if (i + 1 < edits.size() && edits[i + 1].index == edits[i].index) continue;
+        edits[count++] = edits[i];
+    }
+
+    Writer writer{out};
+
+    writer.byte((uint8_t)RecordType::BLOCK_EDITS);
+    writer.signed_varint(chunk_x);
+    writer.signed_varint(chunk_y);
+    writer.signed_varint(chunk_z);
+    writer.varint(count);
+
+    uint32_t last_index = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        writer.varint(edits[i].index - last_index);
+        writer.varint(edits[i].block);
+        last_index = edits[i].index;
+    }
+
+    return writer.size();
+}
+
+BlockEditReader::BlockEditReader(std::span<const uint8_t> in, uint32_t blocks) : data(in), blocks(blocks) {
+    Reader reader{in};
+
+    if (reader.byte() != (uint8_t)RecordType::BLOCK_EDITS) Reader::fail();
+
+    chunk_x = reader.signed_varint();
+    chunk_y = reader.signed_varint();
+    chunk_z = reader.signed_varint();
+    remaining = reader.varint();
+
+    pos = reader.pos;
+}
+
+bool BlockEditReader::next(BlockEdit& edit) {
+    if (remaining == 0) return false;
+
+    Reader reader{data, pos};
+
+    // Edits are sorted, so the index only grows and must stay inside the chunk
+    const uint32_t delta = reader.varint();
+    if (delta >= blocks - index) Reader::fail();
+    index += delta;
+
+    const uint32_t block = reader.varint();
+    if (block > std::numeric_limits<models::BlockId>::max()) Reader::fail();
+
+    edit = {.index = index, .block = (models::BlockId)block};
+
+    pos = reader.pos;
+    remaining--;
+
+    return true;
+}
+
+// Division rounding towards negative infinity, b must be positive
+static inline int floor_div(int a, int b) {
+    int q = a / b;
+    return (a % b != 0 && a < 0) ? q - 1 : q;
+}
+
+template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
+void BlockEditBatcher<X_SIZE, Y_SIZE, Z_SIZE>::add(int x, int y, int z, models::BlockId block) {
+    const int chunk_x = floor_div(x, X_SIZE);
+    const int chunk_y = floor_div(y, Y_SIZE);
+    const int chunk_z = floor_div(z, Z_SIZE);
+
+    const uint32_t index =
+        (x - chunk_x * X_SIZE) + (y - chunk_y * Y_SIZE) * X_SIZE + (z - chunk_z * Z_SIZE) * X_SIZE * Y_SIZE;
+
+    chunks[{chunk_x, chunk_y, chunk_z}].push_back({.index = index, .block = block});
+    edit_count++;
+}
+
+template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
+void BlockEditBatcher<X_SIZE, Y_SIZE, Z_SIZE>::flush(std::vector<uint8_t>& out) {
+    for (auto& [coord, edits] : chunks) {
+        const auto [chunk_x, chunk_y, chunk_z] = coord;
+
+        const size_t start = out.size();
+        out.resize(start + max_encoded_block_edits_size(edits.size()));
+
+        const size_t size = encode_block_edits(chunk_x, chunk_y, chunk_z, edits, std::span(out).subspan(start));
+        out.resize(start + size);
+    }
+
+    chunks.clear();
+    edit_count = 0;
+}
+
+template size_t net::encode_chunk(
+    const models::Chunk<models::RenderingChunk::X_SIZE, models::RenderingChunk::Y_SIZE, models::RenderingChunk::Z_SIZE>
+        &chunk,
+    int chunk_x, int chunk_y, int chunk_z, std::span<uint8_t> out);
+
+template size_t net::decode_chunk(
+    std::span<const uint8_t> in,
+    models::Chunk<models::RenderingChunk::X_SIZE, models::RenderingChunk::Y_SIZE, models::RenderingChunk::Z_SIZE>
+        &chunk,
+    int &chunk_x, int &chunk_y, int &chunk_z);
+
+template class net::BlockEditBatcher<models::RenderingChunk::X_SIZE, models::RenderingChunk::Y_SIZE,
+                                     models::RenderingChunk::Z_SIZE>;
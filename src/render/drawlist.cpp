@@ -0,0 +1,177 @@
+#include <render/drawlist.h>
+#include <config.h>
+#include <tracy/Tracy.hpp>
+#include <utility>
+#include <chrono>
+#include <algorithm>
+#include <span>
+
+using namespace render;
+
+Aabb render::mesh_bounds(const MeshKey &key) {
+    const auto [level, x, y, z] = key;
+
+    // Voxels span from their index to the next, scaled up for level of detail nodes
+    const float voxel_size = (float)config::BLOCK_SIZE * (1u << level);
+    const float size_x = voxel_size * models::RenderingChunk::X_SIZE;
+    const float size_y = voxel_size * models::RenderingChunk::Y_SIZE;
+    const float size_z = voxel_size * models::RenderingChunk::Z_SIZE;
+
+    return {.min = {x * size_x, y * size_y, z * size_z}, .max = {(x + 1) * size_x, (y + 1) * size_y, (z + 1) * size_z}};
+}
+
+// Merges the solid slabs at the bottom of the chunks near the camera into boxes. Each box is a run of chunks in a
+// column which are entirely solid, topped by a chunk which may only be solid part of the way up.
+static std::vector<Aabb> build_occluders(std::span<const MeshDraw> meshes, const CullingOrigin &origin) {
+    ZoneScopedN("build_occluders");
+
+    struct Slab {
+        int x;
+        int z;
+        int y;
+        uint16_t height;
+    };
+
+    std::vector<Slab> slabs;
+
+    for (const MeshDraw &mesh : meshes) {
+        const auto [level, x, y, z] = mesh.key;
+
+        if (level != 0 || mesh.culling.solid_height == 0) continue;
+        if (std::max(std::abs(x - origin.chunk_x), std::abs(z - origin.chunk_z)) > config::OCCLUDER_DISTANCE) continue;
+
+        slabs.push_back({.x = x, .z = z, .y = y, .height = mesh.culling.solid_height});
+    }
+
+    std::sort(slabs.begin(), slabs.end(),
+              [](const Slab &a, const Slab &b) { return std::tie(a.x, a.z, a.y) < std::tie(b.x, b.z, b.y); });
+
+    std::vector<Aabb> occluders;
+
+    for (size_t start = 0; start < slabs.size();) {
+        size_t end = start;
+
+        // Carry on up while the chunk is full and the next one up has a slab too
+        while (end + 1 < slabs.size() && slabs[end].height == models::RenderingChunk::Y_SIZE &&
+               slabs[end + 1].x == slabs[end].x && slabs[end + 1].z == slabs[end].z &&
+               slabs[end + 1].y == slabs[end].y + 1) {
+            end++;
+        }
+
+        const int solid_layers =
+            (slabs[end].y - slabs[start].y) * models::RenderingChunk::Y_SIZE + slabs[end].height;
+
+        Aabb box = mesh_bounds({0, slabs[start].x, slabs[start].y, slabs[start].z});
+        box.max[1] = box.min[1] + (float)config::BLOCK_SIZE * solid_layers;
+        occluders.push_back(box);
+
+        start = end + 1;
+    }
+
+    return occluders;
+}
+
+void DrawListBuilder::builder_main() {
+    while (true) {
+        Request req;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            request_cv.wait(lock, [this] { return should_stop || pending.has_value(); });
+
+            if (should_stop) return;
+
+            req = std::move(*pending);
+            pending.reset();
+        }
+
+        ZoneScopedN("build_draw_list");
+
+        DrawList list{.mesh_generation = req.mesh_generation};
+
+        const CullingOrigin &origin = req.culling_origin;
+        std::optional<ChunkVisibility> visibility;
+
+        if (config::VISIBILITY_CULLING) {
+            [[maybe_unused]] const auto cull_start = std::chrono::steady_clock::now();
+
+            visibility.emplace(origin.chunk_x, origin.chunk_y, origin.chunk_z, origin.radius);
+
+            // Chunks which are not meshed yet are left with all faces connected
+            for (const MeshDraw &mesh : req.meshes) {
+                const auto [level, x, y, z] = mesh.key;
+                if (level == 0) visibility->set_connectivity(x, y, z, mesh.culling.face_connectivity);
+            }
+
+            visibility->update();
+
+            [[maybe_unused]] const float cull_us =
+                std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - cull_start).count();
+            TracyPlot("visibility_cull_us", cull_us);
+        }
+
+        [[maybe_unused]] unsigned int chunks_drawn = 0;
+        [[maybe_unused]] unsigned int chunks_culled = 0;
+
+        for (const MeshDraw &mesh : req.meshes) {
+            if (mesh.command.instance_count == 0 || !req.visible(mesh.key, mesh.command.instance_count)) continue;
+
+            const auto [level, x, y, z] = mesh.key;
+
+            if (level == 0 && visibility.has_value()) {
+                if (!visibility->is_visible(x, y, z)) {
+                    chunks_culled++;
+                    continue;
+                }
+
+                chunks_drawn++;
+            }
+
+            list.keys.push_back(mesh.key);
+            list.commands.push_back(mesh.command);
+        }
+
+        if (visibility.has_value()) {
+            [[maybe_unused]] const float culled_percent =
+                chunks_drawn + chunks_culled > 0 ? 100.0f * chunks_culled / (chunks_drawn + chunks_culled) : 0.0f;
+            TracyPlot("chunks_culled_percent", culled_percent);
+        }
+
+        if (config::OCCLUSION_CULLING) list.occluders = build_occluders(req.meshes, origin);
+
+        std::scoped_lock<std::mutex> lock(mutex);
+        built = std::move(list);
+    }
+}
+
+DrawListBuilder::DrawListBuilder() { builder_thread = std::thread(&DrawListBuilder::builder_main, this); }
+
+DrawListBuilder::~DrawListBuilder() {
+    {
+        std::scoped_lock<std::mutex> lock(mutex);
+        should_stop = true;
+    }
+
+    request_cv.notify_one();
+
+    if (builder_thread.joinable()) builder_thread.join();
+}
+
+void DrawListBuilder::request(std::vector<MeshDraw> meshes, uint64_t mesh_generation,
+                              CullingOrigin culling_origin,
+                              std::function<bool(const MeshKey &, unsigned int instance_count)> visible) {
+    {
+        std::scoped_lock<std::mutex> lock(mutex);
+        pending = Request{.meshes = std::move(meshes),
+                          .mesh_generation = mesh_generation,
+                          .culling_origin = culling_origin,
+                          .visible = std::move(visible)};
+    }
+
+    request_cv.notify_one();
+}
+
+std::optional<DrawList> DrawListBuilder::take() {
+    std::scoped_lock<std::mutex> lock(mutex);
+    return std::exchange(built, std::nullopt);
+}
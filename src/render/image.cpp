@@ -1,50 +1,55 @@
 #include <render/image.h>
 #include <spng.h>
 #include <assert.h>
-#include <fstream>
-#include <iterator>
-#include <endianness.h>
+#include <stdexcept>
 
 using namespace render;
 
-std::vector<char> render::load_png_rgb8(const std::string& path, unsigned int& width, unsigned int& height) {
-    std::ifstream file{path, std::ios::in | std::ios::binary};
+PngImage::PngImage(const std::string &path) : file(path), path(path) {
+    ctx = spng_ctx_new(0);
+    assert(ctx != NULL);
 
-    if (!file.good()) {
-        throw std::runtime_error(std::string("error opening file: ") + path);
+    int ret = spng_set_png_buffer(ctx, file.data().data(), file.data().size());
+    if (ret != 0) {
+        spng_ctx_free(ctx);
+        throw std::runtime_error(std::string("error in spng_set_png_buffer: ") + spng_strerror(ret) + ", " + path);
     }
 
-    std::vector<char> png_data{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
-
-    if (png_data.size() < 21) {
-        throw std::runtime_error(std::string("invalid png: ") + path);
+    spng_ihdr ihdr;
+    ret = spng_get_ihdr(ctx, &ihdr);
+    if (ret != 0) {
+        spng_ctx_free(ctx);
+        throw std::runtime_error(std::string("error in spng_get_ihdr: ") + spng_strerror(ret) + ", " + path);
     }
 
-    width = ntohl(*(unsigned int*)&png_data[16]);
-    height = ntohl(*(unsigned int*)&png_data[20]);
+    _width = ihdr.width;
+    _height = ihdr.height;
+}
 
-    spng_ctx* ctx = spng_ctx_new(0);
-    assert(ctx != NULL);
+PngImage::~PngImage() { spng_ctx_free(ctx); }
 
-    int ret = spng_set_png_buffer(ctx, png_data.data(), png_data.size());
-    if (ret != 0) {
-        throw std::runtime_error(std::string("error in spng_set_png_buffer: ") + spng_strerror(ret) + ", " + path);
+void PngImage::decode_rgb8(std::span<uint8_t> out) {
+    if (out.size() != rgb8_size()) {
+        throw std::invalid_argument("wrong output size to decode " + path);
     }
 
-    size_t out_size;
-    ret = spng_decoded_image_size(ctx, SPNG_FMT_RGB8, &out_size);
+    int ret = spng_decode_image(ctx, nullptr, 0, SPNG_FMT_RGB8, SPNG_DECODE_PROGRESSIVE);
     if (ret != 0) {
-        throw std::runtime_error(std::string("error in spng_decoded_image_size: ") + spng_strerror(ret) + ", " + path);
+        throw std::runtime_error(std::string("error in spng_decode_image: ") + spng_strerror(ret) + ", " + path);
     }
 
-    std::vector<char> out(out_size);
+    const size_t row_size = (size_t)_width * 3;
 
-    ret = spng_decode_image(ctx, out.data(), out_size, SPNG_FMT_RGB8, 0);
-    if (ret != 0) {
-        throw std::runtime_error(std::string("error in spng_decode_image for: ") + spng_strerror(ret) + ", " + path);
-    }
+    // Interlaced images give rows out of order, so each is placed by its row number
+    do {
+        spng_row_info row_info;
+        ret = spng_get_row_info(ctx, &row_info);
+        if (ret != 0) break;
 
-    spng_ctx_free(ctx);
+        ret = spng_decode_row(ctx, out.data() + row_info.row_num * row_size, row_size);
+    } while (ret == 0);
 
-    return out;
-}
\ No newline at end of file
+    if (ret != SPNG_EOI) {
+        throw std::runtime_error(std::string("error in spng_decode_row: ") + spng_strerror(ret) + ", " + path);
+    }
+}
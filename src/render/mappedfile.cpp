@@ -0,0 +1,73 @@
+#include <render/mappedfile.h>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace render;
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string &path) {
+    std::ifstream file{path, std::ios::in | std::ios::binary | std::ios::ate};
+
+    if (!file.good()) {
+        throw std::runtime_error(std::string("error opening file: ") + path);
+    }
+
+    fallback.resize(file.tellg());
+    file.seekg(0);
+
+    if (!file.read((char *)fallback.data(), fallback.size())) {
+        throw std::runtime_error(std::string("error reading file: ") + path);
+    }
+
+    _data = fallback;
+}
+
+MappedFile::~MappedFile() {}
+
+#else
+
+MappedFile::MappedFile(const std::string &path) {
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) {
+        throw std::runtime_error(std::string("error opening file: ") + path);
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        throw std::runtime_error(std::string("error opening file: ") + path);
+    }
+
+    // Mapping an empty file fails, but there is nothing to read anyway
+    if (info.st_size == 0) {
+        close(fd);
+        return;
+    }
+
+    void *mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // The mapping stays valid after the file is closed
+    close(fd);
+
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error(std::string("error mapping file: ") + path);
+    }
+
+    _data = {(const uint8_t *)mapped, (size_t)info.st_size};
+}
+
+MappedFile::~MappedFile() {
+    if (!_data.empty()) munmap((void *)_data.data(), _data.size());
+}
+
+#endif
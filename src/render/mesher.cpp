@@ -0,0 +1,243 @@
+#include <render/mesher.h>
+#include <config.h>
+#include <tracy/Tracy.hpp>
+#include <cassert>
+#include <stdexcept>
+
+using namespace render;
+
+enum class BlockRotation : unsigned int { FRONT = 0, LEFT = 1, BACK = 2, RIGHT = 3, BOTTOM = 4, TOP = 5 };
+
+constexpr int dir_to_check(BlockRotation rot) {
+    switch (rot) {
+        case BlockRotation::FRONT:
+            return -1;
+        case BlockRotation::LEFT:
+            return -1;
+        case BlockRotation::BACK:
+            return 1;
+        case BlockRotation::RIGHT:
+            return 1;
+        case BlockRotation::BOTTOM:
+            return -1;
+        case BlockRotation::TOP:
+            return 1;
+        default:
+            throw std::logic_error("Invalid block rotation");
+    }
+}
+
+// For each rotation, the direction of the face normal, and the directions of the x and y axes of FACE_VERTS
+static constexpr std::array<std::array<std::array<int, 3>, 3>, 6> FACE_AXES = {{
+    {{{0, 0, -1}, {1, 0, 0}, {0, 1, 0}}},   // front
+    {{{-1, 0, 0}, {0, 0, -1}, {0, 1, 0}}},  // left
+    {{{0, 0, 1}, {-1, 0, 0}, {0, 1, 0}}},   // back
+    {{{1, 0, 0}, {0, 0, 1}, {0, 1, 0}}},    // right
+    {{{0, -1, 0}, {1, 0, 0}, {0, 0, -1}}},  // bottom
+    {{{0, 1, 0}, {1, 0, 0}, {0, 0, 1}}},    // top
+}};
+
+// Ambient occlusion with no occluding neighbours
+static constexpr uint8_t NO_AO = 0xFF;
+
+// Calculates the ambient occlusion of each corner of a face, from the neighbours of the voxel in front of the face.
+// Each corner is 2 bits in the order of FACE_VERTS, where 3 is unoccluded and 0 is fully occluded.
+template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
+static uint8_t face_ao(const models::PaddedOccupancy<X_SIZE, Y_SIZE, Z_SIZE> &occupancy, int x, int y, int z,
+                       BlockRotation rot) {
+    const auto &[normal, u, v] = FACE_AXES[(unsigned int)rot];
+
+    const int px = x + normal[0];
+    const int py = y + normal[1];
+    const int pz = z + normal[2];
+
+    uint8_t ao = 0;
+
+    for (unsigned int i = 0; i < 4; i++) {
+        const int su = (int)FACE_VERTS[i * 3];
+        const int sv = (int)FACE_VERTS[i * 3 + 1];
+
+        const bool side_u = occupancy[px + su * u[0], py + su * u[1], pz + su * u[2]];
+        const bool side_v = occupancy[px + sv * v[0], py + sv * v[1], pz + sv * v[2]];
+        const bool corner = occupancy[px + su * u[0] + sv * v[0], py + su * u[1] + sv * v[1], pz + su * u[2] + sv * v[2]];
+
+        const uint8_t corner_ao = side_u && side_v ? 0 : 3 - (side_u + side_v + corner);
+        ao |= corner_ao << (2 * i);
+    }
+
+    return ao;
+}
+
+template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
+std::span<const VertexDataInstance> render::generate_chunk_vertex_data(
+    const models::Chunk<X_SIZE, Y_SIZE, Z_SIZE> &chunk, const models::PaddedChunkLight<X_SIZE, Y_SIZE, Z_SIZE> &light,
+    const models::PaddedOccupancy<X_SIZE, Y_SIZE, Z_SIZE> *occupancy, int chunk_x, int chunk_y, int chunk_z,
+    std::span<VertexDataInstance> out, unsigned int scale) {
+    ZoneScopedN("generate_chunk_vertex_data");
+
+    assert((out.size() >= max_chunk_instances<X_SIZE, Y_SIZE, Z_SIZE>()));
+
+    auto ao_at = [occupancy](int x, int y, int z, BlockRotation rot) {
+        return occupancy != nullptr ? face_ao(*occupancy, x, y, z, rot) : NO_AO;
+    };
+
+    VertexDataInstance *next = out.data();
+
+    // TODO: mesh rects of faces instead of just strips, refactor
+    //       check neibouring chunks
+    //         - need to hold lock?
+
+    const float voxel_size = (float)config::BLOCK_SIZE * scale;
+    const float y_scale = (float)scale;
+
+    // The shader places faces half a block from the instance position, so for larger voxels the position is moved
+    // towards the face to put it on the surface of the voxel. The world position of voxel (0, 0, 0) of each face is
+    // worked out once, so each face only scales its position within the chunk.
+    std::array<std::array<float, 3>, 6> face_origins;
+
+    for (unsigned int rot = 0; rot < 6; rot++) {
+        const auto &normal = FACE_AXES[rot][0];
+        const float offset = (voxel_size - (float)config::BLOCK_SIZE) / 2.0f;
+
+        face_origins[rot] = {(float)chunk_x * X_SIZE * voxel_size + normal[0] * offset,
+                             (float)chunk_y * Y_SIZE * voxel_size + normal[1] * offset,
+                             (float)chunk_z * Z_SIZE * voxel_size + normal[2] * offset};
+    }
+
+    // Emits a face of length voxels along its x axis, centred on the given position within the chunk
+    auto emit = [&](float centre_x, float centre_y, float centre_z, BlockRotation rot, int length,
+                    const models::Block &block, uint8_t face_light, uint8_t ao) {
+        const auto &origin = face_origins[(unsigned int)rot];
+
+        *next++ = VertexDataInstance{.position = {origin[0] + centre_x * voxel_size, origin[1] + centre_y * voxel_size,
+                                                  origin[2] + centre_z * voxel_size},
+                                     .rotation = (float)rot,
+                                     .xScale = (float)(length * (int)scale),
+                                     .yScale = y_scale,
+                                     .texID = (float)block.face_texture((unsigned int)rot),
+                                     .light = (float)face_light,
+                                     .ao = (float)ao};
+    };
+
+    // Front and back
+    for (int z = 0; z < Z_SIZE; z++) {
+        for (int y = 0; y < Y_SIZE; y++) {
+            for (const auto rot : {BlockRotation::FRONT, BlockRotation::BACK}) {
+                const int dir = dir_to_check(rot);
+                const int edge_z = dir == 1 ? Z_SIZE - 1 : 0;
+
+                for (int x = 0; x < X_SIZE;) {
+                    const models::Block &block = chunk[x, y, z];
+
+                    if (block.id() == models::EMPTY_BLOCK) {
+                        x++;
+                        continue;
+                    }
+
+                    if (!(z == edge_z || !chunk[x, y, z + dir].opaque())) {
+                        x++;
+                        continue;
+                    }
+
+                    const uint8_t face_light = light[x, y, z + dir];
+                    const uint8_t ao = ao_at(x, y, z, rot);
+
+                    int x_start = x;
+                    do {
+                        x++;
+                    } while (x < X_SIZE && chunk[x, y, z].id() == block.id() &&
+                             (z == edge_z || !chunk[x, y, z + dir].opaque()) && light[x, y, z + dir] == face_light &&
+                             ao_at(x, y, z, rot) == ao);
+
+                    const float centre_x = (float)x_start + ((float)x - x_start) / 2.0f;
+                    emit(centre_x, (float)y + 0.5f, (float)z + 0.5f, rot, x - x_start, block, face_light, ao);
+                }
+            }
+        }
+    }
+
+    // Left and right
+    for (int y = 0; y < Y_SIZE; y++) {
+        for (int x = 0; x < X_SIZE; x++) {
+            for (const auto rot : {BlockRotation::LEFT, BlockRotation::RIGHT}) {
+                const int dir = dir_to_check(rot);
+                const int edge_x = dir == 1 ? X_SIZE - 1 : 0;
+
+                for (int z = 0; z < Z_SIZE;) {
+                    const models::Block &block = chunk[x, y, z];
+
+                    if (block.id() == models::EMPTY_BLOCK) {
+                        z++;
+                        continue;
+                    }
+
+                    if (!(x == edge_x || !chunk[x + dir, y, z].opaque())) {
+                        z++;
+                        continue;
+                    }
+
+                    const uint8_t face_light = light[x + dir, y, z];
+                    const uint8_t ao = ao_at(x, y, z, rot);
+
+                    int z_start = z;
+                    do {
+                        z++;
+                    } while (z < Z_SIZE && chunk[x, y, z].id() == block.id() &&
+                             (x == edge_x || !chunk[x + dir, y, z].opaque()) && light[x + dir, y, z] == face_light &&
+                             ao_at(x, y, z, rot) == ao);
+
+                    const float centre_z = (float)z_start + ((float)z - z_start) / 2.0f;
+                    emit((float)x + 0.5f, (float)y + 0.5f, centre_z, rot, z - z_start, block, face_light, ao);
+                }
+            }
+        }
+    }
+
+    // Top and bottom
+    for (int z = 0; z < Z_SIZE; z++) {
+        for (int y = 0; y < Y_SIZE; y++) {
+            for (const auto rot : {BlockRotation::BOTTOM, BlockRotation::TOP}) {
+                const int dir = dir_to_check(rot);
+                const int edge_y = dir == 1 ? Y_SIZE - 1 : 0;
+
+                for (int x = 0; x < X_SIZE;) {
+                    const models::Block &block = chunk[x, y, z];
+
+                    if (block.id() == models::EMPTY_BLOCK) {
+                        x++;
+                        continue;
+                    }
+
+                    if (!(y == edge_y || !chunk[x, y + dir, z].opaque())) {
+                        x++;
+                        continue;
+                    }
+
+                    const uint8_t face_light = light[x, y + dir, z];
+                    const uint8_t ao = ao_at(x, y, z, rot);
+
+                    int x_start = x;
+                    do {
+                        x++;
+                    } while (x < X_SIZE && chunk[x, y, z].id() == block.id() &&
+                             (y == edge_y || !chunk[x, y + dir, z].opaque()) && light[x, y + dir, z] == face_light &&
+                             ao_at(x, y, z, rot) == ao);
+
+                    const float centre_x = (float)x_start + ((float)x - x_start) / 2.0f;
+                    emit(centre_x, (float)y + 0.5f, (float)z + 0.5f, rot, x - x_start, block, face_light, ao);
+                }
+            }
+        }
+    }
+
+    return out.first(next - out.data());
+}
+
+template std::span<const VertexDataInstance> render::generate_chunk_vertex_data(
+    const models::Chunk<models::RenderingChunk::X_SIZE, models::RenderingChunk::Y_SIZE, models::RenderingChunk::Z_SIZE>
+        &chunk,
+    const models::PaddedChunkLight<models::RenderingChunk::X_SIZE, models::RenderingChunk::Y_SIZE,
+                                   models::RenderingChunk::Z_SIZE> &light,
+    const models::PaddedOccupancy<models::RenderingChunk::X_SIZE, models::RenderingChunk::Y_SIZE,
+                                  models::RenderingChunk::Z_SIZE> *occupancy,
+    int chunk_x, int chunk_y, int chunk_z, std::span<VertexDataInstance> out, unsigned int scale);
@@ -0,0 +1,205 @@
+#include <render/occlusion.h>
+#include <immintrin.h>
+#include <algorithm>
+#include <cmath>
+#include <assert.h>
+
+using namespace render;
+
+// Points closer than this along the view direction are treated as too close to project reliably
+static constexpr float MIN_W = 1.0f;
+
+// Occluders reaching further than this many buffer widths or heights off screen are skipped, as the edge functions of
+// their triangles would lose precision
+static constexpr float GUARD_BAND = 16.0f;
+
+// The corners of each face of a box, indexed as in project_corners.
+// Corners are counter-clockwise seen from outside the box, so faces towards the camera have a positive area on screen.
+static constexpr std::array<std::array<unsigned int, 4>, 6> BOX_FACES = {{
+    {0, 4, 6, 2},  // -x
+    {1, 3, 7, 5},  // +x
+    {0, 1, 5, 4},  // -y
+    {2, 6, 7, 3},  // +y
+    {0, 2, 3, 1},  // -z
+    {4, 5, 7, 6},  // +z
+}};
+
+// Twice the signed area of a triangle on screen, positive when counter-clockwise
+static float signed_area(float ax, float ay, float bx, float by, float cx, float cy) {
+    return (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+}
+
+OcclusionBuffer::OcclusionBuffer(unsigned int width, unsigned int height)
+    : width(width), height(height), inverse_depth((size_t)width * height, 0.0f) {
+    assert(width % 8 == 0);
+}
+
+void OcclusionBuffer::clear(const gfxm::Matrix<4, 4> &projview) {
+    this->projview = projview;
+
+    // Zero inverse depth is infinitely far away
+    std::fill(inverse_depth.begin(), inverse_depth.end(), 0.0f);
+}
+
+bool OcclusionBuffer::project_corners(const Aabb &box, std::array<ScreenVertex, 8> &out) const {
+    std::array<std::array<float, 3>, 8> corners;
+
+    for (unsigned int i = 0; i < 8; i++) {
+        corners[i] = {i & 1 ? box.max[0] : box.min[0], i & 2 ? box.max[1] : box.min[1], i & 4 ? box.max[2] : box.min[2]};
+    }
+
+    std::array<std::array<float, 4>, 8> clip;
+    gfxm::transform_points(projview, corners, clip);
+
+    for (unsigned int i = 0; i < 8; i++) {
+        const auto &[x, y, z, w] = clip[i];
+        if (w < MIN_W) return false;
+
+        out[i] = {.x = (x / w * 0.5f + 0.5f) * width, .y = (y / w * 0.5f + 0.5f) * height, .inverse_w = 1.0f / w};
+    }
+
+    return true;
+}
+
+void OcclusionBuffer::rasterize_triangle(const ScreenVertex &a, const ScreenVertex &b, const ScreenVertex &c) {
+    const float area = signed_area(a.x, a.y, b.x, b.y, c.x, c.y);
+    if (area < 1e-6f) return;
+
+    const int min_x = std::max(0, (int)std::floor(std::min({a.x, b.x, c.x})));
+    const int max_x = std::min((int)width - 1, (int)std::ceil(std::max({a.x, b.x, c.x})));
+    const int min_y = std::max(0, (int)std::floor(std::min({a.y, b.y, c.y})));
+    const int max_y = std::min((int)height - 1, (int)std::ceil(std::max({a.y, b.y, c.y})));
+
+    if (min_x > max_x || min_y > max_y) return;
+
+    // Edge functions a * x + b * y + c, positive inside the triangle. Each is the area of the triangle made with the
+    // point, so they are also the barycentric weights of the opposite vertex times the area.
+    struct Edge {
+        float a;
+        float b;
+        float c;
+    };
+
+    const auto edge = [](const ScreenVertex &p, const ScreenVertex &q) {
+        return Edge{.a = -(q.y - p.y), .b = q.x - p.x, .c = (q.y - p.y) * p.x - (q.x - p.x) * p.y};
+    };
+
+    const Edge e0 = edge(b, c);
+    const Edge e1 = edge(c, a);
+    const Edge e2 = edge(a, b);
+
+    // The inverse depth is linear in screen space
+    const Edge depth = {.a = (e0.a * a.inverse_w + e1.a * b.inverse_w + e2.a * c.inverse_w) / area,
+                        .b = (e0.b * a.inverse_w + e1.b * b.inverse_w + e2.b * c.inverse_w) / area,
+                        .c = (e0.c * a.inverse_w + e1.c * b.inverse_w + e2.c * c.inverse_w) / area};
+
+    const __m256 lane_offsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+    const __m256 zero = _mm256_setzero_ps();
+
+    const __m256 e0_a = _mm256_set1_ps(e0.a);
+    const __m256 e1_a = _mm256_set1_ps(e1.a);
+    const __m256 e2_a = _mm256_set1_ps(e2.a);
+    const __m256 depth_a = _mm256_set1_ps(depth.a);
+
+    // Rows are whole, so blocks of 8 pixels starting at a multiple of 8 never run past the end of a row
+    const int start_x = min_x & ~7;
+
+    for (int y = min_y; y <= max_y; y++) {
+        const float py = (float)y + 0.5f;
+
+        const __m256 e0_row = _mm256_set1_ps(e0.b * py + e0.c);
+        const __m256 e1_row = _mm256_set1_ps(e1.b * py + e1.c);
+        const __m256 e2_row = _mm256_set1_ps(e2.b * py + e2.c);
+        const __m256 depth_row = _mm256_set1_ps(depth.b * py + depth.c);
+
+        float *row = inverse_depth.data() + (size_t)y * width;
+
+        for (int x = start_x; x <= max_x; x += 8) {
+            const __m256 px = _mm256_add_ps(_mm256_set1_ps((float)x), lane_offsets);
+
+            const __m256 w0 = _mm256_add_ps(_mm256_mul_ps(e0_a, px), e0_row);
+            const __m256 w1 = _mm256_add_ps(_mm256_mul_ps(e1_a, px), e1_row);
+            const __m256 w2 = _mm256_add_ps(_mm256_mul_ps(e2_a, px), e2_row);
+
+            const __m256 inside = _mm256_and_ps(
+                _mm256_and_ps(_mm256_cmp_ps(w0, zero, _CMP_GE_OQ), _mm256_cmp_ps(w1, zero, _CMP_GE_OQ)),
+                _mm256_cmp_ps(w2, zero, _CMP_GE_OQ));
+
+            if (_mm256_movemask_ps(inside) == 0) continue;
+
+            const __m256 d = _mm256_add_ps(_mm256_mul_ps(depth_a, px), depth_row);
+            const __m256 current = _mm256_loadu_ps(row + x);
+
+            _mm256_storeu_ps(row + x, _mm256_blendv_ps(current, _mm256_max_ps(current, d), inside));
+        }
+    }
+}
+
+void OcclusionBuffer::draw_occluder(const Aabb &box) {
+    std::array<ScreenVertex, 8> corners;
+    if (!project_corners(box, corners)) return;
+
+    for (const ScreenVertex &v : corners) {
+        if (std::abs(v.x) > GUARD_BAND * width || std::abs(v.y) > GUARD_BAND * height) return;
+    }
+
+    // Only the faces towards the camera, as the ones behind them are always further away
+    for (const auto &face : BOX_FACES) {
+        const ScreenVertex &a = corners[face[0]];
+        const ScreenVertex &b = corners[face[1]];
+        const ScreenVertex &c = corners[face[2]];
+        if (signed_area(a.x, a.y, b.x, b.y, c.x, c.y) <= 0) continue;
+
+        rasterize_triangle(corners[face[0]], corners[face[1]], corners[face[2]]);
+        rasterize_triangle(corners[face[0]], corners[face[2]], corners[face[3]]);
+    }
+}
+
+bool OcclusionBuffer::is_visible(const Aabb &box) const {
+    float min_x = INFINITY;
+    float max_x = -INFINITY;
+    float min_y = INFINITY;
+    float max_y = -INFINITY;
+    float nearest = 0.0f;
+
+    std::array<ScreenVertex, 8> corners;
+    if (!project_corners(box, corners)) return true;
+
+    for (const ScreenVertex &v : corners) {
+        min_x = std::min(min_x, v.x);
+        max_x = std::max(max_x, v.x);
+        min_y = std::min(min_y, v.y);
+        max_y = std::max(max_y, v.y);
+        nearest = std::max(nearest, v.inverse_w);
+    }
+
+    if (max_x < 0 || min_x > width || max_y < 0 || min_y > height) return false;
+
+    // Grown by a pixel, as occluders cover every pixel whose centre they touch
+    const int x0 = std::max(0, (int)std::floor(min_x) - 1);
+    const int x1 = std::min((int)width - 1, (int)std::ceil(max_x) + 1);
+    const int y0 = std::max(0, (int)std::floor(min_y) - 1);
+    const int y1 = std::min((int)height - 1, (int)std::ceil(max_y) + 1);
+
+    const __m256 nearest_v = _mm256_set1_ps(nearest);
+    const __m256i lane_indices = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i first = _mm256_set1_epi32(x0 - 1);
+    const __m256i last = _mm256_set1_epi32(x1 + 1);
+
+    for (int y = y0; y <= y1; y++) {
+        const float *row = inverse_depth.data() + (size_t)y * width;
+
+        for (int x = x0 & ~7; x <= x1; x += 8) {
+            const __m256i indices = _mm256_add_epi32(_mm256_set1_epi32(x), lane_indices);
+            const __m256i in_rect =
+                _mm256_and_si256(_mm256_cmpgt_epi32(indices, first), _mm256_cmpgt_epi32(last, indices));
+
+            // Visible where no occluder is nearer than the nearest corner of the box
+            const __m256 not_hidden = _mm256_cmp_ps(_mm256_loadu_ps(row + x), nearest_v, _CMP_LE_OQ);
+
+            if (_mm256_movemask_ps(_mm256_and_ps(not_hidden, _mm256_castsi256_ps(in_rect))) != 0) return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,66 @@
+#include <render/rangeallocator.h>
+#include <assert.h>
+#include <iterator>
+
+using namespace render;
+
+RangeAllocator::RangeAllocator(unsigned int capacity) : _capacity(capacity) {
+    if (capacity > 0) free_ranges.emplace(0, capacity);
+}
+
+std::optional<unsigned int> RangeAllocator::allocate(unsigned int size) {
+    if (size == 0) return 0;
+
+    for (auto it = free_ranges.begin(); it != free_ranges.end(); it++) {
+        const auto [offset, free_size] = *it;
+        if (free_size < size) continue;
+
+        free_ranges.erase(it);
+        if (free_size > size) free_ranges.emplace(offset + size, free_size - size);
+
+        _used += size;
+        return offset;
+    }
+
+    return std::nullopt;
+}
+
+void RangeAllocator::free(unsigned int offset, unsigned int size) {
+    if (size == 0) return;
+
+    assert(offset + size <= _capacity);
+    _used -= size;
+
+    auto next = free_ranges.lower_bound(offset);
+
+    // Merge with the following free range
+    if (next != free_ranges.end() && offset + size == next->first) {
+        size += next->second;
+        next = free_ranges.erase(next);
+    }
+
+    // Merge with the preceding free range
+    if (next != free_ranges.begin()) {
+        auto prev = std::prev(next);
+        assert(prev->first + prev->second <= offset);
+
+        if (prev->first + prev->second == offset) {
+            prev->second += size;
+            return;
+        }
+    }
+
+    free_ranges.emplace_hint(next, offset, size);
+}
+
+void RangeAllocator::grow(unsigned int new_capacity) {
+    assert(new_capacity >= _capacity);
+
+    const unsigned int old_capacity = _capacity;
+    const unsigned int added = new_capacity - old_capacity;
+    _capacity = new_capacity;
+
+    // Counted as used so free doesn't underflow it
+    _used += added;
+    free(old_capacity, added);
+}
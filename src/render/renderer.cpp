@@ -1,28 +1,22 @@
 #include <render/renderer.h>
-#include <render/image.h>
+#include <render/texturearray.h>
 #include <config.h>
 #include <iostream>
 #include <tracy/Tracy.hpp>
 #include <format>
+#include <chrono>
 
 using namespace render;
 
-static constexpr std::array<float, 12> FACE_VERTS = {
-    -1.0f, 1.0f,  -1.0f,  // top left
-    -1.0f, -1.0f, -1.0f,  // bottom left
-    1.0f,  1.0f,  -1.0f,  // top right
-    1.0f,  -1.0f, -1.0f,  // bottom right
-};
-
 // ccw winding
 static constexpr std::array<uint8_t, 6> FACE_INDICES = {
     0, 1, 2, 1, 3, 2,
 };
 
 // NOTE: all attributes must be at least 4 byte aligned...
-static constexpr std::array<VertexArray::VertexAttribute, 6> build_chunk_render_attributes(
+static constexpr std::array<VertexArray::VertexAttribute, 8> build_chunk_render_attributes(
     unsigned long long verts_size) {
-    constexpr GLsizei INSTANCED_STRIDE = 3 * sizeof(float) + 4 * sizeof(float);
+    constexpr GLsizei INSTANCED_STRIDE = 3 * sizeof(float) + 6 * sizeof(float);
 
     return {{
         // Vertices
@@ -69,6 +63,22 @@ static constexpr std::array<VertexArray::VertexAttribute, 6> build_chunk_render_
          .stride = INSTANCED_STRIDE,
          .pointer = (void *)(verts_size * sizeof(float) + 3 * sizeof(float) + 3 * sizeof(float)),
          .divisor = 1},
+
+        // light
+        {.type = GL_FLOAT,
+         .index = 6,
+         .size = 1,
+         .stride = INSTANCED_STRIDE,
+         .pointer = (void *)(verts_size * sizeof(float) + 3 * sizeof(float) + 4 * sizeof(float)),
+         .divisor = 1},
+
+        // ao
+        {.type = GL_FLOAT,
+         .index = 7,
+         .size = 1,
+         .stride = INSTANCED_STRIDE,
+         .pointer = (void *)(verts_size * sizeof(float) + 3 * sizeof(float) + 5 * sizeof(float)),
+         .divisor = 1},
     }};
 }
 
@@ -81,9 +91,14 @@ layout (location = 2) in float rotation;
 layout (location = 3) in float xScale;
 layout (location = 4) in float yScale;
 layout (location = 5) in float texID;
+layout (location = 6) in float light;
+layout (location = 7) in float ao;
 
 out vec3 texCoord;
 out float lightCosine;
+out float skyLight;
+out float blockLight;
+out float occlusion;
 
 uniform mat4 projview;
 uniform vec3 lightPos;
@@ -148,6 +163,15 @@ void main() {{
     gl_Position = projview * (ROTATIONS[int(rotation)] * vec4(HALF_BLOCK_SIZE * scaledVert, 1.0) + vec4(position, 0.0));
     texCoord = vec3((scaledVert.x + xScale) / 2, (scaledVert.y + yScale) / 2, texID);
     lightCosine = max(dot(NORMALS_WORLD[int(rotation)], normalize(lightPos - position)), 0.0);
+
+    // Sky light in the high nibble, block light in the low nibble
+    int packedLight = int(light);
+    skyLight = pow(0.8, float(15 - (packedLight >> 4)));
+    blockLight = pow(0.8, float(15 - (packedLight & 15)));
+
+    // 2 bits of ambient occlusion per corner, indexed by vertex, 3 being unoccluded
+    int packedAO = int(ao);
+    occlusion = 0.5 + float((packedAO >> (2 * gl_VertexID)) & 3) / 6.0;
 }}
 )", config::BLOCK_SIZE);
 
@@ -156,205 +180,32 @@ static const char *fshader_src = R"(
 
 in vec3 texCoord;
 in float lightCosine;
+in float skyLight;
+in float blockLight;
+in float occlusion;
 out vec4 colour;
 
 uniform sampler2DArray tex;
 
 void main() {
     const float ambient = 0.6;
-    colour = texture(tex, texCoord) * (ambient + lightCosine / 2.5);
+    colour = texture(tex, texCoord) * max(skyLight * (ambient + lightCosine / 2.5), blockLight) * occlusion;
 }
 )";
 
-struct __attribute__((packed)) VertexDataInstance {
-    std::array<float, 3> position;
-    float rotation;
-    float xScale;
-    float yScale;
-    float texID;
-
-    void append_to(std::vector<uint8_t> &vec) const { vec.insert(vec.end(), (uint8_t *)this, (uint8_t *)(this + 1)); }
-};
-
-static const std::array<VertexArray::VertexAttribute, 6> RENDER_ATTRIBUTES =
+static const std::array<VertexArray::VertexAttribute, 8> RENDER_ATTRIBUTES =
     build_chunk_render_attributes(FACE_VERTS.size());
 
-enum class BlockRotation : unsigned int { FRONT = 0, LEFT = 1, BACK = 2, RIGHT = 3, BOTTOM = 4, TOP = 5 };
-
-constexpr int dir_to_check(BlockRotation rot) {
-    switch (rot) {
-        case BlockRotation::FRONT:
-            return -1;
-        case BlockRotation::LEFT:
-            return -1;
-        case BlockRotation::BACK:
-            return 1;
-        case BlockRotation::RIGHT:
-            return 1;
-        case BlockRotation::BOTTOM:
-            return -1;
-        case BlockRotation::TOP:
-            return 1;
-        default:
-            throw std::logic_error("Invalid block rotation");
-    }
-}
-
-template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
-unsigned int render::generate_chunk_vertex_data(const models::Chunk<X_SIZE, Y_SIZE, Z_SIZE> &chunk, int chunk_x,
-                                                int chunk_y, int chunk_z, std::vector<uint8_t> &data) {
-    data.clear();
-
-    unsigned int instance_count = 0;
-
-    // TODO: mesh rects of faces instead of just strips, refactor
-    //       check neibouring chunks
-    //         - need to hold lock?
-
-    const gfxm::Vec<3> chunk_offset =
-        gfxm::Vec<3>({(float)chunk_x * X_SIZE, (float)chunk_y * Y_SIZE, (float)chunk_z * Z_SIZE}) * config::BLOCK_SIZE;
-
-    // Front and back
-    for (int z = 0; z < Z_SIZE; z++) {
-        for (int y = 0; y < Y_SIZE; y++) {
-            for (const auto rot : {BlockRotation::FRONT, BlockRotation::BACK}) {
-                const int dir = dir_to_check(rot);
-                const int edge_z = dir == 1 ? Z_SIZE - 1 : 0;
-
-                for (int x = 0; x < X_SIZE;) {
-                    const models::Block &block = chunk[x, y, z];
-
-                    if (block.id() == models::EMPTY_BLOCK) {
-                        x++;
-                        continue;
-                    }
-
-                    if (!(z == edge_z || !chunk[x, y, z + dir].opaque())) {
-                        x++;
-                        continue;
-                    }
-
-                    int x_start = x;
-                    do {
-                        x++;
-                    } while (x < X_SIZE && chunk[x, y, z].id() == block.id() &&
-                             (z == edge_z || !chunk[x, y, z + dir].opaque()));
-
-                    float centre_x = (float)x_start + ((float)x - x_start) / 2.0f;
-
-                    gfxm::Vec<3> pos = chunk_offset + gfxm::Vec<3>({centre_x, (float)y + 0.5f, (float)z + 0.5f}) *
-                                                          (float)config::BLOCK_SIZE;
-
-                    VertexDataInstance{.position = pos.array(),
-                                       .rotation = (float)rot,
-                                       .xScale = (float)(x - x_start),
-                                       .yScale = 1.0f,
-                                       .texID = (float)(block.id() - 1)}
-                        .append_to(data);
-
-                    instance_count++;
-                }
-            }
-        }
-    }
+// The number of instances the instance buffer starts with space for
+static constexpr unsigned int INITIAL_INSTANCE_CAPACITY = 1 << 20;
 
-    // Left and right
-    for (int y = 0; y < Y_SIZE; y++) {
-        for (int x = 0; x < X_SIZE; x++) {
-            for (const auto rot : {BlockRotation::LEFT, BlockRotation::RIGHT}) {
-                const int dir = dir_to_check(rot);
-                const int edge_x = dir == 1 ? X_SIZE - 1 : 0;
-
-                for (int z = 0; z < Z_SIZE;) {
-                    const models::Block &block = chunk[x, y, z];
-
-                    if (block.id() == models::EMPTY_BLOCK) {
-                        z++;
-                        continue;
-                    }
-
-                    if (!(x == edge_x || !chunk[x + dir, y, z].opaque())) {
-                        z++;
-                        continue;
-                    }
-
-                    int z_start = z;
-                    do {
-                        z++;
-                    } while (z < Z_SIZE && chunk[x, y, z].id() == block.id() &&
-                             (x == edge_x || !chunk[x + dir, y, z].opaque()));
-
-                    float centre_z = (float)z_start + ((float)z - z_start) / 2.0f;
-
-                    gfxm::Vec<3> pos = chunk_offset + gfxm::Vec<3>({(float)x + 0.5f, (float)y + 0.5f, centre_z}) *
-                                                          (float)config::BLOCK_SIZE;
-
-                    VertexDataInstance{.position = pos.array(),
-                                       .rotation = (float)rot,
-                                       .xScale = (float)(z - z_start),
-                                       .yScale = 1.0f,
-                                       .texID = (float)(block.id() - 1)}
-                        .append_to(data);
-
-                    instance_count++;
-                }
-            }
-        }
-    }
+static constexpr size_t FACE_VERTS_BYTES = FACE_VERTS.size() * sizeof(float);
 
-    // Top and bottom
-    for (int z = 0; z < Z_SIZE; z++) {
-        for (int y = 0; y < Y_SIZE; y++) {
-            for (const auto rot : {BlockRotation::BOTTOM, BlockRotation::TOP}) {
-                const int dir = dir_to_check(rot);
-                const int edge_y = dir == 1 ? Y_SIZE - 1 : 0;
-
-                for (int x = 0; x < X_SIZE;) {
-                    const models::Block &block = chunk[x, y, z];
-
-                    if (block.id() == models::EMPTY_BLOCK) {
-                        x++;
-                        continue;
-                    }
-
-                    if (!(y == edge_y || !chunk[x, y + dir, z].opaque())) {
-                        x++;
-                        continue;
-                    }
-
-                    int x_start = x;
-                    do {
-                        x++;
-                    } while (x < X_SIZE && chunk[x, y, z].id() == block.id() &&
-                             (y == edge_y || !chunk[x, y + dir, z].opaque()));
-
-                    float centre_x = (float)x_start + ((float)x - x_start) / 2.0f;
-
-                    gfxm::Vec<3> pos = chunk_offset + gfxm::Vec<3>({centre_x, (float)y + 0.5f, (float)z + 0.5f}) *
-                                                          (float)config::BLOCK_SIZE;
-
-                    VertexDataInstance{.position = pos.array(),
-                                       .rotation = (float)rot,
-                                       .xScale = (float)(x - x_start),
-                                       .yScale = 1.0f,
-                                       .texID = (float)(block.id() - 1)}
-                        .append_to(data);
-
-                    instance_count++;
-                }
-            }
-        }
-    }
-
-    return instance_count;
-}
-
-template unsigned int render::generate_chunk_vertex_data(
-    const models::Chunk<models::RenderingChunk::X_SIZE, models::RenderingChunk::Y_SIZE, models::RenderingChunk::Z_SIZE>
-        &chunk,
-    int chunk_x, int chunk_y, int chunk_z, std::vector<uint8_t> &data);
-
-Renderer::Renderer() noexcept : vertex_array({}, FACE_INDICES, RENDER_ATTRIBUTES) {
+Renderer::Renderer()
+    : vertex_array({}, FACE_INDICES, RENDER_ATTRIBUTES),
+      instance_allocator(INITIAL_INSTANCE_CAPACITY),
+      staging(config::MESH_STAGING_BYTES),
+      occlusion(config::OCCLUSION_BUFFER_WIDTH, config::OCCLUSION_BUFFER_HEIGHT) {
     // Load shaders
     program = glCreateProgram();
 
@@ -379,56 +230,173 @@ Renderer::Renderer() noexcept : vertex_array({}, FACE_INDICES, RENDER_ATTRIBUTES
 
     // Load textures
 
-    unsigned int img_width, img_height;
-    unsigned int img2_width, img2_height;
-    std::vector<char> img1 = load_png_rgb8("../assets/stone.png", img_width, img_height);
-    std::vector<char> img2 = load_png_rgb8("../assets/dirt.png", img2_width, img2_height);
-
-    assert(img_width == img2_width && img_height == img2_height);
-
-    glGenTextures(1, &texture_array);
-    glBindTexture(GL_TEXTURE_2D_ARRAY, texture_array);
-
-    glTexStorage3D(GL_TEXTURE_2D_ARRAY, 4, GL_RGB8, img_width, img_height, 2);
-
-    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, img_width, img_height, 1, GL_RGB, GL_UNSIGNED_BYTE, img1.data());
-
-    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 1, img_width, img_height, 1, GL_RGB, GL_UNSIGNED_BYTE, img2.data());
+    // One layer for each texture used by the blocks, in the order of the block registry.
+    // Loading is timed by its Tracy zones.
+    texture_array = create_texture_array(load_texture_array(
+        "../assets", models::active_block_registry.texture_names(), config::TEXTURE_CACHE_PATH));
 
     glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
 
-    // Add vertices
-    _vertex_data.insert(_vertex_data.end(), (uint8_t *)FACE_VERTS.data(),
-                        (uint8_t *)(FACE_VERTS.data() + FACE_VERTS.size()));
+    // Vertices first, followed by the instances of each mesh
+    vertex_array.set_data({(const uint8_t *)FACE_VERTS.data(), FACE_VERTS_BYTES});
+    vertex_array.grow(FACE_VERTS_BYTES, FACE_VERTS_BYTES + (size_t)INITIAL_INSTANCE_CAPACITY * sizeof(VertexDataInstance));
+
+    glGenBuffers(1, &indirect_buffer);
 }
 
 Renderer::~Renderer() {
+    glDeleteBuffers(1, &indirect_buffer);
     glDeleteProgram(program);
     glDeleteTextures(1, &texture_array);
 }
 
-void Renderer::reset() {
-    _vertex_data.resize(FACE_VERTS.size() * sizeof(float));
-    _instance_count = 0;
+void Renderer::free_range(const MeshRange &range) {
+    instance_allocator.free(range.first_instance, range.instance_count);
 }
 
-void Renderer::add_vertex_data(const std::span<const uint8_t> vertex_data, unsigned int instance_count) {
-    _vertex_data.insert(_vertex_data.end(), vertex_data.begin(), vertex_data.end());
-    _instance_count += instance_count;
+DrawElementsIndirectCommand Renderer::draw_command(const MeshRange &range) const {
+    // The instanced attributes are offset by base_instance, so every mesh shares the same face vertices and indices
+    return {.count = (GLuint)vertex_array.indices_count(),
+            .instance_count = range.instance_count,
+            .first_index = 0,
+            .base_vertex = 0,
+            .base_instance = range.first_instance};
 }
 
-void Renderer::write_vertex_data() { vertex_array.set_data(_vertex_data); }
+void Renderer::upload_staged_mesh(const MeshKey &key, size_t staging_offset, unsigned int instance_count,
+                                  ChunkCulling culling) {
+    const size_t size = (size_t)instance_count * sizeof(VertexDataInstance);
+
+    _mesh_generation++;
+
+    auto it = meshes.find(key);
+    if (it != meshes.end()) {
+        free_range(it->second);
+        meshes.erase(it);
+    }
+
+    std::optional<unsigned int> first_instance = instance_allocator.allocate(instance_count);
+
+    if (!first_instance.has_value()) {
+        ZoneScopedN("grow_instance_buffer");
+
+        const unsigned int old_capacity = instance_allocator.capacity();
+        const unsigned int new_capacity = std::max(2 * old_capacity, old_capacity + instance_count);
+
+        vertex_array.grow(FACE_VERTS_BYTES + (size_t)old_capacity * sizeof(VertexDataInstance),
+                          FACE_VERTS_BYTES + (size_t)new_capacity * sizeof(VertexDataInstance));
+        instance_allocator.grow(new_capacity);
+
+        first_instance = instance_allocator.allocate(instance_count);
+        assert(first_instance.has_value());
+    }
+
+    staging.copy_to(vertex_array, staging_offset, size,
+                    FACE_VERTS_BYTES + (size_t)*first_instance * sizeof(VertexDataInstance));
+    meshes.emplace(key, MeshRange{.first_instance = *first_instance,
+                                  .instance_count = instance_count,
+                                  .culling = culling});
+
+    TracyPlot("gpu_mesh_bytes", (int64_t)instance_allocator.used() * (int64_t)sizeof(VertexDataInstance));
+}
+
+void Renderer::fence_uploads(size_t staging_bytes) { staging.fence(staging_bytes); }
+
+void Renderer::free_meshes_if(const std::function<bool(const MeshKey &)> &predicate) {
+    const size_t erased = std::erase_if(meshes, [this, &predicate](const auto &item) {
+        if (!predicate(item.first)) return false;
+
+        free_range(item.second);
+        return true;
+    });
+
+    if (erased > 0) _mesh_generation++;
+}
+
+std::vector<MeshDraw> Renderer::snapshot_meshes() const {
+    ZoneScopedN("Renderer::snapshot_meshes");
+
+    std::vector<MeshDraw> snapshot;
+    snapshot.reserve(meshes.size());
+
+    for (const auto &[key, range] : meshes) {
+        snapshot.push_back({.key = key, .command = draw_command(range), .culling = range.culling});
+    }
+
+    return snapshot;
+}
+
+void Renderer::set_draw_list(DrawList list) {
+    draw_list = std::move(list);
+    draw_list_dirty = true;
+}
+
+void Renderer::patch_draw_list() {
+    ZoneScopedN("Renderer::patch_draw_list");
+
+    // The instances of freed meshes may have been given to other meshes, so every command is looked up again
+    size_t kept = 0;
+
+    for (size_t i = 0; i < draw_list.keys.size(); i++) {
+        auto it = meshes.find(draw_list.keys[i]);
+        if (it == meshes.end() || it->second.instance_count == 0) continue;
+
+        draw_list.keys[kept] = draw_list.keys[i];
+        draw_list.commands[kept] = draw_command(it->second);
+        kept++;
+    }
+
+    draw_list.keys.resize(kept);
+    draw_list.commands.resize(kept);
+    draw_list.mesh_generation = _mesh_generation;
+    draw_list_dirty = true;
+}
+
+void Renderer::cull_occluded(const gfxm::Matrix<4, 4> &projview) {
+    ZoneScopedN("Renderer::cull_occluded");
+
+    [[maybe_unused]] const auto cull_start = std::chrono::steady_clock::now();
+
+    occlusion.clear(projview);
+    for (const Aabb &occluder : draw_list.occluders) occlusion.draw_occluder(occluder);
+
+    unoccluded_commands.clear();
+
+    for (size_t i = 0; i < draw_list.keys.size(); i++) {
+        // Grown by a block, so rounding in the mesh positions can't hide a face
+        Aabb bounds = mesh_bounds(draw_list.keys[i]);
+        for (unsigned int axis = 0; axis < 3; axis++) {
+            bounds.min[axis] -= config::BLOCK_SIZE;
+            bounds.max[axis] += config::BLOCK_SIZE;
+        }
+
+        if (occlusion.is_visible(bounds)) unoccluded_commands.push_back(draw_list.commands[i]);
+    }
+
+    [[maybe_unused]] const float cull_us =
+        std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - cull_start).count();
+    [[maybe_unused]] const float culled_percent =
+        draw_list.commands.empty() ? 0.0f
+                                   : 100.0f * (draw_list.commands.size() - unoccluded_commands.size()) /
+                                         draw_list.commands.size();
+
+    TracyPlot("occlusion_cull_us", cull_us);
+    TracyPlot("occlusion_culled_percent", culled_percent);
+    TracyPlot("occluders", (int64_t)draw_list.occluders.size());
+}
 
 void Renderer::render(const App &app) {
     ZoneScopedN("Renderer::render");
 
     static constexpr float near = 5.0f;
-    static constexpr float far = 50000.0f;
+    // Far enough to see the corners of the coarsest level of detail ring, which can reach up to two of its nodes past
+    // the level of detail render distance. The far terrain is drawn separately.
+    static constexpr float far = 1.5f * (float)config::BLOCK_SIZE * models::RenderingChunk::X_SIZE *
+                                 (config::LOD_RENDER_DISTANCE + (2 << config::LOD_LEVELS));
 
     float aspect_ratio = (float)app.width() / (float)app.height();
     float half_near_height = near * tanf(app.fov() / 2.0f);
@@ -444,11 +412,48 @@ void Renderer::render(const App &app) {
     glUniformMatrix4fv(projview_uniform, 1, GL_FALSE, projview.array().data());
 
     const auto pos = app.camera().pos();
-    const float maxh = (float)config::BLOCK_SIZE * models::RenderingChunk::Y_SIZE * config::MAX_CHUNK_Y;
+    const float maxh = (float)config::BLOCK_SIZE * config::MAX_TERRAIN_HEIGHT;
     auto light =
         gfxm::Vec<3>({pos[0, 0], maxh, pos[2, 0]}) +
         gfxm::Vec<3>({0.4755282581475768f, 0.8090169943749475f, 0.3454915028125263f}) * config::BLOCK_SIZE * 100;
     glUniform3f(lightpos_uniform, light[0, 0], light[1, 0], light[2, 0]);
 
-    vertex_array.draw_instanced(_instance_count);
+    if (draw_list.mesh_generation != _mesh_generation) patch_draw_list();
+
+    // Occlusion depends on where the camera is looking, so the culled commands are uploaded every frame
+    std::span<const DrawElementsIndirectCommand> commands = draw_list.commands;
+
+    if (config::OCCLUSION_CULLING) {
+        cull_occluded(projview);
+        commands = unoccluded_commands;
+        draw_list_dirty = true;
+    }
+
+    if (draw_list_dirty) {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer);
+
+        // Only reallocated when the commands outgrow it, doubling so the count settles quickly
+        if (commands.size() > indirect_capacity) {
+            indirect_capacity = std::max(2 * indirect_capacity, commands.size());
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, indirect_capacity * sizeof(DrawElementsIndirectCommand), nullptr,
+                         GL_DYNAMIC_DRAW);
+        }
+
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commands.size_bytes(), commands.data());
+        draw_list_dirty = false;
+    }
+
+    {
+        ZoneScopedN("submit_draws");
+
+        [[maybe_unused]] const auto submit_start = std::chrono::steady_clock::now();
+
+        vertex_array.multi_draw_indirect(indirect_buffer, (GLsizei)commands.size());
+
+        [[maybe_unused]] const float submit_us =
+            std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - submit_start).count();
+
+        TracyPlot("draw_count", (int64_t)commands.size());
+        TracyPlot("draw_submit_us", submit_us);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,76 @@
+#include <render/stagingbuffer.h>
+#include <debug.h>
+#include <utility>
+
+using namespace render;
+
+StagingBuffer::StagingBuffer(size_t size) noexcept {
+    constexpr GLbitfield FLAGS = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    if (GLAD_GL_ARB_buffer_storage) {
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glBufferStorage(GL_COPY_READ_BUFFER, size, nullptr, FLAGS);
+
+        void *mapped = glMapBufferRange(GL_COPY_READ_BUFFER, 0, size, FLAGS);
+
+        if (mapped != nullptr) {
+            _memory = {(uint8_t *)mapped, size};
+            return;
+        }
+
+        glDeleteBuffers(1, &buffer);
+        buffer = 0;
+    }
+
+    debug_log("persistent mapped staging buffer unavailable, using host memory");
+
+    host_memory.resize(size);
+    _memory = host_memory;
+}
+
+StagingBuffer::~StagingBuffer() {
+    for (const auto &[sync, bytes] : in_flight) glDeleteSync(sync);
+
+    // Deleting the buffer unmaps it
+    if (buffer != 0) glDeleteBuffers(1, &buffer);
+}
+
+void StagingBuffer::copy_to(VertexArray &vertex_array, size_t offset, size_t size, size_t dst_offset) {
+    if (size == 0) return;
+
+    if (persistent()) {
+        vertex_array.copy_sub_data(buffer, offset, dst_offset, size);
+    } else {
+        vertex_array.set_sub_data(dst_offset, _memory.subspan(offset, size));
+    }
+}
+
+void StagingBuffer::fence(size_t bytes) {
+    unfenced_bytes += bytes;
+
+    // glBufferSubData has already copied the data out of host memory
+    if (!persistent() || unfenced_bytes == 0) return;
+
+    in_flight.emplace_back(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), unfenced_bytes);
+    unfenced_bytes = 0;
+}
+
+size_t StagingBuffer::retire() {
+    if (!persistent()) return std::exchange(unfenced_bytes, 0);
+
+    size_t bytes = 0;
+
+    while (!in_flight.empty()) {
+        const auto [sync, fence_bytes] = in_flight.front();
+
+        const GLenum status = glClientWaitSync(sync, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+
+        glDeleteSync(sync);
+        bytes += fence_bytes;
+        in_flight.pop_front();
+    }
+
+    return bytes;
+}
@@ -0,0 +1,257 @@
+#include <render/terrain.h>
+#include <models/chunk.h>
+#include <config.h>
+#include <array>
+#include <tracy/Tracy.hpp>
+#include <format>
+
+using namespace render;
+
+static constexpr int RESOLUTION = config::FAR_TERRAIN_TILE_RESOLUTION;
+
+// Grid coordinates of two triangles per quad, from -1 to RESOLUTION + 1. Coordinates outside the tile are the bottoms
+// of skirts around its edges.
+static constexpr std::array<float, (RESOLUTION + 2) * (RESOLUTION + 2) * 6 * 2> build_grid_verts() {
+    std::array<float, (RESOLUTION + 2) * (RESOLUTION + 2) * 6 * 2> verts{};
+    constexpr std::array<int, 12> QUAD = {0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 0, 1};
+
+    unsigned int i = 0;
+    for (int z = -1; z <= RESOLUTION; z++) {
+        for (int x = -1; x <= RESOLUTION; x++) {
+            for (unsigned int v = 0; v < QUAD.size(); v += 2) {
+                verts[i++] = (float)(x + QUAD[v]);
+                verts[i++] = (float)(z + QUAD[v + 1]);
+            }
+        }
+    }
+
+    return verts;
+}
+
+static constexpr std::array<float, (RESOLUTION + 2) * (RESOLUTION + 2) * 6 * 2> GRID_VERTS = build_grid_verts();
+
+static constexpr GLsizei GRID_VERTEX_COUNT = GRID_VERTS.size() / 2;
+
+struct TileInstance {
+    float origin_x;
+    float origin_z;
+    float spacing;
+    float layer;
+};
+
+static const std::array<VertexArray::VertexAttribute, 2> TERRAIN_ATTRIBUTES = {{
+    // Grid position
+    {.type = GL_FLOAT, .index = 0, .size = 2, .stride = 2 * sizeof(float), .pointer = 0, .divisor = 0},
+
+    // Instanced tile origin, sample spacing and height texture layer
+    {.type = GL_FLOAT,
+     .index = 1,
+     .size = 4,
+     .stride = sizeof(TileInstance),
+     .pointer = (void *)(GRID_VERTS.size() * sizeof(float)),
+     .divisor = 1},
+}};
+
+static constexpr float CHUNK_WIDTH = (float)config::BLOCK_SIZE * models::RenderingChunk::X_SIZE;
+
+// The far terrain starts beyond the level of detail rings, so the near plane can be far away, which keeps depth
+// precision across the whole far range
+static constexpr float NEAR = CHUNK_WIDTH * config::LOD_RENDER_DISTANCE / 4;
+static constexpr float FAR =
+    1.5f * CHUNK_WIDTH * (config::FAR_TERRAIN_DISTANCE + (1 << (config::LOD_LEVELS + config::FAR_TERRAIN_LEVELS)));
+
+static const std::string vshader_src = std::format(R"(
+#version 400 core
+
+layout (location = 0) in vec2 gridPos;
+layout (location = 1) in vec4 tile;
+
+out vec3 baseColour;
+out float brightness;
+out float fog;
+
+uniform mat4 projview;
+uniform vec3 cameraPos;
+uniform sampler2DArray heights;
+
+const int RESOLUTION = {};
+const float BLOCK_SIZE = {};
+const float DIRT_HEIGHT = {};
+const float FOG_START = {};
+const float FOG_END = {};
+const vec3 SUN = vec3(0.4755282581475768, 0.8090169943749475, 0.3454915028125263);
+
+float heightAt(ivec2 pos, int layer) {{
+    return texelFetch(heights, ivec3(clamp(pos, ivec2(0), ivec2(RESOLUTION)), layer), 0).r;
+}}
+
+void main() {{
+    ivec2 grid = ivec2(gridPos);
+    ivec2 samplePos = clamp(grid, ivec2(0), ivec2(RESOLUTION));
+    int layer = int(tile.w);
+    float spacing = tile.z;
+
+    // Skirts hang one sample spacing below the edges, covering cracks against neighbouring levels
+    float height = heightAt(samplePos, layer);
+    float skirt = grid == samplePos ? 0.0 : spacing;
+    vec3 position = vec3(tile.x + samplePos.x * spacing, height * BLOCK_SIZE - skirt, tile.y + samplePos.y * spacing);
+
+    float dx = heightAt(samplePos + ivec2(1, 0), layer) - heightAt(samplePos - ivec2(1, 0), layer);
+    float dz = heightAt(samplePos + ivec2(0, 1), layer) - heightAt(samplePos - ivec2(0, 1), layer);
+    vec3 normal = normalize(vec3(-dx * BLOCK_SIZE, 2.0 * spacing, -dz * BLOCK_SIZE));
+
+    // Same lighting as full sky light on chunks
+    const float ambient = 0.6;
+    brightness = ambient + max(dot(normal, SUN), 0.0) / 2.5;
+    baseColour = height < DIRT_HEIGHT ? vec3(0.45, 0.32, 0.22) : vec3(0.5, 0.5, 0.5);
+    fog = clamp((distance(position.xz, cameraPos.xz) - FOG_START) / (FOG_END - FOG_START), 0.0, 1.0);
+
+    gl_Position = projview * vec4(position, 1.0);
+}}
+)",
+                                                   RESOLUTION, config::BLOCK_SIZE,
+                                                   config::DIRT_HEIGHT,
+                                                   0.5f * CHUNK_WIDTH * config::FAR_TERRAIN_DISTANCE,
+                                                   CHUNK_WIDTH * config::FAR_TERRAIN_DISTANCE);
+
+static const char *fshader_src = R"(
+#version 400 core
+
+in vec3 baseColour;
+in float brightness;
+in float fog;
+out vec4 colour;
+
+// The clear colour
+const vec3 SKY = vec3(0.4, 0.4, 0.7);
+
+void main() {
+    colour = vec4(mix(baseColour * brightness, SKY, fog), 1.0);
+}
+)";
+
+TerrainRenderer::TerrainRenderer() noexcept : vertex_array({}, {}, TERRAIN_ATTRIBUTES) {
+    // Load shaders
+    program = glCreateProgram();
+
+    GLuint vshader = glCreateShader(GL_VERTEX_SHADER);
+    const char *vshader_cs = vshader_src.c_str();
+    glShaderSource(vshader, 1, &vshader_cs, NULL);
+    glCompileShader(vshader);
+
+    GLuint fshader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fshader, 1, &fshader_src, NULL);
+    glCompileShader(fshader);
+
+    glAttachShader(program, vshader);
+    glAttachShader(program, fshader);
+    glLinkProgram(program);
+
+    glDeleteShader(vshader);
+    glDeleteShader(fshader);
+
+    projview_uniform = glGetUniformLocation(program, "projview");
+    camerapos_uniform = glGetUniformLocation(program, "cameraPos");
+
+    // Heights are on texture unit 1, leaving the block textures bound to unit 0
+    glProgramUniform1i(program, glGetUniformLocation(program, "heights"), 1);
+
+    glGenTextures(1, &height_texture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, height_texture);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+    glActiveTexture(GL_TEXTURE0);
+
+    // Add vertices
+    _vertex_data.insert(_vertex_data.end(), (uint8_t *)GRID_VERTS.data(),
+                        (uint8_t *)(GRID_VERTS.data() + GRID_VERTS.size()));
+
+    reset();
+}
+
+TerrainRenderer::~TerrainRenderer() {
+    glDeleteProgram(program);
+    glDeleteTextures(1, &height_texture);
+}
+
+void TerrainRenderer::reset() {
+    _vertex_data.resize(GRID_VERTS.size() * sizeof(float));
+    _heights.clear();
+    _tile_count = 0;
+}
+
+void TerrainRenderer::add_tile(unsigned int level, int tile_x, int tile_z, std::span<const float> heights) {
+    assert(heights.size() == (RESOLUTION + 1) * (RESOLUTION + 1));
+
+    const float tile_width = CHUNK_WIDTH * (float)(1 << level);
+
+    const TileInstance instance = {
+        .origin_x = tile_x * tile_width,
+        .origin_z = tile_z * tile_width,
+        .spacing = tile_width / RESOLUTION,
+        .layer = (float)_tile_count,
+    };
+
+    _vertex_data.insert(_vertex_data.end(), (uint8_t *)&instance, (uint8_t *)(&instance + 1));
+    _heights.insert(_heights.end(), heights.begin(), heights.end());
+    _tile_count++;
+}
+
+void TerrainRenderer::write_tiles() {
+    ZoneScopedN("TerrainRenderer::write_tiles");
+
+    vertex_array.set_data(_vertex_data);
+
+    if (_tile_count == 0) return;
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, height_texture);
+
+    // Grow the texture with some headroom, so moving around doesn't reallocate it every time
+    if (_tile_count > texture_layers) {
+        texture_layers = _tile_count + _tile_count / 2;
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R32F, RESOLUTION + 1, RESOLUTION + 1, texture_layers, 0, GL_RED,
+                     GL_FLOAT, nullptr);
+    }
+
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, RESOLUTION + 1, RESOLUTION + 1, _tile_count, GL_RED, GL_FLOAT,
+                    _heights.data());
+
+    glActiveTexture(GL_TEXTURE0);
+
+    TracyPlot("far_terrain_tiles_drawn", (int64_t)_tile_count);
+    TracyPlot("far_terrain_bytes", (int64_t)(_heights.size() * sizeof(float) + _vertex_data.size()));
+}
+
+void TerrainRenderer::render(const App &app) {
+    ZoneScopedN("TerrainRenderer::render");
+
+    if (_tile_count == 0) return;
+
+    float aspect_ratio = (float)app.width() / (float)app.height();
+    float half_near_height = NEAR * tanf(app.fov() / 2.0f);
+    float half_near_width = aspect_ratio * half_near_height;
+
+    auto projection = gfxm::Matrix<4, 4>::from_rowmajor({NEAR / half_near_width, 0, 0, 0.0f, 0, NEAR / half_near_height,
+                                                         0, 0.0f, 0, 0, -(FAR + NEAR) / (FAR - NEAR),
+                                                         -2.0f * NEAR * FAR / (FAR - NEAR), 0, 0, -1.0f, 0.0f});
+
+    auto projview = projection * app.camera().view();
+
+    glUseProgram(program);
+    glUniformMatrix4fv(projview_uniform, 1, GL_FALSE, projview.array().data());
+
+    const auto pos = app.camera().pos();
+    glUniform3f(camerapos_uniform, pos[0, 0], pos[1, 0], pos[2, 0]);
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, height_texture);
+    glActiveTexture(GL_TEXTURE0);
+
+    // Skirts are seen from both sides
+    glDisable(GL_CULL_FACE);
+    vertex_array.draw_arrays_instanced(GRID_VERTEX_COUNT, _tile_count);
+    glEnable(GL_CULL_FACE);
+}
@@ -0,0 +1,298 @@
+#include <render/texturearray.h>
+#include <render/image.h>
+#include <mgr/threadpool.h>
+#include <config.h>
+#include <debug.h>
+#include <tracy/Tracy.hpp>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <latch>
+#include <memory>
+#include <stdexcept>
+
+using namespace render;
+
+// The most mip levels to generate, including the full size image
+static constexpr unsigned int MAX_MIP_LEVELS = 4;
+
+static constexpr std::array<char, 4> CACHE_MAGIC = {'V', 'X', 'T', 'A'};
+static constexpr uint32_t CACHE_VERSION = 1;
+
+struct CacheHeader {
+    std::array<char, 4> magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t layers;
+    uint32_t mip_levels;
+};
+
+// A PNG the texture array was built from, used to tell when the cache is stale
+struct SourceFile {
+    std::string name;
+    uint64_t size;
+    int64_t modified;
+
+    bool operator==(const SourceFile &) const = default;
+};
+
+static unsigned int level_size(unsigned int size, unsigned int level) { return std::max(1u, size >> level); }
+
+// The mip levels generated for textures of the given size
+static unsigned int mip_level_count(unsigned int width, unsigned int height) {
+    return std::min<unsigned int>(MAX_MIP_LEVELS, std::bit_width(std::max(width, height)));
+}
+
+size_t TextureArrayImage::level_offset(unsigned int level) const {
+    size_t offset = 0;
+
+    for (unsigned int i = 0; i < level; i++) {
+        offset += (size_t)level_size(width, i) * level_size(height, i) * 3 * layers;
+    }
+
+    return offset;
+}
+
+// Finds the PNGs with the given names in a directory
+static std::vector<SourceFile> scan_sources(const std::string &dir, const std::vector<std::string> &names) {
+    std::vector<SourceFile> found;
+
+    for (const auto &entry : std::filesystem::directory_iterator(dir)) {
+        if (!entry.is_regular_file() || entry.path().extension() != ".png") continue;
+
+        found.push_back({.name = entry.path().stem().string(),
+                         .size = entry.file_size(),
+                         .modified = entry.last_write_time().time_since_epoch().count()});
+    }
+
+    std::vector<SourceFile> sources;
+
+    for (const std::string &name : names) {
+        auto it =
+            std::find_if(found.begin(), found.end(), [&name](const SourceFile &file) { return file.name == name; });
+
+        if (it == found.end()) {
+            throw std::runtime_error("texture not found: " + dir + "/" + name + ".png");
+        }
+
+        sources.push_back(*it);
+    }
+
+    return sources;
+}
+
+// Runs jobs on a pool and waits for them all, rethrowing the first exception thrown by any of them
+static void run_all(mgr::ThreadPool &pool, size_t count, const std::function<void(size_t)> &job) {
+    std::latch done{(std::ptrdiff_t)count};
+    std::vector<std::exception_ptr> errors(count);
+
+    for (size_t i = 0; i < count; i++) {
+        pool.enqueue([&, i] {
+            try {
+                job(i);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+
+            done.count_down();
+        });
+    }
+
+    done.wait();
+
+    for (const std::exception_ptr &error : errors) {
+        if (error) std::rethrow_exception(error);
+    }
+}
+
+// Averages each 2x2 block of pixels, repeating the last row or column of odd sized images
+static void downsample(const uint8_t *src, unsigned int width, unsigned int height, uint8_t *dst) {
+    const unsigned int dst_width = std::max(1u, width / 2);
+    const unsigned int dst_height = std::max(1u, height / 2);
+
+    for (unsigned int y = 0; y < dst_height; y++) {
+        const uint8_t *row0 = src + (size_t)std::min(2 * y, height - 1) * width * 3;
+        const uint8_t *row1 = src + (size_t)std::min(2 * y + 1, height - 1) * width * 3;
+
+        for (unsigned int x = 0; x < dst_width; x++) {
+            const unsigned int x0 = std::min(2 * x, width - 1) * 3;
+            const unsigned int x1 = std::min(2 * x + 1, width - 1) * 3;
+
+            for (unsigned int c = 0; c < 3; c++) {
+                const unsigned int sum = row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c];
+                *dst++ = (sum + 2) / 4;
+            }
+        }
+    }
+}
+
+static TextureArrayImage build(const std::string &dir, const std::vector<std::string> &names) {
+    ZoneScopedN("Build texture array");
+
+    if (names.empty()) throw std::runtime_error("no block textures");
+
+    // Headers are read first so every layer can be decoded straight into its place in the array
+    std::vector<std::unique_ptr<PngImage>> images;
+
+    for (const std::string &name : names) {
+        images.push_back(std::make_unique<PngImage>(dir + "/" + name + ".png"));
+
+        if (images.back()->width() != images[0]->width() || images.back()->height() != images[0]->height()) {
+            throw std::runtime_error("block texture " + name + " is a different size to the others");
+        }
+    }
+
+    TextureArrayImage image;
+    image.width = images[0]->width();
+    image.height = images[0]->height();
+    image.layers = names.size();
+    image.mip_levels = mip_level_count(image.width, image.height);
+    image.pixels.resize(image.level_offset(image.mip_levels));
+
+    // Each layer and its mip chain is independent, so layers are decoded and filtered in parallel
+    mgr::ThreadPool pool{std::min(config::mgr_thread_count(), names.size())};
+
+    run_all(pool, names.size(), [&](size_t layer) {
+        const size_t layer_bytes = images[layer]->rgb8_size();
+        images[layer]->decode_rgb8({image.pixels.data() + layer * layer_bytes, layer_bytes});
+
+        for (unsigned int level = 1; level < image.mip_levels; level++) {
+            const unsigned int width = level_size(image.width, level - 1);
+            const unsigned int height = level_size(image.height, level - 1);
+
+            const uint8_t *src = image.pixels.data() + image.level_offset(level - 1) + layer * width * height * 3;
+            uint8_t *dst = image.pixels.data() + image.level_offset(level) +
+                           layer * level_size(image.width, level) * level_size(image.height, level) * 3;
+
+            downsample(src, width, height, dst);
+        }
+    });
+
+    return image;
+}
+
+// Reads a cached texture array, or returns false if it is missing, corrupt or was built from different sources
+static bool read_cache(const std::string &path, const std::string &dir, const std::vector<SourceFile> &sources,
+                       TextureArrayImage &image) {
+    ZoneScopedN("Read texture array cache");
+
+    std::ifstream file{path, std::ios::in | std::ios::binary};
+    if (!file.good()) return false;
+
+    CacheHeader header;
+    if (!file.read((char *)&header, sizeof(header)) || header.magic != CACHE_MAGIC ||
+        header.version != CACHE_VERSION || header.layers != sources.size()) {
+        return false;
+    }
+
+    // The textures all have the size of the first, which is checked so a corrupt size is never allocated
+    const PngImage first{dir + "/" + sources[0].name + ".png"};
+    if (header.width == 0 || header.height == 0 || header.width != first.width() || header.height != first.height() ||
+        header.mip_levels != mip_level_count(header.width, header.height)) {
+        return false;
+    }
+
+    for (const SourceFile &source : sources) {
+        uint32_t name_size;
+        if (!file.read((char *)&name_size, sizeof(name_size)) || name_size != source.name.size()) return false;
+
+        SourceFile cached{.name = std::string(name_size, '\0')};
+        file.read(cached.name.data(), name_size);
+        file.read((char *)&cached.size, sizeof(cached.size));
+        file.read((char *)&cached.modified, sizeof(cached.modified));
+
+        if (!file || cached != source) return false;
+    }
+
+    image.width = header.width;
+    image.height = header.height;
+    image.layers = header.layers;
+    image.mip_levels = header.mip_levels;
+    image.pixels.resize(image.level_offset(image.mip_levels));
+
+    // The file must end exactly after the pixels
+    file.read((char *)image.pixels.data(), image.pixels.size());
+    return file && file.peek() == std::ifstream::traits_type::eof();
+}
+
+static void write_cache(const std::string &path, const std::vector<SourceFile> &sources,
+                        const TextureArrayImage &image) {
+    ZoneScopedN("Write texture array cache");
+
+    // Written to a temporary file first so an interrupted write never leaves a cache which looks valid
+    const std::string temp_path = path + ".tmp";
+
+    {
+        std::ofstream file{temp_path, std::ios::out | std::ios::binary | std::ios::trunc};
+
+        const CacheHeader header{.magic = CACHE_MAGIC,
+                                 .version = CACHE_VERSION,
+                                 .width = image.width,
+                                 .height = image.height,
+                                 .layers = image.layers,
+                                 .mip_levels = image.mip_levels};
+        file.write((const char *)&header, sizeof(header));
+
+        for (const SourceFile &source : sources) {
+            const uint32_t name_size = source.name.size();
+            file.write((const char *)&name_size, sizeof(name_size));
+            file.write(source.name.data(), name_size);
+            file.write((const char *)&source.size, sizeof(source.size));
+            file.write((const char *)&source.modified, sizeof(source.modified));
+        }
+
+        file.write((const char *)image.pixels.data(), image.pixels.size());
+
+        if (!file.good()) {
+            debug_log("error writing texture array cache");
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temp_path, path, error);
+    if (error) debug_log("error writing texture array cache");
+}
+
+TextureArrayImage render::load_texture_array(const std::string &dir, const std::vector<std::string> &names,
+                                             const std::string &cache_path) {
+    ZoneScopedN("Load texture array");
+
+    const std::vector<SourceFile> sources = scan_sources(dir, names);
+
+    TextureArrayImage image;
+    if (!sources.empty() && read_cache(cache_path, dir, sources, image)) return image;
+
+    image = build(dir, names);
+    write_cache(cache_path, sources, image);
+
+    return image;
+}
+
+GLuint render::create_texture_array(const TextureArrayImage &image) {
+    ZoneScopedN("Upload texture array");
+
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, image.mip_levels, GL_RGB8, image.width, image.height, image.layers);
+
+    // Rows of the smaller levels aren't 4 byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    for (unsigned int level = 0; level < image.mip_levels; level++) {
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, level_size(image.width, level),
+                        level_size(image.height, level), image.layers, GL_RGB, GL_UNSIGNED_BYTE,
+                        image.pixels.data() + image.level_offset(level));
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    return texture;
+}
@@ -26,4 +26,21 @@ VertexArray::VertexArray(std::span<const float> data, std::span<const INDICES_TY
     glGenBuffers(1, &this->ebo);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->ebo);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size_bytes(), indices.data(), GL_STATIC_DRAW);
-}
\ No newline at end of file
+}
+
+void VertexArray::grow(std::size_t old_size, std::size_t new_size) {
+    // Copy out through a temporary buffer, as reallocating the storage discards it. The buffer object stays the same,
+    // so the attributes don't need to be set again.
+    GLuint temp;
+    glGenBuffers(1, &temp);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, temp);
+    glBufferData(GL_COPY_WRITE_BUFFER, old_size, nullptr, GL_STREAM_COPY);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, this->vbo);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, old_size);
+
+    glBufferData(GL_COPY_READ_BUFFER, new_size, nullptr, GL_DYNAMIC_DRAW);
+    glCopyBufferSubData(GL_COPY_WRITE_BUFFER, GL_COPY_READ_BUFFER, 0, 0, old_size);
+
+    glDeleteBuffers(1, &temp);
+}
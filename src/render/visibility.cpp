@@ -0,0 +1,208 @@
+#include <render/visibility.h>
+#include <tracy/Tracy.hpp>
+#include <array>
+#include <algorithm>
+#include <utility>
+#include <assert.h>
+
+using namespace render;
+
+// The steps to the neighbouring chunk or voxel through each face
+static constexpr std::array<std::array<int, 3>, 6> FACE_STEPS = {{
+    {-1, 0, 0},
+    {1, 0, 0},
+    {0, -1, 0},
+    {0, 1, 0},
+    {0, 0, -1},
+    {0, 0, 1},
+}};
+
+// The bit of a pair of faces in a FaceConnectivity, where face_a < face_b
+static constexpr unsigned int pair_bit(unsigned int face_a, unsigned int face_b) {
+    return face_a * (11 - face_a) / 2 + (face_b - face_a - 1);
+}
+
+static_assert(pair_bit(4, 5) == 14, "the face pairs must fit in 15 bits");
+
+// Connects every pair of the faces in the mask
+static FaceConnectivity connect_faces(uint8_t faces) {
+    FaceConnectivity connectivity = 0;
+
+    for (unsigned int a = 0; a < 6; a++) {
+        if (!(faces & (1 << a))) continue;
+
+        for (unsigned int b = a + 1; b < 6; b++) {
+            if (faces & (1 << b)) connectivity |= 1 << pair_bit(a, b);
+        }
+    }
+
+    return connectivity;
+}
+
+bool render::faces_connected(FaceConnectivity connectivity, unsigned int face_a, unsigned int face_b) {
+    assert(face_a < 6 && face_b < 6);
+
+    if (face_a == face_b) return true;
+    if (face_a > face_b) std::swap(face_a, face_b);
+
+    return (connectivity >> pair_bit(face_a, face_b)) & 1;
+}
+
+template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
+FaceConnectivity render::chunk_face_connectivity(const models::Chunk<X_SIZE, Y_SIZE, Z_SIZE> &chunk) {
+    ZoneScopedN("chunk_face_connectivity");
+
+    constexpr unsigned int SIZE = X_SIZE * Y_SIZE * Z_SIZE;
+    constexpr std::array<int, 3> SIZES = {X_SIZE, Y_SIZE, Z_SIZE};
+
+    std::array<bool, SIZE> visited{};
+
+    // Kept by each thread, as chunks are meshed constantly
+    thread_local std::vector<unsigned int> stack;
+    stack.clear();
+
+    FaceConnectivity connectivity = 0;
+
+    for (unsigned int start = 0; start < SIZE && connectivity != ALL_FACES_CONNECTED; start++) {
+        if (visited[start] || chunk.block_at(start).opaque()) continue;
+
+        // The faces touched by this region of connected voxels
+        uint8_t faces = 0;
+
+        visited[start] = true;
+        stack.push_back(start);
+
+        while (!stack.empty()) {
+            const unsigned int i = stack.back();
+            stack.pop_back();
+
+            const std::array<int, 3> pos = {(int)(i % X_SIZE), (int)(i / X_SIZE % Y_SIZE),
+                                            (int)(i / (X_SIZE * Y_SIZE))};
+
+            for (unsigned int face = 0; face < 6; face++) {
+                const auto &step = FACE_STEPS[face];
+                const int x = pos[0] + step[0];
+                const int y = pos[1] + step[1];
+                const int z = pos[2] + step[2];
+
+                const unsigned int axis = face / 2;
+                const int along = axis == 0 ? x : (axis == 1 ? y : z);
+
+                if (along < 0 || along >= SIZES[axis]) {
+                    faces |= 1 << face;
+                    continue;
+                }
+
+                const unsigned int j = x + y * X_SIZE + z * X_SIZE * Y_SIZE;
+                if (visited[j] || chunk.block_at(j).opaque()) continue;
+
+                visited[j] = true;
+                stack.push_back(j);
+            }
+        }
+
+        connectivity |= connect_faces(faces);
+    }
+
+    return connectivity;
+}
+
+template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
+uint16_t render::chunk_solid_height(const models::Chunk<X_SIZE, Y_SIZE, Z_SIZE> &chunk) {
+    for (unsigned int y = 0; y < Y_SIZE; y++) {
+        for (unsigned int z = 0; z < Z_SIZE; z++) {
+            for (unsigned int x = 0; x < X_SIZE; x++) {
+                if (!chunk[x, y, z].opaque()) return y;
+            }
+        }
+    }
+
+    return Y_SIZE;
+}
+
+ChunkVisibility::ChunkVisibility(int camera_chunk_x, int camera_chunk_y, int camera_chunk_z, int radius)
+    : centre_x(camera_chunk_x),
+      centre_y(camera_chunk_y),
+      centre_z(camera_chunk_z),
+      radius(radius),
+      side(2 * radius + 1),
+      connectivity((size_t)side * side * side, ALL_FACES_CONNECTED),
+      entered((size_t)side * side * side, 0) {}
+
+int ChunkVisibility::index(int chunk_x, int chunk_y, int chunk_z) const {
+    const int dx = chunk_x - centre_x + radius;
+    const int dy = chunk_y - centre_y + radius;
+    const int dz = chunk_z - centre_z + radius;
+
+    if (dx < 0 || dx >= side || dy < 0 || dy >= side || dz < 0 || dz >= side) return -1;
+
+    return dx + dy * side + dz * side * side;
+}
+
+void ChunkVisibility::set_connectivity(int chunk_x, int chunk_y, int chunk_z, FaceConnectivity faces) {
+    const int i = index(chunk_x, chunk_y, chunk_z);
+    if (i >= 0) connectivity[i] = faces;
+}
+
+void ChunkVisibility::update() {
+    ZoneScopedN("ChunkVisibility::update");
+
+    struct Step {
+        int x;
+        int y;
+        int z;
+
+        // The face the chunk was entered through, or -1 for the camera chunk
+        int entry_face;
+
+        // The directions moved in to reach the chunk, as a mask of faces
+        uint8_t directions;
+    };
+
+    std::fill(entered.begin(), entered.end(), 0);
+
+    std::vector<Step> queue;
+    queue.push_back({.x = centre_x, .y = centre_y, .z = centre_z, .entry_face = -1, .directions = 0});
+    entered[index(centre_x, centre_y, centre_z)] = 0x3F;
+    _visible_count = 1;
+
+    // Breadth first, so each chunk is reached along one of the straightest paths to it
+    for (size_t head = 0; head < queue.size(); head++) {
+        const Step step = queue[head];
+        const FaceConnectivity faces = connectivity[index(step.x, step.y, step.z)];
+
+        for (unsigned int face = 0; face < 6; face++) {
+            // Never turn back towards the camera
+            if (step.directions & (1 << (face ^ 1))) continue;
+
+            // The camera can see out of its own chunk in every direction
+            if (step.entry_face >= 0 && !faces_connected(faces, step.entry_face, face)) continue;
+
+            const auto &offset = FACE_STEPS[face];
+            const int x = step.x + offset[0];
+            const int y = step.y + offset[1];
+            const int z = step.z + offset[2];
+
+            // A chunk is walked again when entered through another face, as that can connect to other faces
+            const int i = index(x, y, z);
+            if (i < 0 || (entered[i] & (1 << (face ^ 1)))) continue;
+
+            if (entered[i] == 0) _visible_count++;
+            entered[i] |= 1 << (face ^ 1);
+
+            queue.push_back({.x = x,
+                             .y = y,
+                             .z = z,
+                             .entry_face = (int)(face ^ 1),
+                             .directions = (uint8_t)(step.directions | (1 << face))});
+        }
+    }
+}
+
+bool ChunkVisibility::is_visible(int chunk_x, int chunk_y, int chunk_z) const {
+    const int i = index(chunk_x, chunk_y, chunk_z);
+    return i < 0 || entered[i] != 0;
+}
+
+template FaceConnectivity render::chunk_face_connectivity(const models::RenderingChunk &chunk);
+template uint16_t render::chunk_solid_height(const models::RenderingChunk &chunk);
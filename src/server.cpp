@@ -0,0 +1,173 @@
+#include <iostream>
+#include <charconv>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <string>
+#include <vector>
+#include <config.h>
+#include <mgr/manager.h>
+#include <models/blockregistry.h>
+#include <server/bots.h>
+#include <server/clients.h>
+#include <tracy/Tracy.hpp>
+
+// A dedicated server, which generates and lights the chunks around connected clients and bots without a window or GL.
+
+// Ids of the interest points of clients start here, and those of bots after them
+static constexpr uint64_t FIRST_CLIENT_ID = 1;
+static constexpr uint64_t FIRST_BOT_ID = uint64_t{1} << 62;
+
+static volatile std::sig_atomic_t should_stop = 0;
+
+static void handle_stop_signal(int) { should_stop = 1; }
+
+struct ServerOptions {
+    uint16_t port = config::SERVER_PORT;
+    unsigned int bots = 0;
+    float bot_spread = 64.0f;
+    uint32_t seed = 0;
+    bool seed_given = false;
+};
+
+// Parses the value of an option, which must be a whole integer from min to max
+static unsigned long parse_integer(const char *option, const char *value, unsigned long min, unsigned long max) {
+    const char *end = value + std::strlen(value);
+
+    unsigned long result;
+    const auto [parsed_end, error] = std::from_chars(value, end, result);
+
+    if (error != std::errc() || parsed_end != end || result < min || result > max) {
+        throw std::invalid_argument(std::format("{} must be an integer from {} to {}, not {}", option, min, max, value));
+    }
+
+    return result;
+}
+
+// Parses the value of an option, which must be a finite number from min to max
+static float parse_float(const char *option, const char *value, float min, float max) {
+    const char *end = value + std::strlen(value);
+
+    float result;
+    const auto [parsed_end, error] = std::from_chars(value, end, result);
+
+    if (error != std::errc() || parsed_end != end || !std::isfinite(result) || result < min || result > max) {
+        throw std::invalid_argument(std::format("{} must be a number from {} to {}, not {}", option, min, max, value));
+    }
+
+    return result;
+}
+
+static ServerOptions parse_options(int argc, char **argv) {
+    ServerOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (std::strcmp(argv[i], "--port") == 0 && value) {
+            options.port = parse_integer(argv[i], value, 1, UINT16_MAX);
+        } else if (std::strcmp(argv[i], "--bots") == 0 && value) {
+            options.bots = parse_integer(argv[i], value, 0, UINT_MAX);
+        } else if (std::strcmp(argv[i], "--bot-spread") == 0 && value) {
+            // Bots must start inside the world
+            options.bot_spread = parse_float(argv[i], value, 0.0f, (float)config::MAX_CHUNK_X);
+        } else if (std::strcmp(argv[i], "--seed") == 0 && value) {
+            options.seed = parse_integer(argv[i], value, 0, UINT32_MAX);
+            options.seed_given = true;
+        } else {
+            throw std::invalid_argument(std::string("unknown option: ") + argv[i] +
+                                        "\nusage: voxel_server [--port N] [--bots N] [--bot-spread CHUNKS] [--seed N]");
+        }
+
+        i++;
+    }
+
+    return options;
+}
+
+int main(int argc, char **argv) {
+    ServerOptions options;
+
+    try {
+        options = parse_options(argc, argv);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    models::set_block_registry(models::BlockRegistry::load("../assets/blocks.txt"));
+
+    const uint32_t worldgen_seed =
+        options.seed_given ? options.seed
+                           : std::chrono::duration_cast<std::chrono::milliseconds>(
+                                 std::chrono::steady_clock::now().time_since_epoch())
+                                 .count();
+
+    std::cout << "worldgen seed: " << worldgen_seed << std::endl;
+
+    std::signal(SIGINT, handle_stop_signal);
+    std::signal(SIGTERM, handle_stop_signal);
+
+    // Chunks are only generated and lit, never meshed
+    mgr::Manager manager{worldgen_seed};
+
+    server::ClientListener clients{options.port, FIRST_CLIENT_ID};
+    server::BotSwarm bots{options.bots, worldgen_seed, options.bot_spread, FIRST_BOT_ID};
+
+    std::cout << "listening on 127.0.0.1:" << options.port << " with " << bots.size() << " bots" << std::endl;
+
+    std::vector<mgr::InterestPoint> interest_points;
+
+    auto report_start = std::chrono::steady_clock::now();
+    uint64_t report_chunks_loaded = 0;
+
+    auto last_tick = std::chrono::steady_clock::now();
+
+    while (!should_stop) {
+        const auto tick_start = std::chrono::steady_clock::now();
+        const auto wake_time = tick_start + config::SERVER_TICK_DURATION;
+
+        clients.poll();
+        bots.step(std::chrono::duration<float>(tick_start - last_tick).count());
+        last_tick = tick_start;
+
+        interest_points.clear();
+        clients.interest_points(interest_points, config::SERVER_LOAD_DISTANCE);
+        bots.interest_points(interest_points, config::SERVER_LOAD_DISTANCE);
+
+        const size_t interest_point_count = interest_points.size();
+        manager.set_interest_points(std::move(interest_points));
+        interest_points = {};
+
+        const float report_seconds = std::chrono::duration<float>(tick_start - report_start).count();
+
+        if (report_seconds >= 1.0f) {
+            // Chunks are generated and lit for clients, but not sent to them yet
+            const uint64_t chunks_loaded = manager.chunk_store().chunks_loaded();
+            const float chunks_per_second = (chunks_loaded - report_chunks_loaded) / report_seconds;
+            const mgr::ManagerTickStats tick_stats = manager.take_tick_stats();
+
+            TracyPlot("server_chunks_generated_per_sec", chunks_per_second);
+
+            std::cout << std::format(
+                             "tick {:.2f} ms avg, {:.2f} ms max | {} clients, {} interest points | {:.0f} chunks/s "
+                             "generated, {} jobs queued",
+                             tick_stats.ticks > 0 ? tick_stats.total_ms / tick_stats.ticks : 0.0f, tick_stats.max_ms,
+                             clients.client_count(), interest_point_count, chunks_per_second, manager.queued_jobs())
+                      << std::endl;
+
+            report_start = tick_start;
+            report_chunks_loaded = chunks_loaded;
+        }
+
+        std::this_thread::sleep_until(wake_time);
+    }
+
+    std::cout << "stopping" << std::endl;
+
+    return 0;
+}
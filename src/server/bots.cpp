@@ -0,0 +1,55 @@
+#include <server/bots.h>
+#include <gfxm/constants.h>
+#include <cmath>
+
+using namespace server;
+
+// How fast the bots walk, in chunks per second
+static constexpr float BOT_SPEED = 1.0f;
+
+// The longest a bot walks before turning, in seconds
+static constexpr float BOT_MAX_TURN_SECONDS = 10.0f;
+
+// The chunk layer of the surface, where the bots walk
+static constexpr int BOT_CHUNK_Y = 0;
+
+BotSwarm::BotSwarm(unsigned int count, uint32_t seed, float spread, uint64_t first_id)
+    : rng(seed), first_id(first_id) {
+    std::uniform_real_distribution<float> start(-spread, spread);
+
+    bots.resize(count);
+
+    for (Bot& bot : bots) {
+        bot.x = start(rng);
+        bot.z = start(rng);
+        turn(bot);
+    }
+}
+
+void BotSwarm::turn(Bot& bot) {
+    const float angle = std::uniform_real_distribution<float>(0.0f, 2.0f * gfxm::PI_F)(rng);
+
+    bot.dx = std::cos(angle) * BOT_SPEED;
+    bot.dz = std::sin(angle) * BOT_SPEED;
+    bot.seconds_to_turn = std::uniform_real_distribution<float>(0.0f, BOT_MAX_TURN_SECONDS)(rng);
+}
+
+void BotSwarm::step(float seconds) {
+    for (Bot& bot : bots) {
+        bot.x += bot.dx * seconds;
+        bot.z += bot.dz * seconds;
+
+        bot.seconds_to_turn -= seconds;
+        if (bot.seconds_to_turn <= 0) turn(bot);
+    }
+}
+
+void BotSwarm::interest_points(std::vector<mgr::InterestPoint>& out, int radius) const {
+    for (size_t i = 0; i < bots.size(); i++) {
+        out.push_back({.id = first_id + i,
+                       .chunk_x = (int)std::floor(bots[i].x),
+                       .chunk_y = BOT_CHUNK_Y,
+                       .chunk_z = (int)std::floor(bots[i].z),
+                       .radius = radius});
+    }
+}
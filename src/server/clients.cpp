@@ -0,0 +1,125 @@
+#include <server/clients.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <system_error>
+#include <tuple>
+#include <config.h>
+
+using namespace server;
+
+// Longer lines than this can't be positions, so the client is dropped rather than buffering forever
+static constexpr size_t MAX_LINE_LENGTH = 64;
+
+// Parses "chunk_x chunk_y chunk_z", which must be a chunk inside the world
+static std::optional<mgr::SharedStateView> parse_position(std::string_view line) {
+    mgr::SharedStateView position;
+    const char* it = line.data();
+    const char* end = line.data() + line.size();
+
+    const std::array<std::tuple<int*, int, int>, 3> coords = {{
+        {&position.chunk_x, config::MIN_CHUNK_X, config::MAX_CHUNK_X},
+        {&position.chunk_y, config::MIN_CHUNK_Y, config::MAX_CHUNK_Y},
+        {&position.chunk_z, config::MIN_CHUNK_Z, config::MAX_CHUNK_Z},
+    }};
+
+    for (const auto& [coord, min, max] : coords) {
+        while (it != end && *it == ' ') it++;
+
+        auto [next, error] = std::from_chars(it, end, *coord);
+        if (error != std::errc() || *coord < min || *coord > max) return std::nullopt;
+
+        it = next;
+    }
+
+    while (it != end && (*it == ' ' || *it == '\r')) it++;
+    if (it != end) return std::nullopt;
+
+    return position;
+}
+
+ClientListener::ClientListener(uint16_t port, uint64_t first_id) : next_id(first_id) {
+    listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0) throw std::system_error(errno, std::generic_category(), "socket");
+
+    const int reuse = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (bind(listen_fd, (const sockaddr*)&address, sizeof(address)) != 0 || listen(listen_fd, SOMAXCONN) != 0) {
+        const int error = errno;
+        close(listen_fd);
+        throw std::system_error(error, std::generic_category(), "listening on port " + std::to_string(port));
+    }
+}
+
+ClientListener::~ClientListener() {
+    for (const Client& client : clients) close(client.fd);
+    close(listen_fd);
+}
+
+bool ClientListener::read_client(Client& client) {
+    char data[4096];
+
+    while (true) {
+        const ssize_t received = recv(client.fd, data, sizeof(data), 0);
+
+        if (received == 0) return false;
+
+        if (received < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+
+        client.buffer.append(data, received);
+
+        size_t line_start = 0;
+        for (size_t newline; (newline = client.buffer.find('\n', line_start)) != std::string::npos;) {
+            auto position = parse_position(std::string_view(client.buffer).substr(line_start, newline - line_start));
+            if (!position) return false;
+
+            client.position = position;
+            line_start = newline + 1;
+        }
+
+        client.buffer.erase(0, line_start);
+        if (client.buffer.size() > MAX_LINE_LENGTH) return false;
+    }
+}
+
+void ClientListener::poll() {
+    while (true) {
+        const int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) break;
+
+        clients.push_back({.id = next_id++, .fd = fd, .buffer = {}, .position = std::nullopt});
+    }
+
+    std::erase_if(clients, [](Client& client) {
+        if (read_client(client)) return false;
+
+        close(client.fd);
+        return true;
+    });
+}
+
+void ClientListener::interest_points(std::vector<mgr::InterestPoint>& out, int radius) const {
+    for (const Client& client : clients) {
+        if (!client.position) continue;
+
+        out.push_back({.id = client.id,
+                       .chunk_x = client.position->chunk_x,
+                       .chunk_y = client.position->chunk_y,
+                       .chunk_z = client.position->chunk_z,
+                       .radius = radius});
+    }
+}
@@ -3,6 +3,9 @@
 #include <iostream>
 #include <config.h>
 #include <numeric>
+#include <array>
+#include <cmath>
+#include <vector>
 #include <models/block.h>
 
 using namespace worldgen;
@@ -21,36 +24,70 @@ ChunkGenerator<X_SIZE, Y_SIZE, Z_SIZE>::ChunkGenerator(uint32_t _seed) noexcept
 
 template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
 void ChunkGenerator<X_SIZE, Y_SIZE, Z_SIZE>::generate(models::Chunk<X_SIZE, Y_SIZE, Z_SIZE> &chunk, int chunk_x,
-                                                      int chunk_y, int chunk_z) const {
+                                                      int chunk_y, int chunk_z,
+                                                      std::span<int> surface_heights) const {
     assert(chunk_x <= config::MAX_CHUNK_X && chunk_x >= config::MIN_CHUNK_X);
     assert(chunk_y <= config::MAX_CHUNK_Y && chunk_y >= config::MIN_CHUNK_Y);
     assert(chunk_z <= config::MAX_CHUNK_Z && chunk_z >= config::MIN_CHUNK_Z);
 
+    generate_lod(chunk, chunk_x, chunk_y, chunk_z, 0, surface_heights);
+}
+
+template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
+void ChunkGenerator<X_SIZE, Y_SIZE, Z_SIZE>::generate_lod(models::Chunk<X_SIZE, Y_SIZE, Z_SIZE> &chunk, int node_x,
+                                                          int node_y, int node_z, unsigned int level,
+                                                          std::span<int> surface_heights) const {
     // TODO either create a new chunk or clear the existing one?
+    assert(surface_heights.empty() || surface_heights.size() == static_cast<size_t>(X_SIZE) * Z_SIZE);
 
-    models::Block block = models::Block(models::STONE_BLOCK);
-    if (chunk_y < config::MIN_CHUNK_Y + 2) {
-        block = models::Block(models::DIRT_BLOCK);
-    }
+    const int scale = 1 << level;
 
-    std::vector<float> noise(static_cast<size_t>(X_SIZE) * Z_SIZE);
-    fbm_generator->GenUniformGrid2D(noise.data(), chunk_x * X_SIZE, chunk_z * Z_SIZE, X_SIZE, Z_SIZE, 0.005f, seed);
+    // Sample the heightmap at the corner of each voxel column
+    std::array<float, static_cast<size_t>(X_SIZE) * Z_SIZE> noise;
+    fbm_generator->GenUniformGrid2D(noise.data(), node_x * X_SIZE, node_z * Z_SIZE, X_SIZE, Z_SIZE, 0.005f * scale,
+                                    seed);
 
-    const float max_height = (float)config::MAX_CHUNK_Y * Y_SIZE;
-    const float min_height = (float)config::MIN_CHUNK_Y * Y_SIZE;
+    const float max_height = (float)config::MAX_TERRAIN_HEIGHT;
+    const float min_height = (float)config::MIN_TERRAIN_HEIGHT;
+
+    // The world block y of the bottom of the node
+    const int origin_y = node_y * Y_SIZE * scale;
 
     for (int z = 0; z < Z_SIZE; z++) {
         for (int x = 0; x < X_SIZE; x++) {
             float sample = noise[static_cast<size_t>(x) + static_cast<size_t>(z) * X_SIZE];
             float height = std::lerp(min_height, max_height, (sample + 1.0f) / 2.0f);
 
-            int height_here = (int)std::floor(height) - chunk_y * Y_SIZE;
+            if (!surface_heights.empty()) {
+                surface_heights[static_cast<size_t>(x) + static_cast<size_t>(z) * X_SIZE] = (int)std::floor(height);
+            }
+
+            // A voxel is filled if the block at its centre is below the surface
+            int height_here = (int)std::floor(height) - origin_y - scale / 2;
 
-            for (int y = 0; y < height_here && y < Y_SIZE; y++) {
-                chunk[x, y, z] = block;
+            for (int y = 0; y * scale < height_here && y < Y_SIZE; y++) {
+                chunk[x, y, z] = models::Block(origin_y + y * scale < config::DIRT_HEIGHT ? models::DIRT_BLOCK
+                                                                                           : models::STONE_BLOCK);
             }
         }
     }
 }
 
-template class ChunkGenerator<16, 16, 16>;
+template <unsigned short X_SIZE, unsigned short Y_SIZE, unsigned short Z_SIZE>
+void ChunkGenerator<X_SIZE, Y_SIZE, Z_SIZE>::generate_heightmap(float *heights, int block_x, int block_z,
+                                                                unsigned int size, unsigned int step) const {
+    assert(block_x % (int)step == 0 && block_z % (int)step == 0);
+
+    // Same frequency per block as generate_lod, so the far terrain lines up with the voxels
+    fbm_generator->GenUniformGrid2D(heights, block_x / (int)step, block_z / (int)step, size, size, 0.005f * step, seed);
+
+    const float max_height = (float)config::MAX_TERRAIN_HEIGHT;
+    const float min_height = (float)config::MIN_TERRAIN_HEIGHT;
+
+    for (unsigned int i = 0; i < size * size; i++) {
+        heights[i] = std::lerp(min_height, max_height, (heights[i] + 1.0f) / 2.0f);
+    }
+}
+
+template class ChunkGenerator<models::RenderingChunk::X_SIZE, models::RenderingChunk::Y_SIZE,
+                              models::RenderingChunk::Z_SIZE>;
@@ -0,0 +1,57 @@
+#include "test.h"
+#include <models/blockregistry.h>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+using namespace models;
+
+// Writes a block file to a temporary path and returns the path
+static std::string write_blocks(const std::string& file_name, const std::string& contents) {
+    const std::string path = (std::filesystem::temp_directory_path() / file_name).string();
+    std::ofstream{path} << contents;
+    return path;
+}
+
+TEST(registry_loads_many_blocks) {
+    constexpr unsigned int BLOCKS = 5000;
+    constexpr unsigned int TEXTURES = 1000;
+
+    std::string contents = "stone 1 0 1 stone\ndirt 1 0 1 grass dirt dirt_side\n";
+    for (unsigned int i = 0; i < BLOCKS; i++) {
+        contents += "block" + std::to_string(i) + " 1 0 1 texture" + std::to_string(i % TEXTURES) + "\n";
+    }
+
+    const std::string path = write_blocks("voxel_tests_many_blocks.txt", contents);
+    const BlockRegistry registry = BlockRegistry::load(path);
+    std::filesystem::remove(path);
+
+    CHECK(registry.size() == 3 + BLOCKS);
+    CHECK(registry.find("stone") == STONE_BLOCK);
+    CHECK(registry.find("block4999") == 3 + 4999);
+    CHECK(registry.find("missing") == EMPTY_BLOCK);
+
+    // Textures are shared by every block using them, with layers in the order they are first used, by face
+    CHECK(registry.texture_names().size() == 4 + TEXTURES);
+    CHECK(registry.face_texture(DIRT_BLOCK, 0) == 1);
+    CHECK(registry.face_texture(DIRT_BLOCK, 5) == 3);
+    CHECK(registry.face_texture(DIRT_BLOCK, 4) == 2);
+    CHECK(registry.face_texture(3 + 7, 0) == registry.face_texture(3 + 7 + TEXTURES, 0));
+    CHECK(registry.texture_names()[registry.face_texture(3 + 7, 0)] == "texture7");
+}
+
+TEST(registry_rejects_duplicate_blocks) {
+    const std::string path =
+        write_blocks("voxel_tests_duplicate_blocks.txt", "stone 1 0 1 stone\ndirt 1 0 1 dirt\nstone 1 0 1 stone\n");
+
+    bool threw = false;
+    try {
+        BlockRegistry::load(path);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+
+    std::filesystem::remove(path);
+    CHECK(threw);
+}
@@ -0,0 +1,258 @@
+#include "test.h"
+#include <net/chunkcodec.h>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+using namespace net;
+using models::RenderingChunk;
+
+constexpr unsigned int X_SIZE = RenderingChunk::X_SIZE;
+constexpr unsigned int Y_SIZE = RenderingChunk::Y_SIZE;
+constexpr unsigned int Z_SIZE = RenderingChunk::Z_SIZE;
+constexpr unsigned int CHUNK_BLOCKS = X_SIZE * Y_SIZE * Z_SIZE;
+
+constexpr size_t MAX_CHUNK_SIZE = max_encoded_chunk_size<X_SIZE, Y_SIZE, Z_SIZE>();
+
+// Repeatable pseudo random numbers
+static uint32_t next_random(uint32_t& state) {
+    state = state * 1664525 + 1013904223;
+    return state >> 8;
+}
+
+// Layered ground with scattered blocks of many types, so there are both long and short runs
+static std::unique_ptr<RenderingChunk> test_chunk() {
+    auto chunk = std::make_unique<RenderingChunk>();
+    uint32_t random = 1;
+
+    for (unsigned int i = 0; i < CHUNK_BLOCKS; i++) {
+        const unsigned int y = i / X_SIZE % Y_SIZE;
+        models::BlockId block = y < Y_SIZE / 4 ? models::STONE_BLOCK
+                                : y < Y_SIZE / 2 ? models::DIRT_BLOCK
+                                                 : models::EMPTY_BLOCK;
+        if (next_random(random) % 8 == 0) block = next_random(random) % 300;
+
+        chunk->block_at(i) = block;
+    }
+
+    return chunk;
+}
+
+static bool same_blocks(const RenderingChunk& a, const RenderingChunk& b) {
+    for (unsigned int i = 0; i < CHUNK_BLOCKS; i++) {
+        if (a.block_at(i).id() != b.block_at(i).id()) return false;
+    }
+
+    return true;
+}
+
+TEST(chunk_round_trips) {
+    const auto chunk = test_chunk();
+    std::vector<uint8_t> buffer(MAX_CHUNK_SIZE);
+    const size_t size = encode_chunk(*chunk, -3, 70000, -1, buffer);
+
+    CHECK(size <= MAX_CHUNK_SIZE);
+    CHECK(buffer[0] == (uint8_t)RecordType::CHUNK);
+
+    // Into a chunk with other blocks in it, as pooled chunks are reused as they are
+    auto decoded = test_chunk();
+    for (unsigned int i = 0; i < CHUNK_BLOCKS; i++) decoded->block_at(i) = models::STONE_BLOCK;
+
+    int chunk_x, chunk_y, chunk_z;
+    CHECK(decode_chunk(std::span<const uint8_t>(buffer.data(), size), *decoded, chunk_x, chunk_y, chunk_z) == size);
+    CHECK(chunk_x == -3 && chunk_y == 70000 && chunk_z == -1);
+    CHECK(same_blocks(*chunk, *decoded));
+}
+
+TEST(chunk_of_all_distinct_blocks_round_trips) {
+    auto chunk = std::make_unique<RenderingChunk>();
+    for (unsigned int i = 0; i < CHUNK_BLOCKS; i++) chunk->block_at(i) = (models::BlockId)i;
+
+    std::vector<uint8_t> buffer(MAX_CHUNK_SIZE);
+    const size_t size = encode_chunk(*chunk, 0, 0, 0, buffer);
+    CHECK(size <= MAX_CHUNK_SIZE);
+
+    auto decoded = test_chunk();
+    int chunk_x, chunk_y, chunk_z;
+    decode_chunk(std::span<const uint8_t>(buffer.data(), size), *decoded, chunk_x, chunk_y, chunk_z);
+    CHECK(same_blocks(*chunk, *decoded));
+}
+
+TEST(uniform_chunk_is_small) {
+    const auto chunk = std::make_unique<RenderingChunk>();
+    std::vector<uint8_t> buffer(MAX_CHUNK_SIZE);
+    const size_t size = encode_chunk(*chunk, 0, 0, 0, buffer);
+
+    // A header, one palette entry and one run
+    CHECK(size < 16);
+
+    auto decoded = test_chunk();
+    int chunk_x, chunk_y, chunk_z;
+    CHECK(decode_chunk(std::span<const uint8_t>(buffer.data(), size), *decoded, chunk_x, chunk_y, chunk_z) == size);
+    CHECK(same_blocks(*chunk, *decoded));
+}
+
+TEST(every_truncated_chunk_throws) {
+    const auto chunk = test_chunk();
+    std::vector<uint8_t> buffer(MAX_CHUNK_SIZE);
+    const size_t size = encode_chunk(*chunk, 5, -6, 7, buffer);
+
+    auto decoded = std::make_unique<RenderingChunk>();
+    int chunk_x, chunk_y, chunk_z;
+
+    for (size_t length = 0; length < size; length++) {
+        bool threw = false;
+
+        try {
+            decode_chunk(std::span<const uint8_t>(buffer.data(), length), *decoded, chunk_x, chunk_y, chunk_z);
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+
+        CHECK(threw);
+    }
+}
+
+TEST(wrong_record_type_throws) {
+    const auto chunk = test_chunk();
+    std::vector<uint8_t> buffer(MAX_CHUNK_SIZE);
+    const size_t size = encode_chunk(*chunk, 0, 0, 0, buffer);
+    buffer[0] = (uint8_t)RecordType::BLOCK_EDITS;
+
+    int chunk_x, chunk_y, chunk_z;
+    bool threw = false;
+
+    try {
+        decode_chunk(std::span<const uint8_t>(buffer.data(), size), *chunk, chunk_x, chunk_y, chunk_z);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+
+    CHECK(threw);
+}
+
+// Reads every edit of a record
+static std::vector<BlockEdit> read_edits(BlockEditReader& reader) {
+    std::vector<BlockEdit> edits;
+    BlockEdit edit;
+    while (reader.next(edit)) edits.push_back(edit);
+    return edits;
+}
+
+TEST(block_edits_round_trip_sorted_with_last_edit_kept) {
+    std::vector<BlockEdit> edits = {{.index = 40, .block = 2}, {.index = 3, .block = 1}, {.index = 40, .block = 7},
+                                    {.index = CHUNK_BLOCKS - 1, .block = 300}, {.index = 0, .block = 0}};
+    std::vector<uint8_t> buffer(max_encoded_block_edits_size(edits.size()));
+    const size_t size = encode_block_edits(-1, 2, -3, edits, buffer);
+
+    BlockEditReader reader(std::span<const uint8_t>(buffer.data(), size), CHUNK_BLOCKS);
+    CHECK(reader.chunk_x == -1 && reader.chunk_y == 2 && reader.chunk_z == -3);
+
+    const std::vector<BlockEdit> read = read_edits(reader);
+    CHECK(reader.bytes_read() == size);
+    CHECK(read.size() == 4);
+
+    if (read.size() == 4) {
+        CHECK(read[0].index == 0 && read[0].block == 0);
+        CHECK(read[1].index == 3 && read[1].block == 1);
+        CHECK(read[2].index == 40 && read[2].block == 7);
+        CHECK(read[3].index == CHUNK_BLOCKS - 1 && read[3].block == 300);
+    }
+}
+
+TEST(every_truncated_block_edit_record_throws) {
+    std::vector<BlockEdit> edits = {{.index = 1, .block = 1}, {.index = 500, .block = 200}, {.index = 2, .block = 2}};
+    std::vector<uint8_t> buffer(max_encoded_block_edits_size(edits.size()));
+    const size_t size = encode_block_edits(100, -100, 0, edits, buffer);
+
+    for (size_t length = 0; length < size; length++) {
+        bool threw = false;
+
+        try {
+            BlockEditReader reader(std::span<const uint8_t>(buffer.data(), length), CHUNK_BLOCKS);
+            read_edits(reader);
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+
+        CHECK(threw);
+    }
+}
+
+// Whether reading every edit of a record throws
+static bool reading_edits_throws(std::span<const uint8_t> record) {
+    try {
+        BlockEditReader reader(record, CHUNK_BLOCKS);
+        read_edits(reader);
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+
+    return false;
+}
+
+TEST(block_edits_outside_the_chunk_throw) {
+    std::vector<BlockEdit> edits = {{.index = 3, .block = 1}, {.index = CHUNK_BLOCKS, .block = 1}};
+    std::vector<uint8_t> buffer(max_encoded_block_edits_size(edits.size()));
+    const size_t size = encode_block_edits(0, 0, 0, edits, buffer);
+
+    CHECK(reading_edits_throws(std::span<const uint8_t>(buffer.data(), size)));
+
+    // Index differences which wrap around back into the chunk: 10, then 2^32 - 1
+    const std::vector<uint8_t> wrapping = {(uint8_t)RecordType::BLOCK_EDITS, 0, 0, 0, 2, 10, 1, 0xFF, 0xFF, 0xFF,
+                                           0xFF, 0x0F, 1};
+    CHECK(reading_edits_throws(wrapping));
+}
+
+TEST(batched_edits_are_split_by_chunk) {
+    BlockEditBatcher<X_SIZE, Y_SIZE, Z_SIZE> batcher;
+    CHECK(batcher.empty());
+
+    // Either side of the chunk boundaries at zero
+    batcher.add(0, 0, 0, models::STONE_BLOCK);
+    batcher.add(-1, -1, -1, models::DIRT_BLOCK);
+    batcher.add(X_SIZE + 1, 2, 3, models::EMPTY_BLOCK);
+    batcher.add(-1, -1, -1, models::STONE_BLOCK);
+    CHECK(!batcher.empty());
+
+    std::vector<uint8_t> out = {0xAA};
+    batcher.flush(out);
+    CHECK(batcher.empty());
+    CHECK(out[0] == 0xAA);
+
+    // The records follow what was already in out, in any order
+    size_t pos = 1;
+    unsigned int records = 0;
+
+    while (pos < out.size()) {
+        BlockEditReader reader(std::span<const uint8_t>(out).subspan(pos), CHUNK_BLOCKS);
+        const std::vector<BlockEdit> read = read_edits(reader);
+        pos += reader.bytes_read();
+        records++;
+
+        CHECK(read.size() == 1);
+        if (read.size() != 1) continue;
+
+        if (reader.chunk_x == 0 && reader.chunk_y == 0 && reader.chunk_z == 0) {
+            CHECK(read[0].index == 0 && read[0].block == models::STONE_BLOCK);
+        } else if (reader.chunk_x == -1 && reader.chunk_y == -1 && reader.chunk_z == -1) {
+            CHECK(read[0].index == CHUNK_BLOCKS - 1 && read[0].block == models::STONE_BLOCK);
+        } else {
+            CHECK(reader.chunk_x == 1 && reader.chunk_y == 0 && reader.chunk_z == 0);
+            CHECK(read[0].index == 1 + 2 * X_SIZE + 3 * X_SIZE * Y_SIZE && read[0].block == models::EMPTY_BLOCK);
+        }
+    }
+
+    CHECK(pos == out.size());
+    CHECK(records == 3);
+}
+
+TEST(chunk_pool_reuses_released_chunks) {
+    ChunkPool<RenderingChunk> pool;
+
+    std::unique_ptr<RenderingChunk> chunk = pool.acquire();
+    RenderingChunk* const first = chunk.get();
+    pool.release(std::move(chunk));
+
+    CHECK(pool.acquire().get() == first);
+}
@@ -0,0 +1,132 @@
+#include "test.h"
+#include <mgr/chunkstore.h>
+#include <memory>
+#include <thread>
+
+using namespace mgr;
+
+// Entries are large, so the one copied into the store lives on the heap
+static const ChunkStoreEntry& empty_entry() {
+    static const auto entry = std::make_unique<ChunkStoreEntry>();
+    return *entry;
+}
+
+// The bytes accounted for each chunk
+static size_t entry_bytes() {
+    ChunkStoreHandle handle(SIZE_MAX);
+    handle.put(0, 0, 0, empty_entry());
+    return handle.bytes_used();
+}
+
+TEST(store_stays_within_byte_budget) {
+    const size_t bytes = entry_bytes();
+    CHECK(bytes >= sizeof(ChunkStoreEntry));
+
+    ChunkStoreHandle handle(4 * bytes);
+    for (int x = 0; x < 10; x++) {
+        handle.put(x, 0, 0, empty_entry());
+        CHECK(handle.bytes_used() <= 4 * bytes);
+    }
+
+    CHECK(handle.size() == 4);
+    CHECK(handle.bytes_used() == 4 * bytes);
+
+    // The chunk just put is never the one evicted
+    CHECK(handle.get(9, 0, 0) != nullptr);
+}
+
+TEST(replacing_chunk_does_not_count_twice) {
+    const size_t bytes = entry_bytes();
+
+    ChunkStoreHandle handle(2 * bytes);
+    handle.put(0, 0, 0, empty_entry());
+    handle.put(1, 0, 0, empty_entry());
+    handle.put(0, 0, 0, empty_entry());
+
+    CHECK(handle.size() == 2);
+    CHECK(handle.bytes_used() == 2 * bytes);
+}
+
+TEST(far_chunks_are_evicted_before_near_ones) {
+    const size_t bytes = entry_bytes();
+
+    ChunkStoreHandle handle(2 * bytes);
+    handle.set_focus(0, 0, 0);
+    handle.put(1, 0, 0, empty_entry());
+    handle.put(50, 0, 0, empty_entry());
+
+    // The near chunk is the least recently used, but the far one is further
+    handle.put(0, 0, 1, empty_entry());
+
+    CHECK(handle.get(1, 0, 0) != nullptr);
+    CHECK(handle.get(50, 0, 0) == nullptr);
+    CHECK(handle.get(0, 0, 1) != nullptr);
+}
+
+TEST(recently_used_chunks_are_kept) {
+    const size_t bytes = entry_bytes();
+
+    ChunkStoreHandle handle(2 * bytes);
+    handle.set_focus(0, 0, 0);
+    handle.put(1, 0, 0, empty_entry());
+    handle.put(-1, 0, 0, empty_entry());
+
+    // Of chunks as far from the focus, the least recently used goes first
+    CHECK(handle.get_and_mark_used(1, 0, 0) != nullptr);
+    handle.put(0, 0, 1, empty_entry());
+
+    CHECK(handle.get(1, 0, 0) != nullptr);
+    CHECK(handle.get(-1, 0, 0) == nullptr);
+}
+
+TEST(pinned_chunks_are_never_evicted) {
+    const size_t bytes = entry_bytes();
+
+    ChunkStoreHandle handle(bytes);
+    handle.put(0, 0, 0, empty_entry(), true);
+    handle.put(1, 0, 0, empty_entry(), true);
+
+    // Over budget, as only pinned chunks are loaded
+    CHECK(handle.size() == 2);
+    CHECK(handle.bytes_used() == 2 * bytes);
+
+    handle.put(2, 0, 0, empty_entry());
+    CHECK(handle.size() == 3);
+
+    // The unpinned chunk becomes evictable, and the store evicts what it can
+    handle.set_pinned({0, 0, 0}, false);
+    CHECK(handle.get(0, 0, 0) != nullptr);
+    CHECK(handle.get(2, 0, 0) == nullptr);
+
+    handle.set_pinned({1, 0, 0}, false);
+    CHECK(handle.size() == 1);
+    CHECK(handle.bytes_used() == bytes);
+}
+
+TEST(streaming_stays_within_byte_budget) {
+    const size_t bytes = entry_bytes();
+    constexpr int RADIUS = 2;
+
+    // Room for the pinned chunks around the point and some more, but far fewer than the run loads
+    const size_t budget = 200 * bytes;
+
+    ThreadPool pool(2);
+    ChunkStore store(budget, 1234, nullptr);
+
+    bool within_budget = true;
+
+    for (int step = 0; step < 40; step++) {
+        const InterestPoint point{.id = 1, .chunk_x = step, .chunk_y = 0, .chunk_z = 0, .radius = RADIUS};
+        store.update_interest_on_pool(pool, std::span(&point, 1));
+
+        while (store.queued_tasks() > 0) std::this_thread::yield();
+
+        store.use_handle([&](ChunkStoreHandle& handle) {
+            within_budget = within_budget && handle.bytes_used() <= budget;
+            within_budget = within_budget && handle.bytes_used() == handle.size() * bytes;
+        });
+    }
+
+    CHECK(within_budget);
+    CHECK(store.chunks_loaded() * bytes > 2 * budget);
+}
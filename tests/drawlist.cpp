@@ -0,0 +1,91 @@
+#include "test.h"
+#include <render/drawlist.h>
+#include <config.h>
+#include <algorithm>
+#include <thread>
+
+using namespace render;
+
+constexpr unsigned int Y_SIZE = models::RenderingChunk::Y_SIZE;
+
+// Requests a draw list and waits for it to be built
+static DrawList build(std::vector<MeshDraw> meshes, CullingOrigin origin,
+                      std::function<bool(const MeshKey &, unsigned int)> visible) {
+    DrawListBuilder builder;
+    builder.request(std::move(meshes), 1, origin, std::move(visible));
+
+    while (true) {
+        if (std::optional<DrawList> list = builder.take()) return std::move(*list);
+        std::this_thread::yield();
+    }
+}
+
+static MeshDraw mesh(unsigned int level, int x, int y, int z, ChunkCulling culling = {}) {
+    return {.key = {level, x, y, z},
+            .command = {.count = 6, .instance_count = 1, .first_index = 0, .base_vertex = 0, .base_instance = 0},
+            .culling = culling};
+}
+
+static bool has_key(const DrawList &list, const MeshKey &key) {
+    return std::find(list.keys.begin(), list.keys.end(), key) != list.keys.end();
+}
+
+TEST(draw_list_leaves_out_chunks_behind_walls) {
+    // A cube of chunks around the camera, with a solid wall at x = 1
+    std::vector<MeshDraw> meshes;
+    for (int x = -2; x <= 2; x++) {
+        for (int y = -2; y <= 2; y++) {
+            for (int z = -2; z <= 2; z++) {
+                const FaceConnectivity faces = x == 1 ? 0 : ALL_FACES_CONNECTED;
+                meshes.push_back(mesh(0, x, y, z, {.face_connectivity = faces}));
+            }
+        }
+    }
+
+    // Level of detail nodes are never culled by the walk, but meshes with no instances and those not wanted are
+    meshes.push_back(mesh(1, 2, 0, 0));
+    meshes.push_back(mesh(0, 0, 3, 0));
+    meshes.back().command.instance_count = 0;
+
+    const DrawList list = build(meshes, {.chunk_x = 0, .chunk_y = 0, .chunk_z = 0, .radius = 2},
+                                [](const MeshKey &key, unsigned int) { return std::get<3>(key) != -2; });
+
+    CHECK(list.mesh_generation == 1);
+    CHECK(list.keys.size() == list.commands.size());
+
+    CHECK(has_key(list, {0, 1, 0, 0}));
+    CHECK(has_key(list, {1, 2, 0, 0}));
+    CHECK(!has_key(list, {0, -2, 0, -2}));
+    CHECK(!has_key(list, {0, 0, 3, 0}));
+
+    if (config::VISIBILITY_CULLING) {
+        CHECK(!has_key(list, {0, 2, 0, 0}));
+
+        // 4 of the 5 x slices, less the unwanted z slice, and the node
+        CHECK(list.keys.size() == 4 * 5 * 4 + 1);
+    }
+}
+
+TEST(occluders_merge_solid_columns) {
+    if (!config::OCCLUSION_CULLING) return;
+
+    // A full chunk topped by one solid a quarter of the way up, and a chunk beyond the occluder distance
+    const std::vector<MeshDraw> meshes = {
+        mesh(0, 1, -1, 0, {.solid_height = Y_SIZE}),
+        mesh(0, 1, 0, 0, {.solid_height = Y_SIZE / 4}),
+        mesh(0, 1, 1, 0, {.solid_height = 0}),
+        mesh(0, config::OCCLUDER_DISTANCE + 1, 0, 0, {.solid_height = Y_SIZE}),
+    };
+
+    const DrawList list = build(meshes, {.chunk_x = 0, .chunk_y = 0, .chunk_z = 0, .radius = 2},
+                                [](const MeshKey &, unsigned int) { return true; });
+
+    CHECK(list.occluders.size() == 1);
+    if (list.occluders.size() != 1) return;
+
+    const Aabb bottom = mesh_bounds({0, 1, -1, 0});
+    const Aabb &occluder = list.occluders[0];
+    CHECK(occluder.min == bottom.min);
+    CHECK(occluder.max[0] == bottom.max[0] && occluder.max[2] == bottom.max[2]);
+    CHECK(occluder.max[1] == bottom.min[1] + (float)config::BLOCK_SIZE * (Y_SIZE + Y_SIZE / 4));
+}
@@ -0,0 +1,136 @@
+#include "test.h"
+#include <mgr/interest.h>
+#include <config.h>
+#include <algorithm>
+#include <cstdint>
+#include <set>
+#include <vector>
+
+using namespace mgr;
+
+// The chunks in range of any of the points, found the slow way
+static std::set<ChunkCoord> chunks_in_range(const std::vector<InterestPoint>& points) {
+    std::set<ChunkCoord> chunks;
+
+    for (const InterestPoint& point : points) {
+        for (int x = point.chunk_x - point.radius; x <= point.chunk_x + point.radius; x++) {
+            for (int y = std::max(point.chunk_y - point.radius, config::MIN_CHUNK_Y);
+                 y <= std::min(point.chunk_y + point.radius, config::MAX_CHUNK_Y); y++) {
+                for (int z = point.chunk_z - point.radius; z <= point.chunk_z + point.radius; z++) {
+                    chunks.insert({x, y, z});
+                }
+            }
+        }
+    }
+
+    return chunks;
+}
+
+// Updates the set, and checks it reported exactly the chunks which came into and went out of range, once each
+static void check_update(InterestSet& interest, std::set<ChunkCoord>& in_range,
+                         const std::vector<InterestPoint>& points) {
+    std::vector<ChunkCoord> entered;
+    std::vector<ChunkCoord> left;
+    interest.update(points, entered, left);
+
+    const std::set<ChunkCoord> now_in_range = chunks_in_range(points);
+
+    std::vector<ChunkCoord> expected_entered;
+    std::set_difference(now_in_range.begin(), now_in_range.end(), in_range.begin(), in_range.end(),
+                        std::back_inserter(expected_entered));
+
+    std::vector<ChunkCoord> expected_left;
+    std::set_difference(in_range.begin(), in_range.end(), now_in_range.begin(), now_in_range.end(),
+                        std::back_inserter(expected_left));
+
+    std::sort(entered.begin(), entered.end());
+    std::sort(left.begin(), left.end());
+
+    CHECK(entered == expected_entered);
+    CHECK(left == expected_left);
+    CHECK(interest.size() == now_in_range.size());
+
+    in_range = now_in_range;
+}
+
+TEST(moving_point_reports_only_the_edges) {
+    InterestSet interest;
+    std::set<ChunkCoord> in_range;
+
+    check_update(interest, in_range, {{.id = 7, .chunk_x = 0, .chunk_y = 0, .chunk_z = 0, .radius = 2}});
+    CHECK(interest.contains({2, 0, -2}));
+    CHECK(!interest.contains({3, 0, 0}));
+
+    std::vector<ChunkCoord> entered;
+    std::vector<ChunkCoord> left;
+    const InterestPoint moved = {.id = 7, .chunk_x = 1, .chunk_y = 0, .chunk_z = 0, .radius = 2};
+    interest.update({&moved, 1}, entered, left);
+
+    // One slab of 5 by 5 chunks, less any clamped away vertically
+    CHECK(entered.size() == left.size());
+    CHECK(entered.size() <= 25);
+    for (const auto& [x, y, z] : entered) CHECK(x == 3);
+    for (const auto& [x, y, z] : left) CHECK(x == -2);
+}
+
+TEST(chunks_passed_between_points_never_leave) {
+    InterestSet interest;
+    std::set<ChunkCoord> in_range;
+
+    check_update(interest, in_range, {{.id = 1, .chunk_x = 0, .chunk_y = 0, .chunk_z = 0, .radius = 1}});
+
+    // The second point covers the first one's chunks as the first moves away
+    std::vector<ChunkCoord> entered;
+    std::vector<ChunkCoord> left;
+    const std::vector<InterestPoint> points = {{.id = 1, .chunk_x = 10, .chunk_y = 0, .chunk_z = 0, .radius = 1},
+                                               {.id = 2, .chunk_x = 0, .chunk_y = 0, .chunk_z = 0, .radius = 1}};
+    interest.update(points, entered, left);
+
+    CHECK(left.empty());
+    for (const auto& [x, y, z] : entered) CHECK(x >= 9);
+}
+
+TEST(random_updates_match_brute_force) {
+    InterestSet interest;
+    std::set<ChunkCoord> in_range;
+
+    std::vector<InterestPoint> points;
+    uint32_t random = 1;
+    auto next_random = [&random](unsigned int range) {
+        random = random * 1664525 + 1013904223;
+        return (random >> 8) % range;
+    };
+
+    for (unsigned int step = 0; step < 300; step++) {
+        // Points appear, disappear, step a chunk, jump, and change radius
+        const unsigned int action = next_random(5);
+
+        if (action == 0 && points.size() < 4) {
+            points.push_back({.id = step,
+                              .chunk_x = (int)next_random(20) - 10,
+                              .chunk_y = (int)next_random(10) - 5,
+                              .chunk_z = (int)next_random(20) - 10,
+                              .radius = (int)next_random(4)});
+        } else if (action == 1 && !points.empty()) {
+            points.erase(points.begin() + next_random(points.size()));
+        } else if (!points.empty()) {
+            InterestPoint& point = points[next_random(points.size())];
+
+            if (action == 2) {
+                point.chunk_x += (int)next_random(3) - 1;
+                point.chunk_y += (int)next_random(3) - 1;
+                point.chunk_z += (int)next_random(3) - 1;
+            } else if (action == 3) {
+                point.chunk_x += (int)next_random(9) - 4;
+                point.chunk_z += (int)next_random(9) - 4;
+            } else {
+                point.radius = next_random(4);
+            }
+        }
+
+        check_update(interest, in_range, points);
+    }
+
+    check_update(interest, in_range, {});
+    CHECK(interest.size() == 0);
+}
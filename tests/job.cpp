@@ -0,0 +1,76 @@
+#include "test.h"
+#include <mgr/job.h>
+#include <atomic>
+#include <thread>
+
+using namespace mgr;
+
+// Counts the frames of jobs which are still alive, by a local in each
+struct FrameGuard {
+    std::atomic<int>& alive;
+
+    explicit FrameGuard(std::atomic<int>& alive) : alive(alive) { alive++; }
+    ~FrameGuard() { alive--; }
+};
+
+static Job move_to_pool(ThreadPool& pool, std::atomic<int>& alive, std::atomic<bool>& resumed,
+                        std::thread::id& resumed_on) {
+    FrameGuard guard(alive);
+
+    if (!co_await resume_on(pool)) co_return;
+
+    resumed_on = std::this_thread::get_id();
+    resumed = true;
+}
+
+TEST(job_resumes_on_pool) {
+    std::atomic<int> alive = 0;
+    std::atomic<bool> resumed = false;
+    std::thread::id resumed_on;
+
+    ThreadPool pool(1);
+    move_to_pool(pool, alive, resumed, resumed_on);
+
+    while (!resumed) std::this_thread::yield();
+    pool.stop();
+
+    CHECK(resumed_on != std::this_thread::get_id());
+    CHECK(alive == 0);
+}
+
+TEST(job_queued_when_pool_stops_is_destroyed) {
+    std::atomic<int> alive = 0;
+    std::atomic<bool> resumed = false;
+    std::thread::id resumed_on;
+
+    ThreadPool pool(1);
+
+    // Keeps the only thread busy until the job and a marker after it have been cleared by stop
+    std::atomic<bool> queued = false;
+    pool.enqueue([&pool, &queued] {
+        while (!queued || pool.queued() != 1) std::this_thread::yield();
+    });
+
+    move_to_pool(pool, alive, resumed, resumed_on);
+    pool.enqueue([] {});
+    queued = true;
+
+    CHECK(alive == 1);
+    pool.stop();
+
+    CHECK(!resumed);
+    CHECK(alive == 0);
+}
+
+TEST(job_is_not_moved_to_stopped_pool) {
+    std::atomic<int> alive = 0;
+    std::atomic<bool> resumed = false;
+    std::thread::id resumed_on;
+
+    ThreadPool pool(1);
+    pool.stop();
+    move_to_pool(pool, alive, resumed, resumed_on);
+
+    CHECK(!resumed);
+    CHECK(alive == 0);
+}
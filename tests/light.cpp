@@ -0,0 +1,161 @@
+#include "test.h"
+#include <lighting/lightengine.h>
+#include <mgr/chunkstore.h>
+#include <config.h>
+#include <algorithm>
+#include <array>
+#include <map>
+#include <memory>
+#include <random>
+#include <span>
+#include <vector>
+
+using models::RenderingChunk;
+
+constexpr int X_SIZE = RenderingChunk::X_SIZE;
+constexpr int Y_SIZE = RenderingChunk::Y_SIZE;
+constexpr int Z_SIZE = RenderingChunk::Z_SIZE;
+
+using LightEngine = lighting::LightEngine<X_SIZE, Y_SIZE, Z_SIZE>;
+
+struct LitChunk {
+    RenderingChunk chunk;
+    LightEngine::Light light;
+};
+
+using World = std::map<std::array<int, 3>, std::unique_ptr<LitChunk>>;
+
+static LightEngine::ChunkLookup world_lookup(World& world) {
+    return [&world](int chunk_x, int chunk_y, int chunk_z) -> LightEngine::ChunkRef {
+        auto it = world.find({chunk_x, chunk_y, chunk_z});
+        if (it == world.end()) return {};
+        return {.chunk = &it->second->chunk, .light = &it->second->light, .changed = nullptr};
+    };
+}
+
+// Loads a few chunks of random caves one at a time, joining each with propagation split into slices of max_voxels
+static World load_caves(unsigned int max_voxels) {
+    World world;
+    const LightEngine::ChunkLookup lookup = world_lookup(world);
+    LightEngine engine;
+
+    std::mt19937 rng(1234);
+    std::bernoulli_distribution solid(0.4);
+
+    for (int chunk_y = 1; chunk_y >= 0; chunk_y--) {
+        for (int chunk_z = 0; chunk_z < 2; chunk_z++) {
+            for (int chunk_x = 0; chunk_x < 2; chunk_x++) {
+                auto lit = std::make_unique<LitChunk>();
+                for (unsigned int i = 0; i < X_SIZE * Y_SIZE * Z_SIZE; i++) {
+                    if (solid(rng)) lit->chunk.block_at(i) = models::STONE_BLOCK;
+                }
+
+                engine.light_isolated(lit->chunk, lit->light);
+                world[{chunk_x, chunk_y, chunk_z}] = std::move(lit);
+
+                engine.join_neighbours(chunk_x, chunk_y, chunk_z, lookup);
+                while (engine.propagating()) engine.propagate(lookup, max_voxels);
+            }
+        }
+    }
+
+    return world;
+}
+
+TEST(columns_under_terrain_start_dark) {
+    auto lit = std::make_unique<LitChunk>();
+    LightEngine engine;
+
+    // Every other column has its surface above the chunk
+    std::array<int, X_SIZE * Z_SIZE> surface_heights;
+    for (int i = 0; i < X_SIZE * Z_SIZE; i++) surface_heights[i] = i % 2 == 0 ? Y_SIZE : Y_SIZE + 1;
+
+    engine.light_isolated(lit->chunk, lit->light, 0, surface_heights);
+
+    for (int z = 0; z < Z_SIZE; z++) {
+        for (int x = 0; x < X_SIZE; x++) {
+            const bool open = (x + z * X_SIZE) % 2 == 0;
+            const models::LightLevel sky = lit->light.sky(LightEngine::Light::index(x, 0, z));
+            CHECK(open ? sky == models::MAX_LIGHT : sky == models::MAX_LIGHT - 1);
+        }
+    }
+
+    // Without surface heights the sky is open everywhere
+    engine.light_isolated(lit->chunk, lit->light);
+    CHECK(lit->light.sky(LightEngine::Light::index(1, 0, 0)) == models::MAX_LIGHT);
+}
+
+TEST(sliced_propagation_matches_unbounded) {
+    World whole = load_caves(UINT_MAX);
+    World sliced = load_caves(100);
+
+    for (const auto& [key, lit] : whole) {
+        const LitChunk& other = *sliced.at(key);
+
+        bool same = true;
+        for (unsigned int i = 0; i < X_SIZE * Y_SIZE * Z_SIZE; i++) {
+            same = same && lit->light.packed(i) == other.light.packed(i);
+        }
+
+        CHECK(same);
+    }
+}
+
+TEST(propagation_stops_after_max_voxels) {
+    World world;
+    const LightEngine::ChunkLookup lookup = world_lookup(world);
+    LightEngine engine;
+
+    // Open air above a dark chunk, so joining them relights the lower one
+    for (int chunk_y = 0; chunk_y < 2; chunk_y++) {
+        auto lit = std::make_unique<LitChunk>();
+        std::array<int, X_SIZE * Z_SIZE> surface_heights;
+        surface_heights.fill(chunk_y == 0 ? Y_SIZE * 2 : 0);
+
+        engine.light_isolated(lit->chunk, lit->light, chunk_y, surface_heights);
+        world[{0, chunk_y, 0}] = std::move(lit);
+    }
+
+    engine.join_neighbours(0, 0, 0, lookup);
+    CHECK(engine.propagating());
+
+    unsigned int slices = 0;
+    while (engine.propagating()) {
+        CHECK(engine.propagate(lookup, 50) <= 50);
+        slices++;
+    }
+
+    CHECK(slices > 1);
+    CHECK(world.at({0, 0, 0})->light.sky(LightEngine::Light::index(0, 0, 0)) == models::MAX_LIGHT);
+}
+
+TEST(loading_chunk_flags_meshed_neighbours) {
+    std::vector<uint8_t> ring(1 << 20);
+    mgr::MeshUploadQueue uploads(ring);
+    mgr::ChunkStore store(SIZE_MAX, 1234, &uploads);
+
+    // Solid chunks below the terrain, so no light changes flag them
+    const int chunk_y = config::MIN_CHUNK_Y;
+    store.load_chunk(0, chunk_y, 0);
+    store.load_chunk(0, chunk_y, 2);
+
+    std::vector<mgr::ChunkCoord> flagged;
+    store.use_handle([&](mgr::ChunkStoreHandle& handle) {
+        handle.take_flagged(flagged);
+        for (mgr::ChunkCoord coord : {mgr::ChunkCoord{0, chunk_y, 0}, mgr::ChunkCoord{0, chunk_y, 2}}) {
+            const auto [x, y, z] = coord;
+            handle.get(x, y, z)->needs_remesh = false;
+        }
+        handle.get(0, chunk_y, 0)->meshed = true;
+    });
+
+    // Meshed with its border guessed while this neighbour wasn't loaded
+    store.load_chunk(1, chunk_y, 1);
+
+    store.use_handle([&](mgr::ChunkStoreHandle& handle) { handle.take_flagged(flagged); });
+    CHECK(std::find(flagged.begin(), flagged.end(), mgr::ChunkCoord{0, chunk_y, 0}) != flagged.end());
+    CHECK(std::find(flagged.begin(), flagged.end(), mgr::ChunkCoord{1, chunk_y, 1}) != flagged.end());
+
+    // Never meshed, so it has nothing to redo
+    CHECK(std::find(flagged.begin(), flagged.end(), mgr::ChunkCoord{0, chunk_y, 2}) == flagged.end());
+}
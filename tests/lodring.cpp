@@ -0,0 +1,40 @@
+#include "test.h"
+#include <mgr/lodstore.h>
+#include <config.h>
+#include <algorithm>
+#include <cstdlib>
+
+// Whether the mesh of a node is drawn for a camera in the given chunk, as the draw list predicate in main decides
+static bool drawn(unsigned int level, int node_x, int node_z, int camera_x, int camera_z) {
+    if (level == 0 && std::max(std::abs(node_x - camera_x), std::abs(node_z - camera_z)) > config::RENDER_DISTANCE) {
+        return false;
+    }
+
+    return mgr::lod_node_in_ring(level, node_x, node_z, camera_x, camera_z);
+}
+
+TEST(every_column_is_drawn_exactly_once) {
+    constexpr unsigned int TOP_LEVEL = config::LOD_LEVELS + config::FAR_TERRAIN_LEVELS;
+    constexpr int EXTENT = config::LOD_RENDER_DISTANCE;
+
+    unsigned int wrong = 0;
+
+    for (int camera_x = -3; camera_x <= 3; camera_x++) {
+        for (int camera_z = -3; camera_z <= 3; camera_z++) {
+            for (int x = camera_x - EXTENT; x <= camera_x + EXTENT; x++) {
+                for (int z = camera_z - EXTENT; z <= camera_z + EXTENT; z++) {
+                    unsigned int count = 0;
+
+                    // Right shifts give the node containing the chunk at each level
+                    for (unsigned int level = 0; level <= TOP_LEVEL; level++) {
+                        count += drawn(level, x >> level, z >> level, camera_x, camera_z);
+                    }
+
+                    wrong += count != 1;
+                }
+            }
+        }
+    }
+
+    CHECK(wrong == 0);
+}
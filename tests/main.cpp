@@ -0,0 +1,48 @@
+#include "test.h"
+#include <cstring>
+#include <exception>
+#include <iostream>
+
+using namespace test;
+
+static unsigned int failed_checks = 0;
+
+std::vector<TestCase> &test::test_cases() {
+    // Made on first use, as tests register themselves during static initialisation
+    static std::vector<TestCase> cases;
+    return cases;
+}
+
+void test::fail(const char *file, int line, const char *expression) {
+    std::cerr << file << ":" << line << ": CHECK(" << expression << ") failed" << std::endl;
+    failed_checks++;
+}
+
+// Runs the tests whose names contain the first argument, or all of them
+int main(int argc, char **argv) {
+    const char *filter = argc > 1 ? argv[1] : "";
+    unsigned int ran = 0;
+    unsigned int failed = 0;
+
+    for (const TestCase &test_case : test_cases()) {
+        if (!std::strstr(test_case.name, filter)) continue;
+
+        const unsigned int checks_before = failed_checks;
+
+        try {
+            test_case.run();
+        } catch (const std::exception &e) {
+            std::cerr << test_case.name << ": threw " << e.what() << std::endl;
+            failed_checks++;
+        }
+
+        ran++;
+        if (failed_checks != checks_before) {
+            failed++;
+            std::cerr << "FAILED " << test_case.name << std::endl;
+        }
+    }
+
+    std::cout << ran - failed << "/" << ran << " tests passed" << std::endl;
+    return failed == 0 ? 0 : 1;
+}
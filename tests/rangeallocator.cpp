@@ -0,0 +1,105 @@
+#include "test.h"
+#include <render/rangeallocator.h>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using namespace render;
+
+TEST(ranges_are_allocated_first_fit) {
+    RangeAllocator allocator(100);
+
+    CHECK(allocator.allocate(10) == 0u);
+    CHECK(allocator.allocate(20) == 10u);
+    CHECK(allocator.allocate(30) == 30u);
+    CHECK(allocator.used() == 60);
+
+    // Into the first hole large enough
+    allocator.free(0, 10);
+    CHECK(allocator.allocate(15) == 60u);
+    CHECK(allocator.allocate(5) == 0u);
+
+    CHECK(!allocator.allocate(26).has_value());
+    CHECK(allocator.allocate(25) == 75u);
+    CHECK(allocator.allocate(5) == 5u);
+    CHECK(allocator.used() == 100);
+}
+
+TEST(empty_ranges_need_no_space) {
+    RangeAllocator allocator(0);
+
+    CHECK(allocator.allocate(0) == 0u);
+    CHECK(!allocator.allocate(1).has_value());
+
+    allocator.free(0, 0);
+    CHECK(allocator.used() == 0);
+}
+
+TEST(freed_ranges_merge_with_both_neighbours) {
+    RangeAllocator allocator(30);
+    CHECK(allocator.allocate(10) == 0u);
+    CHECK(allocator.allocate(10) == 10u);
+    CHECK(allocator.allocate(10) == 20u);
+
+    // Freeing the middle last joins all three into one range
+    allocator.free(0, 10);
+    allocator.free(20, 10);
+    allocator.free(10, 10);
+
+    CHECK(allocator.used() == 0);
+    CHECK(allocator.allocate(30) == 0u);
+}
+
+TEST(growing_extends_the_free_range_at_the_end) {
+    RangeAllocator allocator(10);
+    CHECK(allocator.allocate(5) == 0u);
+
+    allocator.grow(20);
+    CHECK(allocator.capacity() == 20);
+    CHECK(allocator.used() == 5);
+
+    // The 5 free at the end before growing and the 10 added are one range
+    CHECK(allocator.allocate(15) == 5u);
+    CHECK(!allocator.allocate(1).has_value());
+}
+
+TEST(random_allocations_never_overlap) {
+    constexpr unsigned int CAPACITY = 1000;
+    RangeAllocator allocator(CAPACITY);
+
+    std::vector<bool> taken(CAPACITY, false);
+    std::vector<std::pair<unsigned int, unsigned int>> ranges;
+    uint32_t random = 1;
+
+    for (unsigned int step = 0; step < 20000; step++) {
+        random = random * 1664525 + 1013904223;
+
+        if ((random >> 16) % 3 != 0 || ranges.empty()) {
+            const unsigned int size = 1 + (random >> 8) % 50;
+            const std::optional<unsigned int> offset = allocator.allocate(size);
+            if (!offset) continue;
+
+            CHECK(*offset + size <= CAPACITY);
+            for (unsigned int i = *offset; i < *offset + size && i < CAPACITY; i++) {
+                CHECK(!taken[i]);
+                taken[i] = true;
+            }
+
+            ranges.push_back({*offset, size});
+        } else {
+            const size_t index = (random >> 8) % ranges.size();
+            const auto [offset, size] = ranges[index];
+            ranges[index] = ranges.back();
+            ranges.pop_back();
+
+            allocator.free(offset, size);
+            for (unsigned int i = offset; i < offset + size; i++) taken[i] = false;
+        }
+    }
+
+    for (const auto& [offset, size] : ranges) allocator.free(offset, size);
+
+    // Everything merges back into one range
+    CHECK(allocator.used() == 0);
+    CHECK(allocator.allocate(CAPACITY) == 0u);
+}
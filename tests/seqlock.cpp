@@ -0,0 +1,94 @@
+#include "test.h"
+#include <mgr/seqlock.h>
+#include <mgr/sharedstate.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+using namespace mgr;
+
+// Spans several words, so a torn read would show as words which differ
+struct Counters {
+    std::array<uint64_t, 8> values;
+};
+
+TEST(seqlock_reads_are_never_torn) {
+    constexpr unsigned int WRITERS = 2;
+    constexpr unsigned int READERS = 2;
+    constexpr uint64_t WRITES = 200000;
+
+    SeqLock<Counters> counters(Counters{});
+    std::atomic<bool> writing = true;
+    std::atomic<unsigned int> torn_reads = 0;
+    std::atomic<unsigned int> backwards_reads = 0;
+
+    std::vector<std::thread> readers;
+    for (unsigned int i = 0; i < READERS; i++) {
+        readers.emplace_back([&] {
+            uint64_t last = 0;
+
+            while (writing.load(std::memory_order::relaxed)) {
+                const Counters read = counters.load();
+
+                for (uint64_t value : read.values) {
+                    if (value != read.values[0]) torn_reads++;
+                }
+
+                if (read.values[0] < last) backwards_reads++;
+                last = read.values[0];
+            }
+        });
+    }
+
+    std::vector<std::thread> writers;
+    for (unsigned int i = 0; i < WRITERS; i++) {
+        writers.emplace_back([&] {
+            for (uint64_t write = 0; write < WRITES; write++) {
+                counters.update([](Counters& current) {
+                    for (uint64_t& value : current.values) value++;
+                });
+            }
+        });
+    }
+
+    for (std::thread& writer : writers) writer.join();
+    writing = false;
+    for (std::thread& reader : readers) reader.join();
+
+    CHECK(torn_reads == 0);
+    CHECK(backwards_reads == 0);
+
+    // No update was lost to another writer
+    const Counters last = counters.load();
+    for (uint64_t value : last.values) CHECK(value == WRITERS * WRITES);
+}
+
+TEST(seqlock_update_returns_old_and_new_values) {
+    SeqLock<int> value(1);
+
+    const auto [old_value, new_value] = value.update([](int& current) { current *= 5; });
+    CHECK(old_value == 1);
+    CHECK(new_value == 5);
+
+    value.store(7);
+    CHECK(value.load() == 7);
+}
+
+TEST(shared_state_only_wakes_on_changes) {
+    WakeSignal wake_signal;
+    SharedState shared_state({.chunk_x = 1, .chunk_y = 2, .chunk_z = 3}, &wake_signal);
+
+    // Nothing changed, so the wait times out
+    shared_state.modify([](SharedStateView& state) { state.chunk_x = 1; });
+    CHECK(!wake_signal.wait_until(std::chrono::steady_clock::now()).has_value());
+
+    shared_state.modify([](SharedStateView& state) { state.velocity[1] = 2.0f; });
+    CHECK(wake_signal.wait_until(std::chrono::steady_clock::now()).has_value());
+
+    const SharedStateView state = shared_state.get();
+    CHECK(state.chunk_x == 1 && state.chunk_y == 2 && state.chunk_z == 3);
+    CHECK(state.velocity[1] == 2.0f);
+}
@@ -0,0 +1,32 @@
+#include "test.h"
+#include <mgr/taskgraph.h>
+#include <array>
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+
+using namespace mgr;
+
+TEST(throwing_task_finishes_and_releases_dependents) {
+    ThreadPool pool(1);
+    TaskGraph graph(1);
+
+    const TaskKey failing{.stage = 0, .coord = {0, 0, 0}};
+    const TaskKey dependent{.stage = 1, .coord = {0, 0, 0}};
+    std::atomic<int> ran = 0;
+
+    graph.add(failing, 0.0f, {}, [] { throw std::runtime_error("expected by the test"); });
+    const std::array<TaskKey, 1> dependencies = {failing};
+    graph.add(dependent, 0.0f, dependencies, [&ran] { ran++; });
+    graph.start(pool);
+
+    while (graph.size() > 0) std::this_thread::yield();
+    CHECK(ran == 1);
+
+    // The failed task left the graph, so it can be added and run again
+    CHECK(graph.add(failing, 0.0f, {}, [&ran] { ran++; }));
+    graph.start(pool);
+
+    while (graph.size() > 0) std::this_thread::yield();
+    CHECK(ran == 2);
+}
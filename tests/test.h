@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+
+// A minimal test runner. Tests are defined anywhere with TEST and run by voxel_tests, optionally filtered by name.
+namespace test {
+
+struct TestCase {
+    const char *name;
+    void (*run)();
+};
+
+std::vector<TestCase> &test_cases();
+
+// Records a failed check, which fails the test it is in without stopping it
+void fail(const char *file, int line, const char *expression);
+
+struct Registration {
+    Registration(const char *name, void (*run)()) { test_cases().push_back({name, run}); }
+};
+
+}  // namespace test
+
+#define TEST(name)                                                    \
+    static void name();                                               \
+    static const test::Registration name##_registration(#name, name); \
+    static void name()
+
+#define CHECK(expression)                                               \
+    do {                                                                \
+        if (!(expression)) test::fail(__FILE__, __LINE__, #expression); \
+    } while (0)
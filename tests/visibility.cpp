@@ -0,0 +1,135 @@
+#include "test.h"
+#include <render/visibility.h>
+#include <memory>
+
+using namespace render;
+using models::RenderingChunk;
+
+constexpr unsigned int X_SIZE = RenderingChunk::X_SIZE;
+constexpr unsigned int Y_SIZE = RenderingChunk::Y_SIZE;
+constexpr unsigned int Z_SIZE = RenderingChunk::Z_SIZE;
+
+// On the heap, as chunks can be built large
+static std::unique_ptr<RenderingChunk> solid_chunk() {
+    auto chunk = std::make_unique<RenderingChunk>();
+    for (unsigned int i = 0; i < X_SIZE * Y_SIZE * Z_SIZE; i++) chunk->block_at(i) = models::STONE_BLOCK;
+    return chunk;
+}
+
+// The pairs of faces which are connected, other than each face and itself
+static unsigned int connected_pairs(FaceConnectivity connectivity) {
+    unsigned int pairs = 0;
+
+    for (unsigned int a = 0; a < 6; a++) {
+        for (unsigned int b = a + 1; b < 6; b++) pairs += faces_connected(connectivity, a, b);
+    }
+
+    return pairs;
+}
+
+TEST(empty_chunk_connects_all_faces) {
+    const auto chunk = std::make_unique<RenderingChunk>();
+    CHECK(chunk_face_connectivity(*chunk) == ALL_FACES_CONNECTED);
+    CHECK(connected_pairs(ALL_FACES_CONNECTED) == 15);
+    CHECK(chunk_solid_height(*chunk) == 0);
+}
+
+TEST(solid_chunk_connects_no_faces) {
+    const auto chunk = solid_chunk();
+    CHECK(chunk_face_connectivity(*chunk) == 0);
+    CHECK(chunk_solid_height(*chunk) == Y_SIZE);
+}
+
+TEST(wall_separates_its_sides) {
+    // A wall across the middle of the chunk, facing x
+    auto chunk = std::make_unique<RenderingChunk>();
+    for (unsigned int y = 0; y < Y_SIZE; y++) {
+        for (unsigned int z = 0; z < Z_SIZE; z++) (*chunk)[X_SIZE / 2, y, z] = models::STONE_BLOCK;
+    }
+
+    const FaceConnectivity connectivity = chunk_face_connectivity(*chunk);
+    CHECK(!faces_connected(connectivity, 0, 1));
+
+    // Either side of the wall still reaches the other four faces
+    for (unsigned int face = 2; face < 6; face++) {
+        CHECK(faces_connected(connectivity, 0, face));
+        CHECK(faces_connected(connectivity, 1, face));
+    }
+
+    CHECK(connected_pairs(connectivity) == 14);
+}
+
+TEST(tunnel_connects_only_its_ends) {
+    // A solid chunk with a one block tunnel along z through the middle
+    auto chunk = solid_chunk();
+    for (unsigned int z = 0; z < Z_SIZE; z++) (*chunk)[X_SIZE / 2, Y_SIZE / 2, z] = models::EMPTY_BLOCK;
+
+    const FaceConnectivity connectivity = chunk_face_connectivity(*chunk);
+    CHECK(faces_connected(connectivity, 4, 5));
+    CHECK(connected_pairs(connectivity) == 1);
+}
+
+TEST(bend_connects_its_ends) {
+    // A tunnel from the -x face which turns up to the +y face
+    auto chunk = solid_chunk();
+    for (unsigned int x = 0; x <= X_SIZE / 2; x++) (*chunk)[x, Y_SIZE / 2, Z_SIZE / 2] = models::EMPTY_BLOCK;
+    for (unsigned int y = Y_SIZE / 2; y < Y_SIZE; y++) (*chunk)[X_SIZE / 2, y, Z_SIZE / 2] = models::EMPTY_BLOCK;
+
+    const FaceConnectivity connectivity = chunk_face_connectivity(*chunk);
+    CHECK(faces_connected(connectivity, 0, 3));
+    CHECK(connected_pairs(connectivity) == 1);
+}
+
+TEST(open_world_is_all_visible) {
+    ChunkVisibility visibility(0, 0, 0, 2);
+    visibility.update();
+
+    CHECK(visibility.visible_count() == 5 * 5 * 5);
+    CHECK(visibility.is_visible(2, -2, 2));
+}
+
+TEST(solid_wall_hides_chunks_behind_it) {
+    ChunkVisibility visibility(0, 0, 0, 2);
+    for (int y = -2; y <= 2; y++) {
+        for (int z = -2; z <= 2; z++) visibility.set_connectivity(1, y, z, 0);
+    }
+    visibility.update();
+
+    // The wall itself is seen, but nothing beyond it
+    CHECK(visibility.is_visible(1, 0, 0));
+    CHECK(visibility.is_visible(-2, 2, -2));
+    for (int y = -2; y <= 2; y++) {
+        for (int z = -2; z <= 2; z++) CHECK(!visibility.is_visible(2, y, z));
+    }
+    CHECK(visibility.visible_count() == 4 * 5 * 5);
+
+    // Chunks outside the cube are never culled
+    CHECK(visibility.is_visible(3, 0, 0));
+}
+
+TEST(tunnel_through_wall_shows_chunks_behind_it) {
+    ChunkVisibility visibility(0, 0, 0, 2);
+    for (int y = -2; y <= 2; y++) {
+        for (int z = -2; z <= 2; z++) visibility.set_connectivity(1, y, z, 0);
+    }
+
+    // A tunnel along x through the wall in front of the camera
+    auto chunk = solid_chunk();
+    for (unsigned int x = 0; x < X_SIZE; x++) (*chunk)[x, Y_SIZE / 2, Z_SIZE / 2] = models::EMPTY_BLOCK;
+    visibility.set_connectivity(1, 0, 0, chunk_face_connectivity(*chunk));
+    visibility.update();
+
+    // Past the tunnel, the open chunks lead everywhere behind the wall
+    CHECK(visibility.is_visible(2, 0, 0));
+    CHECK(visibility.is_visible(2, 2, -2));
+    CHECK(visibility.visible_count() == 5 * 5 * 5);
+}
+
+TEST(camera_chunk_sees_out_of_every_face) {
+    // The camera chunk is solid, such as when inside a wall, but is never used to cull its neighbours
+    ChunkVisibility visibility(0, 0, 0, 1);
+    visibility.set_connectivity(0, 0, 0, 0);
+    visibility.update();
+
+    CHECK(visibility.visible_count() == 3 * 3 * 3);
+}